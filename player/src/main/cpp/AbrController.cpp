@@ -0,0 +1,131 @@
+#include <algorithm>
+#include "AbrController.h"
+#include "Log.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+AbrController *AbrController::create(AVFormatContext *formatContext, int video_index, int audio_index) {
+    if (formatContext->nb_programs < 2 || video_index < 0) {
+        return nullptr;
+    }
+    AVStream *video = formatContext->streams[video_index];
+    AVStream *audio = audio_index >= 0 ? formatContext->streams[audio_index] : nullptr;
+
+    std::vector<Variant> variants;
+    for (int i = 0; i < (int) formatContext->nb_programs; i++) {
+        AVProgram *program = formatContext->programs[i];
+        AVDictionaryEntry *entry = av_dict_get(program->metadata, "variant_bitrate", nullptr, 0);
+        int64_t bitrate = entry ? strtoll(entry->value, nullptr, 10) : 0;
+        if (bitrate <= 0) {
+            continue;
+        }
+
+        Variant variant = {bitrate, -1, audio_index};
+        bool has_audio = false;
+        for (int j = 0; j < (int) program->nb_stream_indexes; j++) {
+            int index = program->stream_index[j];
+            AVStream *stream = formatContext->streams[index];
+            if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && variant.video_index < 0
+                && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+                variant.video_index = index;
+            } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && !has_audio) {
+                variant.audio_index = index;
+                has_audio = true;
+            }
+        }
+
+        // 只能切换到编码格式和时间基相同的码率，通道的解码器和时间基保持不变
+        AVStream *variant_video = variant.video_index >= 0 ? formatContext->streams[variant.video_index] : nullptr;
+        if (!variant_video || variant_video->codecpar->codec_id != video->codecpar->codec_id
+            || av_cmp_q(variant_video->time_base, video->time_base) != 0) {
+            continue;
+        }
+        if (audio && has_audio) {
+            AVStream *variant_audio = formatContext->streams[variant.audio_index];
+            if (variant_audio->codecpar->codec_id != audio->codecpar->codec_id
+                || av_cmp_q(variant_audio->time_base, audio->time_base) != 0) {
+                continue;
+            }
+        }
+        variants.push_back(variant);
+    }
+    if (variants.size() < 2) {
+        return nullptr;
+    }
+    std::sort(variants.begin(), variants.end(), [](const Variant &a, const Variant &b) {
+        return a.bitrate < b.bitrate;
+    });
+
+    auto *abr = new AbrController();
+    abr->variants = variants;
+    abr->current = -1;
+    for (int i = 0; i < (int) variants.size(); i++) {
+        if (variants[i].video_index == video_index) {
+            abr->current = i;
+            break;
+        }
+    }
+    if (abr->current < 0) {
+        delete abr; // prepare选择的视频流不属于任何可以切换的码率
+        return nullptr;
+    }
+    LOGD("HLS自适应码率：%d 个码率，当前 %lld bit/s\n", (int) variants.size(),
+         (long long) variants[abr->current].bitrate)
+    return abr;
+}
+
+void AbrController::onRead(int bytes, int64_t read_time) {
+    sample_bytes += bytes;
+    sample_time += read_time;
+    if (sample_time < ABR_SAMPLE_TIME) {
+        return;
+    }
+    double sample = sample_bytes * 8.0 * AV_TIME_BASE / sample_time;
+    throughput = throughput > 0 ? throughput * 0.7 + sample * 0.3 : sample;
+    sample_bytes = 0;
+    sample_time = 0;
+}
+
+int AbrController::decide(double buffered) {
+    if (pending >= 0 || throughput <= 0) {
+        return -1;
+    }
+    bool panic = buffered < ABR_PANIC_BUFFER;
+    if (!panic && av_gettime_relative() - last_switch_time < ABR_SWITCH_INTERVAL) {
+        return -1;
+    }
+
+    int target = 0;
+    for (int i = 0; i < (int) variants.size(); i++) {
+        if (variants[i].bitrate <= throughput * ABR_SAFETY) {
+            target = i;
+        }
+    }
+    if (target == current || (target > current && buffered < ABR_UP_BUFFER)) {
+        return -1;
+    }
+    pending = target;
+    LOGD("HLS切换码率 %lld -> %lld bit/s，吞吐 %lld bit/s，缓存 %.1f s\n",
+         (long long) variants[current].bitrate, (long long) variants[target].bitrate,
+         (long long) throughput, buffered)
+    return target;
+}
+
+void AbrController::commit() {
+    current = pending;
+    pending = -1;
+    last_switch_time = av_gettime_relative();
+    switches++;
+}
+
+bool AbrController::isPending(int stream_index) {
+    if (pending < 0) {
+        return false;
+    }
+    const Variant &next = variants[pending];
+    const Variant &now = variants[current];
+    return (stream_index == next.video_index && next.video_index != now.video_index)
+           || (stream_index == next.audio_index && next.audio_index != now.audio_index);
+}
@@ -0,0 +1,99 @@
+#ifndef VIDEOPLAYER_ABRCONTROLLER_H
+#define VIDEOPLAYER_ABRCONTROLLER_H
+
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#define ABR_SAMPLE_TIME 500000 // 每累计该时长的读取时间计算一次下载吞吐，单位微秒
+#define ABR_SWITCH_INTERVAL 8000000 // 两次切换之间的最短间隔（缓存告急时除外），单位微秒
+#define ABR_SAFETY 0.75 // 只选择码率不超过吞吐该比例的码率
+#define ABR_UP_BUFFER 3.0 // 超前播放位置的缓存达到该时长才向上切换，单位秒
+#define ABR_PANIC_BUFFER 1.0 // 缓存低于该时长时不等切换间隔，立即按吞吐向下切换，单位秒
+
+/**
+ * HLS自适应码率。
+ *
+ * ffmpeg的hls解封装器把主播放列表中的每个码率（variant）作为一个节目（AVProgram），所有码率的流都在同一个上下文中。
+ * 某个码率的流全部设置为丢弃后，hls解封装器在该码率的当前分片结束时停止下载；取消丢弃后，从当前的时间开始下载。
+ * 所以切换码率就是改变流的丢弃标记，切换发生在分片边界。
+ *
+ * 这里只负责测量吞吐并做出决定：吞吐由解封装线程读取到的压缩包字节数和读取（下载）耗时计算，
+ * 选择码率不超过吞吐一定比例的最高码率；缓存不足时不向上切换，缓存告急时立即向下切换。
+ * 切换的执行（新码率的流从关键帧开始送给原来的通道）由 VideoPlayer 完成。
+ *
+ * 只在解封装线程中使用。
+ */
+class AbrController {
+
+public:
+    struct Variant {
+        int64_t bitrate; // 码率，单位 bit/s
+        int video_index; // 视频流的下标
+        int audio_index; // 音频流的下标，码率中没有音频（音频为单独的分组）时为当前播放的音频流
+    };
+
+private:
+    std::vector<Variant> variants; // 按码率从低到高排列
+    int current = 0; // 正在播放的码率
+    int pending = -1; // 正在切换的目标码率，-1 表示没有切换
+
+    int64_t sample_bytes = 0; // 本次采样读取的字节数
+    int64_t sample_time = 0; // 本次采样读取的耗时，单位微秒
+    double throughput = 0; // 下载吞吐的平滑值，单位 bit/s
+    int64_t last_switch_time = 0; // 最近一次切换完成的时间，单位微秒
+
+    AbrController() = default;
+
+public:
+    int64_t switches = 0; // 切换的次数
+
+    /**
+     * @param formatContext hls的解封装上下文
+     * @param video_index prepare选择的视频流
+     * @param audio_index prepare选择的音频流，没有时为-1
+     * @return 不是多码率的hls、或者可以切换的码率不足两个时返回空
+     */
+    static AbrController *create(AVFormatContext *formatContext, int video_index, int audio_index);
+
+    /**
+     * 解封装线程每读到一个压缩包调用一次，更新吞吐
+     * @param bytes 压缩包的大小
+     * @param read_time av_read_frame的耗时，单位微秒
+     */
+    void onRead(int bytes, int64_t read_time);
+
+    /**
+     * 根据吞吐和缓存决定是否切换
+     * @param buffered 超前播放位置的缓存时长，单位秒
+     * @return 需要切换到的码率，不切换时返回-1
+     */
+    int decide(double buffered);
+
+    /**
+     * 新码率的流已经开始送给通道，切换完成
+     */
+    void commit();
+
+    bool isPending(int stream_index);
+
+    const Variant &currentVariant() {
+        return variants[current];
+    }
+
+    const Variant &pendingVariant() {
+        return variants[pending];
+    }
+
+    int count() {
+        return (int) variants.size();
+    }
+
+    int64_t currentThroughput() {
+        return (int64_t) throughput;
+    }
+};
+
+#endif //VIDEOPLAYER_ABRCONTROLLER_H
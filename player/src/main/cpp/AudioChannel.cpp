@@ -28,6 +28,28 @@ AudioChannel::AudioChannel(int stream_index, AVCodecContext *codecContext, AVRat
     // 堆区申请空间，作为缓冲区。
     out_buffers = static_cast<uint8_t *>(malloc(out_buffers_size));
 
+    // 重采样上下文在第一帧到来时按帧的实际参数创建，见 ensureResampler。
+}
+
+/**
+ * 按照解码出的帧的参数创建重采样上下文，参数改变时重新创建。
+ * 快速启动时prepare只做了很少的探测，解码器上下文中的声道布局等参数可能还是未知的，所以不能提前创建。
+ * @return 是否可以重采样
+ */
+bool AudioChannel::ensureResampler(AVFrame *frame) {
+    uint64_t channel_layout = frame->channel_layout ? frame->channel_layout
+                                                    : av_get_default_channel_layout(frame->channels);
+    if (swr_ctx && frame->format == in_sample_fmt && frame->sample_rate == in_sample_rate
+        && channel_layout == in_channel_layout) {
+        return true;
+    }
+    if (swr_ctx) {
+        swr_free(&swr_ctx);
+    }
+    in_sample_fmt = frame->format;
+    in_sample_rate = frame->sample_rate;
+    in_channel_layout = channel_layout;
+
     // 使用ffmpeg音频重采样。
     swr_ctx = swr_alloc_set_opts(0, // 目前没有上下文，可以传0，也可以传self
             // 下面是输出环节
@@ -36,55 +58,46 @@ AudioChannel::AudioChannel(int stream_index, AVCodecContext *codecContext, AVRat
                                  out_sample_rate, // 采样率  44100
 
             // 下面是输入环节
-                                 codecContext->channel_layout, // 声道布局类型
-                                 codecContext->sample_fmt, // 采样大小
-                                 codecContext->sample_rate,  // 采样率
+                                 channel_layout, // 声道布局类型
+                                 (AVSampleFormat) in_sample_fmt, // 采样大小
+                                 in_sample_rate,  // 采样率
                                  0, 0);
     // 初始化重采样上下文
-    swr_init(swr_ctx);
+    if (!swr_ctx || swr_init(swr_ctx) < 0) {
+        LOGD("创建重采样失败 format = %d, sample_rate = %d\n", in_sample_fmt, in_sample_rate)
+        swr_free(&swr_ctx);
+        return false;
+    }
+    LOGD("创建重采样 format = %d, sample_rate = %d, channels = %d\n", in_sample_fmt, in_sample_rate,
+         frame->channels)
+    return true;
 }
 
 AudioChannel::~AudioChannel() {
     DELETE(out_buffers)
+    if (sink_path) {
+        delete[] sink_path;
+        sink_path = nullptr;
+    }
     if(swr_ctx) {
         swr_free(&swr_ctx);
     }
 }
 
 void AudioChannel::stop() {
-    // 此处需要等待解码线程和播放线程全部停止，才可以释放资源。形成非分离线程
-    pthread_join(pid_audio_decode, nullptr);
-    pthread_join(pid_audio_play, nullptr);
-
+    // 先让队列停止工作，唤醒阻塞在队列上的解码线程和输出端，再等待线程结束。
     is_playing = false;
     packets.working(false);
     frames.working(false);
 
-    // OpenSLES释放工作
-    // 7.1 设置停止状态
-    if (bqPlayerPlay) {
-        (*bqPlayerPlay)->SetPlayState(bqPlayerPlay, SL_PLAYSTATE_STOPPED);
-        bqPlayerPlay = nullptr;
-    }
-
-    // 7.2 销毁播放器
-    if (bqPlayerObject) {
-        (*bqPlayerObject)->Destroy(bqPlayerObject);
-        bqPlayerObject = nullptr;
-        bqPlayerBufferQueue = nullptr;
-    }
-
-    // 7.3 销毁混音器
-    if (outputMixObject) {
-        (*outputMixObject)->Destroy(outputMixObject);
-        outputMixObject = nullptr;
-    }
+    // 此处需要等待解码线程和播放线程全部停止，才可以释放资源。形成非分离线程
+    pthread_join(pid_audio_decode, nullptr);
+    pthread_join(pid_audio_play, nullptr);
 
-    // 7.4 销毁引擎
-    if (engineObject) {
-        (*engineObject)->Destroy(engineObject);
-        engineObject = nullptr;
-        engineInterface = nullptr;
+    // 音频输出释放工作
+    if (sink) {
+        sink->stop();
+        DELETE(sink)
     }
 
     // 队列清空
@@ -113,7 +126,8 @@ void AudioChannel::audio_decode() {
             continue;
         }
 
-        int result = packets.popQueueAndDel(packet); // 阻塞式队列
+        int packet_serial = 0;
+        int result = packets.popQueueAndDel(packet, &packet_serial); // 阻塞式队列
 
         if (!is_playing) { // 用户停止播放,跳出循环并释放资源。
             break;
@@ -123,45 +137,63 @@ void AudioChannel::audio_decode() {
             continue;
         }
 
-        // 把packet解码成frame，需要把packet给ffmpeg内的缓冲区，再获取frame。
-        result = avcodec_send_packet(codecContext, packet);
+        if (isStalePacket(packet_serial)) {
+            // seek之前读取的压缩包，不再解码。
+            av_packet_unref(packet);
+            releaseAVPacket(&packet);
+            continue;
+        }
+        onPacketDequeued(packet);
 
-        //avcodec_send_packet 会把packet进行深拷贝，所以可以直接在这里释放。
-//        releaseAVPacket(&packet); // 这里的释放是释放对象本身。
+        // 结束标记：传入空包让解码器进入冲刷模式，输出内部缓存的所有帧。
+        bool eof = isEofPacket(packet);
 
+        // 把packet解码成frame，需要把packet给ffmpeg内的缓冲区，再获取frame。
+        result = avcodec_send_packet(codecContext, eof ? nullptr : packet);
+
+        // avcodec_send_packet 会对packet的数据增加引用（或深拷贝），所以可以直接在这里释放。
+        // 此时把packet完全释放。释放packet对象，和packet成员指向的空间。 先释放内部成员，再释放本身。
+        av_packet_unref(packet); // AVPacket对象成员中，也存在开辟堆空间的指针，所以需要用api把对象成员的堆空间释放。
+        releaseAVPacket(&packet);
 
         if (result != 0) {
             //这里各种异常
             break;
         }
 
-        AVFrame *frame = av_frame_alloc();
-        result = avcodec_receive_frame(codecContext, frame);
-
-        // 进行异常判断
-        if (result == AVERROR(EAGAIN)) {
-            // IBP的理论???
-            // 当不是关键帧时，无法通过单独的一帧解码。所以可以继续，参考下一帧进行解码。
-            continue;
-        } else if (result != 0) {// 失败
-            if (frame) {
+        // 一个压缩包可能包含多个音频帧，循环取出。
+        while (true) {
+            AVFrame *frame = av_frame_alloc();
+            result = avcodec_receive_frame(codecContext, frame);
+            if (result != 0) {
+                releaseAVFrame(&frame);
+                break;
+            }
+            if (discardBeforeSeekTarget(frame)) {
                 av_frame_unref(frame);
                 releaseAVFrame(&frame);
+                continue;
             }
-            break;
+            frames.insertToQueue(frame, decoder_serial);
         }
 
-        frames.insertToQueue(frame);
-
-        // 此时把packet完全释放。释放packet对象，和packet成员指向的空间。 先释放内部成员，再释放本身。
-        av_packet_unref(packet); // AVPacket对象成员中，也存在开辟堆空间的指针，所以需要用api把对象成员的堆空间释放。
-        releaseAVPacket(&packet);
+        if (result == AVERROR_EOF) {
+            // 解码器已冲刷完毕，把结束标记交给播放端。重置解码器，之后seek还可以继续解码。
+            frames.insertToQueue(createEofFrame(), decoder_serial);
+            avcodec_flush_buffers(codecContext);
+            continue;
+        }
 
+        if (result != AVERROR(EAGAIN)) { // EAGAIN 表示需要更多的压缩包，其他为失败
+            break;
+        }
     }
 
     is_playing = false;
-    av_packet_unref(packet);
-    releaseAVPacket(&packet);
+    if (packet) {
+        av_packet_unref(packet);
+        releaseAVPacket(&packet);
+    }
 }
 
 void *task_audio_play(void *args) {
@@ -171,186 +203,51 @@ void *task_audio_play(void *args) {
 }
 
 /**
- * 回调函数
+ * 输出端拉取PCM的回调函数
  *
- * @param bq 缓冲池队列接口
- * @param args 给回调函数的参数
+ * @param args AudioChannel
+ * @param pcm_data 重采样后的PCM数据
+ * @return PCM数据对应的大小
  */
-void bqPlayerCallback(SLAndroidSimpleBufferQueueItf bq, void *args) {
+int audio_pcm_callback(void *args, uint8_t **pcm_data) {
     auto *audio_channel = static_cast<AudioChannel *>(args);
 
     int pcm_size = 0;
     audio_channel->getPcm(&pcm_size);
-
-    // 添加数据到缓冲区
-    (*bq)->Enqueue(bq,
-                   audio_channel->out_buffers, // PCM数据(重采样后的数据)
-                   pcm_size// PCM数据对应的大小(重采样后的缓冲区大小)
-    );
+    *pcm_data = audio_channel->out_buffers;
+
+    if (pcm_size > 0 && !audio_channel->first_audio_time) {
+        // 统计从start到第一段PCM交给输出的耗时，其中包含了输出设备（OpenSL引擎）的准备时间。
+        audio_channel->first_audio_time = av_gettime_relative() - audio_channel->start_time;
+        LOGD("首段音频耗时 %lld ms，其中输出设备准备 %lld ms\n",
+             (long long) audio_channel->first_audio_time / 1000,
+             (long long) (audio_channel->sink ? audio_channel->sink->setup_time / 1000 : 0))
+    }
+    return pcm_size;
 }
 
 /**
- * 音频播放可以使用OpenSL
- * 可以直接在C++层进行播放。
- * 进行了硬件加速。
+ * 创建音频输出并开始播放。
+ * 默认使用OpenSL播放，也可以输出到空设备或wav文件，方便在没有声卡的环境中测量音频链路。
  */
 void AudioChannel::audio_play() {
-    SLresult result; // 执行成功或失败的返回值
-
-    // 第一步，创建引擎并获取引擎接口
-    // 1.1 创建引擎对象：SLObjectItf
-    result = slCreateEngine(&engineObject, 0, 0, 0, 0, 0);
-    if (SL_RESULT_SUCCESS != result) {
-        LOGD("创建sl引擎engineObject失败.")
-        return;
-    }
-    // 1.2 初始化引擎
-    result = (*engineObject)->Realize(engineObject, // sl引擎
-                                      false); // 延迟等待，等创建成功。（初始化是否异步）
-    if (SL_RESULT_SUCCESS != result) {
-        LOGD("初始化sl引擎engineObject失败.")
-        return;
-    }
-    // 1.3 获取引擎接口
-    result = (*engineObject)->GetInterface(engineObject, // sl引擎
-                                           SL_IID_ENGINE, // 引擎id
-                                           &engineInterface // 引擎接口
-    );
-    if (SL_RESULT_SUCCESS != result) {
-        LOGD("获取sl引擎接口engineInterface失败.")
-        return;
-    }
-    if (!engineInterface) {
-        LOGD("sl引擎接口engineInterface为NULL.")
-        return;
-    }
-    LOGD("获取sl引擎接口engineInterface成功.")
-
-    // 第二步，设置混音器
-    // 2.1 创建混音器对象
-    result = (*engineInterface)->CreateOutputMix(engineInterface, // 引擎接口
-                                                 &outputMixObject, // 混音器对象
-                                                 0, // 环境特效
-                                                 0, // 混响特效
-                                                 0); // 其他什么特效
-    if (SL_RESULT_SUCCESS != result) {
-        LOGD("创建混音器outputMixObject失败.")
-        return;
-    }
-    // 2.2 初始化混音器对象
-    result = (*outputMixObject)->Realize(outputMixObject,  // 混音器对象
-                                         false); // 是否异步初始化
-    if (SL_RESULT_SUCCESS != result) {
-        LOGD("初始化混音器outputMixObject失败.")
-        return;
-    }
-
-    // 不启用混响可以不用获取混音器接口 【声音的效果】
-    // 获得混音器接口
-    /*
-    result = (*outputMixObject)->GetInterface(outputMixObject, SL_IID_ENVIRONMENTALREVERB,
-                                             &outputMixEnvironmentalReverb);
-    if (SL_RESULT_SUCCESS == result) {
-    // 设置混响 ： 默认。
-    SL_I3DL2_ENVIRONMENT_PRESET_ROOM: 室内
-    SL_I3DL2_ENVIRONMENT_PRESET_AUDITORIUM : 礼堂 等
-    const SLEnvironmentalReverbSettings settings = SL_I3DL2_ENVIRONMENT_PRESET_DEFAULT;
-    (*outputMixEnvironmentalReverb)->SetEnvironmentalReverbProperties(
-           outputMixEnvironmentalReverb, &settings);
+    sink = AudioSink::create(sink_type, sink_path);
+    sink->setPcmCallback(audio_pcm_callback, this);
+    sink->setGain(gain, mute);
+    if (!sink->open(out_sample_rate, out_channels, out_sample_size)) {
+        // 没有输出时改用按实时速度消费的空输出：没有声音，但是音频时钟照常前进，视频不会停住
+        LOGD("打开音频输出失败 type = %d，改用空输出\n", sink_type)
+        DELETE(sink)
+        sink = AudioSink::create(AUDIO_SINK_NULL, nullptr);
+        sink->setPcmCallback(audio_pcm_callback, this);
+        sink->open(out_sample_rate, out_channels, out_sample_size);
     }
-    */
-    LOGD("2、设置混音器 Success");
-
-    // 第三步，创建播放器
-    // 播放器的声音卡顿和画面卡顿的本质一致。60帧的速率，16ms会从缓冲区获取一次声音数据，如果没有数据那么就会产生卡顿。
-    // 3.1 创建缓冲队列buffer。
-    SLDataLocator_AndroidSimpleBufferQueue loc_buf = {
-            SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE,
-            10// 10个大小
-    };
-    // 注，PCM无法直接播放，因为它不包含数据参数（采样率、采样格式等等）。
-    // 注，另外需要把声音转换为扬声器支持的格式，所以需要重采样。
-
-    // pcm数据格式 == PCM是不能直接播放，mp3可以直接播放(参数集)，人家不知道PCM的参数
-    // SL_DATAFORMAT_PCM：数据格式为pcm格式
-    // 2：双声道
-    // SL_SAMPLINGRATE_44_1：采样率为44100 （每秒钟采样44100个点，采样率越高失真越小）
-    // SL_PCMSAMPLEFORMAT_FIXED_16：采样格式为16bit （每个采样点为16bit，大小）
-    // SL_PCMSAMPLEFORMAT_FIXED_16：数据大小为16bit
-    // SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT：左右声道（双声道）
-    // SL_BYTEORDER_LITTLEENDIAN：小端模式
-    SLDataFormat_PCM format_pcm = {SL_DATAFORMAT_PCM, // PCM数据格式
-                                   2, // 声道数
-                                   SL_SAMPLINGRATE_44_1, // 采样率（每秒44100个点）
-                                   SL_PCMSAMPLEFORMAT_FIXED_16, // 每秒采样样本 存放大小 16bit
-                                   SL_PCMSAMPLEFORMAT_FIXED_16, // 每个样本位数 16bit
-                                   SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT, // 前左声道  前右声道
-                                   SL_BYTEORDER_LITTLEENDIAN}; // 字节序(小端) 例如：int类型四个字节（到底是 高位在前 还是 低位在前 的排序方式，一般我们都是小端）
-
-    // 数据源 将上述配置信息放到这个数据源中
-    // audioSrc最终配置音频信息的成果，给后面代码使用
-    SLDataSource audio_src = {&loc_buf, &format_pcm};
-    // 3.2 配置音轨（输出）
-    // 设置混音器
-    SLDataLocator_OutputMix loc_outmix = {SL_DATALOCATOR_OUTPUTMIX,
-                                          outputMixObject}; // SL_DATALOCATOR_OUTPUTMIX:输出混音器类型
-    SLDataSink audioSnk = {&loc_outmix, NULL}; // outmix最终混音器的成果，给后面代码使用
-    // 需要的接口 操作队列的接口
-    const SLInterfaceID ids[1] = {SL_IID_BUFFERQUEUE};
-    const SLboolean req[1] = {SL_BOOLEAN_TRUE};
-
-    // 3.3 创建播放器 SLObjectItf bqPlayerObject
-    result = (*engineInterface)->CreateAudioPlayer(engineInterface, // 参数1：引擎接口
-                                                   &bqPlayerObject, // 参数2：播放器
-                                                   &audio_src, // 参数3：音频配置信息
-                                                   &audioSnk, // 参数4：混音器
-
-            // 下面代码都是 打开队列的工作
-                                                   1, // 参数5：开放的参数的个数
-                                                   ids,  // 参数6：代表我们需要 Buff
-                                                   req // 参数7：代表我们上面的Buff 需要开放出去
-    );
-    if (SL_RESULT_SUCCESS != result) {
-        LOGD("创建播放器bqPlayerObject失败.");
-        return;
-    }
-    // 3.4 初始化播放器
-    result = (*bqPlayerObject)->Realize(bqPlayerObject, SL_BOOLEAN_FALSE);
-    if (SL_RESULT_SUCCESS != result) {
-        LOGD("初始化播放器bqPlayerObject失败.");
-        return;
-    }
-    // 3.5 获取播放器接口 【以后播放全部使用 播放器接口（核心）】
-    result = (*bqPlayerObject)->GetInterface(bqPlayerObject, SL_IID_PLAY,
-                                             &bqPlayerPlay); // SL_IID_PLAY:播放接口 == iplayer
-    if (SL_RESULT_SUCCESS != result) {
-        LOGD("获取播放接口 GetInterface SL_IID_PLAY failed!");
-        return;
-    }
-
-    // 第四步，把播放器队列和声卡缓冲池队列进行绑定。方便我们向播放器队列添加数据时，缓冲池可以通过回调获取播放器队列中的数据。
-
-    // 4.1 获取播放器队列接口对象：SLAndroidSimpleBufferQueueItf bqPlayerBufferQueue  // 播放需要的队列
-    result = (*bqPlayerObject)->GetInterface(bqPlayerObject, SL_IID_BUFFERQUEUE,
-                                             &bqPlayerBufferQueue);
-    if (result != SL_RESULT_SUCCESS) {
-        LOGD("绑定播放队列 GetInterface SL_IID_BUFFERQUEUE failed!");
-        return;
-    }
-    // 4.2 给播放器队列接口对象设置回调函数。
-    (*bqPlayerBufferQueue)->RegisterCallback(bqPlayerBufferQueue,  // 传入刚刚设置好的队列
-                                             bqPlayerCallback,  // 回调函数
-                                             this); // 给回调函数的参数
-
-    // 第五步，设置播放器状态为播放状态。
-    (*bqPlayerPlay)->SetPlayState(bqPlayerPlay, SL_PLAYSTATE_PLAYING);
-
-    // 第六步，手动激活回调函数 (需要手动激活才可以让声卡驱动转起来。)
-    bqPlayerCallback(bqPlayerBufferQueue, this);
 }
 
 void AudioChannel::start() {
     is_playing = true;
+    start_time = av_gettime_relative();
+    first_audio_time = 0;
 
     packets.working(true);
     frames.working(true);
@@ -371,7 +268,16 @@ void AudioChannel::getPcm(int *p_int) {
     // 从frames队列中获取PCM数据。此时数据为PCM格式，并未重采样。
     AVFrame *frame = nullptr;
     while (is_playing) {
-        int ret = frames.popQueueAndDel(frame);
+        if (buffering || paused) {
+            // 缓冲或者暂停中：输出一小段（20ms）静音，音频时钟不前进，输出设备不停止。
+            pcm_data_size = out_sample_rate / 50 * out_sample_size * out_channels;
+            memset(out_buffers, 0, pcm_data_size);
+            *p_int = pcm_data_size;
+            return;
+        }
+
+        int frame_serial = 0;
+        int ret = frames.popQueueAndDel(frame, &frame_serial);
         if (!is_playing) {
             break; // 如果关闭了播放，跳出循环，releaseAVPacket(&pkt);
         }
@@ -379,6 +285,26 @@ void AudioChannel::getPcm(int *p_int) {
             continue; // 哪怕是没有成功，也要继续（假设：你生产太慢(原始包加入队列)，我消费就等一下你）
         }
 
+        if (isStaleFrame(frame_serial)) {
+            // seek之前解码的帧，不再重采样和播放。
+            av_frame_unref(frame);
+            releaseAVFrame(&frame);
+            continue;
+        }
+
+        if (isEofFrame(frame)) {
+            // 解码线程送来的结束标记，音频播放完成。继续等待（seek之后还会有新的数据）。
+            releaseAVFrame(&frame);
+            notifyCompleted();
+            continue;
+        }
+
+        if (!ensureResampler(frame)) {
+            av_frame_unref(frame);
+            releaseAVFrame(&frame);
+            continue;
+        }
+
         // 开始重采样
 
         // 来源：10个48000   ---->  目标:44100  11个44100
@@ -389,6 +315,15 @@ void AudioChannel::getPcm(int *p_int) {
                                             frame->sample_rate, // 输入采样率
                                             AV_ROUND_UP); // 先上取 取去11个才能容纳的上
 
+        // 直播追赶延时：重采样时少输出一部分样本，播放变快，音频时钟（视频同步的基准）随之加快。
+        if (speedup) {
+            swr_set_compensation(swr_ctx, -dst_nb_samples * SPEEDUP_PERCENT / 100, dst_nb_samples);
+            compensating = true;
+        } else if (compensating) {
+            swr_set_compensation(swr_ctx, 0, 0);
+            compensating = false;
+        }
+
         // pcm的处理逻辑
         // 音频播放器的数据格式是我们自己在下面定义的
         // 而原始数据（待播放的音频pcm数据）
@@ -408,7 +343,11 @@ void AudioChannel::getPcm(int *p_int) {
         *p_int = pcm_data_size;
 
         // audio_time 获取的是当前时间戳，乘以时间基之后，单位变成秒.
-        audio_time = frame->best_effort_timestamp * av_q2d(time_base);
+        // 减去输出中还没有播放出来的数据（混音器的缓冲区等），视频与听到的声音同步。
+        audio_time = frame->best_effort_timestamp * av_q2d(time_base) - (sink ? sink->latency() : 0);
+        play_ts = frame->best_effort_timestamp;
+
+        onFirstFrameAfterSeek();
 
         if(this->helper) {
             this->helper->onProgress(THREAD_CHILD, audio_time);
@@ -420,3 +359,31 @@ void AudioChannel::getPcm(int *p_int) {
     av_frame_unref(frame);
     releaseAVFrame(&frame);
 }
+
+/**
+ * 设置音频输出，需要在start之前调用。
+ * @param type AUDIO_SINK_XXX
+ * @param path AUDIO_SINK_WAV 时的文件路径
+ */
+void AudioChannel::setAudioSink(int type, const char *path) {
+    this->sink_type = type;
+    if (sink_path) {
+        delete[] sink_path;
+        sink_path = nullptr;
+    }
+    if (path) {
+        sink_path = new char[strlen(path) + 1];
+        strcpy(sink_path, path);
+    }
+}
+
+/**
+ * 设置增益和静音，可以在播放过程中调用。
+ */
+void AudioChannel::setGain(float gain, bool mute) {
+    this->gain = gain;
+    this->mute = mute;
+    if (sink) {
+        sink->setGain(gain, mute);
+    }
+}
@@ -1,9 +1,9 @@
 #ifndef VIDEOPLAYER_AUDIOCHANNEL_H
 #define VIDEOPLAYER_AUDIOCHANNEL_H
 
+#include <cstring>
 #include "BaseChannel.h"
-#include <SLES/OpenSLES.h>
-#include <SLES/OpenSLES_Android.h>
+#include "AudioSink.h"
 #include "Log.h"
 #include "JNICallbackHelper.h"
 
@@ -11,6 +11,8 @@ extern "C" {
 #include <libswresample/swresample.h> // 对pcm数据进行转换（重采样）？？？
 };
 
+#define SPEEDUP_PERCENT 5 // 追赶直播延时时加快播放的百分比
+
 class AudioChannel : public BaseChannel {
 
 private:
@@ -25,23 +27,23 @@ public:
     uint8_t *out_buffers = 0; // 无符号int类型
 
     SwrContext * swr_ctx = 0;
+    int in_sample_fmt = AV_SAMPLE_FMT_NONE; // 重采样输入的采样格式
+    int in_sample_rate = 0; // 重采样输入的采样率
+    uint64_t in_channel_layout = 0; // 重采样输入的声道布局
 
     double audio_time; // 音频时间戳,当前播放的时间戳。
 
-public:
-    //引擎
-    SLObjectItf engineObject = 0;
-    // 引擎接口
-    SLEngineItf engineInterface = 0;
-    // 混音器
-    SLObjectItf outputMixObject = 0;
-    // 播放器
-    SLObjectItf bqPlayerObject = 0;
-    // 播放器接口
-    SLPlayItf bqPlayerPlay = 0;
-
-    // 播放器队列接口
-    SLAndroidSimpleBufferQueueItf bqPlayerBufferQueue = 0;
+    int sink_type = AUDIO_SINK_OPENSL; // 音频输出类型
+    char *sink_path = 0; // AUDIO_SINK_WAV 时的文件路径
+    AudioSink *sink = 0; // 音频输出
+    float gain = 1.0f; // 增益 0.0 ~ 1.0（输出支持时生效，如混音器）
+    bool mute = false; // 是否静音
+
+    volatile bool speedup = false; // 加快播放（直播延时超过目标时追赶）
+    bool compensating = false; // 重采样器是否设置了变速补偿
+
+    int64_t start_time = 0; // 调用start的时间，单位微秒
+    int64_t first_audio_time = 0; // 首段PCM交给输出的耗时（time-to-first-audio），单位微秒
 
 public:
     AudioChannel(int, AVCodecContext *, AVRational);
@@ -59,6 +61,12 @@ public:
 
     void getPcm(int *);
 
+    bool ensureResampler(AVFrame *frame);
+
+    void setAudioSink(int type, const char *path);
+
+    void setGain(float gain, bool mute);
+
 };
 
 #endif //VIDEOPLAYER_AUDIOCHANNEL_H
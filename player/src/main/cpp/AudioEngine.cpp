@@ -0,0 +1,134 @@
+#include "AudioEngine.h"
+
+extern "C" {
+#include <libavutil/time.h>
+};
+
+pthread_mutex_t AudioEngine::mutex = PTHREAD_MUTEX_INITIALIZER; // 静态初始化互斥锁
+AudioEngine *AudioEngine::instance = nullptr;
+
+AudioEngine *AudioEngine::acquire(int64_t *setup_time) {
+    int64_t begin = av_gettime_relative();
+
+    pthread_mutex_lock(&mutex);
+    if (!instance) {
+        instance = new AudioEngine();
+        if (!instance->create()) {
+            instance->destroy();
+            delete instance;
+            instance = nullptr;
+            pthread_mutex_unlock(&mutex);
+            return nullptr;
+        }
+    }
+    instance->ref_count++;
+    AudioEngine *engine = instance;
+    pthread_mutex_unlock(&mutex);
+
+    if (setup_time) {
+        *setup_time = av_gettime_relative() - begin;
+    }
+    return engine;
+}
+
+void AudioEngine::release() {
+    pthread_mutex_lock(&mutex);
+    if (instance && instance->ref_count > 0) {
+        instance->ref_count--;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void AudioEngine::shutdown() {
+    pthread_mutex_lock(&mutex);
+    if (instance && instance->ref_count <= 0) {
+        instance->destroy();
+        delete instance;
+        instance = nullptr;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+bool AudioEngine::create() {
+    SLresult result; // 执行成功或失败的返回值
+
+    // 第一步，创建引擎并获取引擎接口
+    // 1.1 创建引擎对象：SLObjectItf
+    result = slCreateEngine(&engineObject, 0, 0, 0, 0, 0);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGD("创建sl引擎engineObject失败.")
+        return false;
+    }
+    // 1.2 初始化引擎
+    result = (*engineObject)->Realize(engineObject, // sl引擎
+                                      false); // 延迟等待，等创建成功。（初始化是否异步）
+    if (SL_RESULT_SUCCESS != result) {
+        LOGD("初始化sl引擎engineObject失败.")
+        return false;
+    }
+    // 1.3 获取引擎接口
+    result = (*engineObject)->GetInterface(engineObject, // sl引擎
+                                           SL_IID_ENGINE, // 引擎id
+                                           &engineInterface // 引擎接口
+    );
+    if (SL_RESULT_SUCCESS != result) {
+        LOGD("获取sl引擎接口engineInterface失败.")
+        return false;
+    }
+    if (!engineInterface) {
+        LOGD("sl引擎接口engineInterface为NULL.")
+        return false;
+    }
+    LOGD("获取sl引擎接口engineInterface成功.")
+
+    // 第二步，设置混音器
+    // 2.1 创建混音器对象
+    result = (*engineInterface)->CreateOutputMix(engineInterface, // 引擎接口
+                                                 &outputMixObject, // 混音器对象
+                                                 0, // 环境特效
+                                                 0, // 混响特效
+                                                 0); // 其他什么特效
+    if (SL_RESULT_SUCCESS != result) {
+        LOGD("创建混音器outputMixObject失败.")
+        return false;
+    }
+    // 2.2 初始化混音器对象
+    result = (*outputMixObject)->Realize(outputMixObject,  // 混音器对象
+                                         false); // 是否异步初始化
+    if (SL_RESULT_SUCCESS != result) {
+        LOGD("初始化混音器outputMixObject失败.")
+        return false;
+    }
+
+    // 不启用混响可以不用获取混音器接口 【声音的效果】
+    // 获得混音器接口
+    /*
+    result = (*outputMixObject)->GetInterface(outputMixObject, SL_IID_ENVIRONMENTALREVERB,
+                                             &outputMixEnvironmentalReverb);
+    if (SL_RESULT_SUCCESS == result) {
+    // 设置混响 ： 默认。
+    SL_I3DL2_ENVIRONMENT_PRESET_ROOM: 室内
+    SL_I3DL2_ENVIRONMENT_PRESET_AUDITORIUM : 礼堂 等
+    const SLEnvironmentalReverbSettings settings = SL_I3DL2_ENVIRONMENT_PRESET_DEFAULT;
+    (*outputMixEnvironmentalReverb)->SetEnvironmentalReverbProperties(
+           outputMixEnvironmentalReverb, &settings);
+    }
+    */
+    LOGD("2、设置混音器 Success");
+    return true;
+}
+
+void AudioEngine::destroy() {
+    // 销毁混音器
+    if (outputMixObject) {
+        (*outputMixObject)->Destroy(outputMixObject);
+        outputMixObject = nullptr;
+    }
+
+    // 销毁引擎
+    if (engineObject) {
+        (*engineObject)->Destroy(engineObject);
+        engineObject = nullptr;
+        engineInterface = nullptr;
+    }
+}
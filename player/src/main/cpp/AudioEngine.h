@@ -0,0 +1,57 @@
+#ifndef VIDEOPLAYER_AUDIOENGINE_H
+#define VIDEOPLAYER_AUDIOENGINE_H
+
+#include <pthread.h>
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
+#include "Log.h"
+
+/**
+ * 进程内共享的OpenSL引擎和混音器。
+ *
+ * 引擎和混音器的创建/初始化需要几十毫秒，并且每个播放器各自创建会成倍占用资源。
+ * 所以第一个使用者创建，各个播放器只创建轻量的AudioPlayer。
+ * 最后一个使用者释放后引擎仍然保留，下一个播放器（切换视频、重新prepare）不再重新创建，
+ * 库卸载（JNI_OnUnload）时才销毁。引用计数只用于确认销毁时没有使用者。
+ */
+class AudioEngine {
+
+private:
+    static pthread_mutex_t mutex;
+    static AudioEngine *instance;
+
+    int ref_count = 0;
+
+    AudioEngine() {}
+
+    bool create();
+
+    void destroy();
+
+public:
+    //引擎
+    SLObjectItf engineObject = 0;
+    // 引擎接口
+    SLEngineItf engineInterface = 0;
+    // 混音器
+    SLObjectItf outputMixObject = 0;
+
+    /**
+     * 获取引擎，引用计数+1
+     * @param setup_time 输出本次获取的耗时（微秒），引擎已存在时接近0
+     * @return 失败返回nullptr
+     */
+    static AudioEngine *acquire(int64_t *setup_time);
+
+    /**
+     * 释放引擎，引用计数-1。为0时不销毁，留给之后的播放器
+     */
+    static void release();
+
+    /**
+     * 销毁引擎和混音器，在库卸载时调用。还有使用者时不销毁
+     */
+    static void shutdown();
+};
+
+#endif //VIDEOPLAYER_AUDIOENGINE_H
@@ -0,0 +1,243 @@
+#include <cstring>
+#include "AudioMixer.h"
+#include "util.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+MixerSource::MixerSource(int capacity) {
+    this->capacity = capacity;
+    buffer = new int16_t[capacity];
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&cond, nullptr);
+}
+
+MixerSource::~MixerSource() {
+    delete[] buffer;
+    buffer = nullptr;
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&cond);
+}
+
+void MixerSource::write(const int16_t *data, int count) {
+    pthread_mutex_lock(&mutex);
+    while (work && count > 0) {
+        int space = capacity - (int) (write_pos - read_pos);
+        if (space == 0) {
+            pthread_cond_wait(&cond, &mutex); // 缓冲区已满，等待混音器消费
+            continue;
+        }
+        int n = count < space ? count : space;
+        for (int i = 0; i < n; i++) {
+            buffer[(write_pos + i) % capacity] = data[i];
+        }
+        write_pos += n;
+        data += n;
+        count -= n;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+int MixerSource::queued() {
+    pthread_mutex_lock(&mutex);
+    int count = (int) (write_pos - read_pos);
+    pthread_mutex_unlock(&mutex);
+    return count;
+}
+
+int MixerSource::read(int16_t *data, int count) {
+    pthread_mutex_lock(&mutex);
+    int available = (int) (write_pos - read_pos);
+    int n = count < available ? count : available;
+    int offset = (int) (read_pos % capacity);
+    int first = n < capacity - offset ? n : capacity - offset; // 环形缓冲区可能需要分两段拷贝
+    memcpy(data, buffer + offset, first * sizeof(int16_t));
+    memcpy(data + first, buffer, (n - first) * sizeof(int16_t));
+    read_pos += n;
+    if (n < count) {
+        underrun_samples += count - n;
+    }
+    pthread_cond_signal(&cond); // 腾出了空间，唤醒生产者
+    pthread_mutex_unlock(&mutex);
+    return n;
+}
+
+void MixerSource::stop() {
+    pthread_mutex_lock(&mutex);
+    work = false;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * 把src乘以增益后累加到dst，结果饱和到int16范围（不会溢出回绕产生爆音）。
+ * ARM上使用NEON一次处理8个采样，x86主机上使用SSE2，其余情况逐个计算。
+ *
+ * @param gain Q15定点数增益
+ */
+static void mix_accumulate(int16_t *dst, const int16_t *src, int count, int16_t gain) {
+    int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int16x8_t gain_vec = vdupq_n_s16(gain);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t s = vld1q_s16(src + i);
+        if (gain != INT16_MAX) {
+            s = vqrdmulhq_s16(s, gain_vec); // (s * gain) >> 15，带舍入和饱和
+        }
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), s)); // 饱和加
+    }
+#elif defined(__SSE2__)
+    __m128i gain_vec = _mm_set1_epi16(gain);
+    for (; i + 8 <= count; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        if (gain != INT16_MAX) {
+            s = _mm_slli_epi16(_mm_mulhi_epi16(s, gain_vec), 1); // 约等于 (s * gain) >> 15
+        }
+        __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_adds_epi16(d, s)); // 饱和加
+    }
+#endif
+    for (; i < count; i++) {
+        int32_t value = dst[i] + ((src[i] * gain + (1 << 14)) >> 15);
+        if (value > INT16_MAX) {
+            value = INT16_MAX;
+        } else if (value < INT16_MIN) {
+            value = INT16_MIN;
+        }
+        dst[i] = (int16_t) value;
+    }
+}
+
+pthread_mutex_t AudioMixer::mutex = PTHREAD_MUTEX_INITIALIZER; // 静态初始化互斥锁
+AudioMixer *AudioMixer::instance = nullptr;
+int AudioMixer::output_type = AUDIO_SINK_OPENSL;
+char *AudioMixer::output_path = nullptr;
+AudioSink *AudioMixer::output_sink = nullptr;
+
+AudioMixer::AudioMixer() {
+    mix_buffer = new int16_t[MIX_SAMPLES];
+    source_buffer = new int16_t[MIX_SAMPLES];
+    pthread_mutex_init(&sources_mutex, nullptr);
+}
+
+AudioMixer::~AudioMixer() {
+    DELETE(output)
+    delete[] mix_buffer;
+    delete[] source_buffer;
+    pthread_mutex_destroy(&sources_mutex);
+}
+
+/**
+ * 输出拉取PCM的回调函数
+ */
+int audio_mixer_callback(void *args, uint8_t **data) {
+    auto *mixer = static_cast<AudioMixer *>(args);
+    return mixer->mix(data);
+}
+
+int AudioMixer::mix(uint8_t **data) {
+    memset(mix_buffer, 0, MIX_SAMPLES * sizeof(int16_t));
+
+    pthread_mutex_lock(&sources_mutex);
+    for (MixerSource *source : sources) {
+        // 静音的输入也要读取，保持与其他输入同步消费，只是不累加。
+        int n = source->read(source_buffer, MIX_SAMPLES);
+        if (source->mute || source->gain <= 0) {
+            continue;
+        }
+        mix_accumulate(mix_buffer, source_buffer, n, (int16_t) source->gain);
+    }
+    pthread_mutex_unlock(&sources_mutex);
+
+    *data = reinterpret_cast<uint8_t *>(mix_buffer);
+    return MIX_SAMPLES * SAMPLE_SIZE; // 即使没有数据也输出静音，保证输出持续回调
+}
+
+void AudioMixer::setOutput(int type, const char *path) {
+    pthread_mutex_lock(&mutex);
+    output_type = type;
+    if (output_path) {
+        delete[] output_path;
+        output_path = nullptr;
+    }
+    if (path) {
+        output_path = new char[strlen(path) + 1];
+        strcpy(output_path, path);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void AudioMixer::setOutputSink(AudioSink *sink) {
+    pthread_mutex_lock(&mutex);
+    DELETE(output_sink)
+    output_sink = sink;
+    pthread_mutex_unlock(&mutex);
+}
+
+MixerSource *AudioMixer::addSource() {
+    auto *source = new MixerSource(SAMPLE_RATE * CHANNELS / 4); // 缓冲250ms
+
+    pthread_mutex_lock(&mutex);
+    bool first = instance == nullptr;
+    if (first) {
+        instance = new AudioMixer();
+    }
+    pthread_mutex_lock(&instance->sources_mutex);
+    instance->sources.push_back(source);
+    pthread_mutex_unlock(&instance->sources_mutex);
+
+    if (first) {
+        // 第一路输入加入时打开唯一的输出
+        if (output_sink) {
+            instance->output = output_sink;
+            output_sink = nullptr;
+        } else {
+            instance->output = AudioSink::create(output_type, output_path);
+        }
+        instance->output->setPcmCallback(audio_mixer_callback, instance);
+        if (!instance->output->open(SAMPLE_RATE, CHANNELS, SAMPLE_SIZE)) {
+            LOGD("打开混音器输出失败 type = %d\n", output_type)
+            // 没有输出就没有人消费输入，播放器会阻塞在写入上，直接失败交给播放器处理
+            delete instance;
+            instance = nullptr;
+            delete source;
+            source = nullptr;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    return source;
+}
+
+void AudioMixer::removeSource(MixerSource *source) {
+    source->stop();
+
+    AudioMixer *released = nullptr;
+    pthread_mutex_lock(&mutex);
+    if (instance) {
+        pthread_mutex_lock(&instance->sources_mutex);
+        for (auto it = instance->sources.begin(); it != instance->sources.end(); it++) {
+            if (*it == source) {
+                instance->sources.erase(it);
+                break;
+            }
+        }
+        bool empty = instance->sources.empty();
+        pthread_mutex_unlock(&instance->sources_mutex);
+        if (empty) {
+            released = instance;
+            instance = nullptr;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+
+    // 在锁外关闭输出，输出的回调线程可能正在等待sources_mutex。
+    if (released) {
+        released->output->stop();
+        delete released;
+    }
+    LOGD("混音输入移除，静音填充采样数 %lld\n", (long long) source->underrun_samples)
+    delete source;
+}
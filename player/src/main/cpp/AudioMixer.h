@@ -0,0 +1,116 @@
+#ifndef VIDEOPLAYER_AUDIOMIXER_H
+#define VIDEOPLAYER_AUDIOMIXER_H
+
+#include <vector>
+#include <pthread.h>
+#include "AudioSink.h"
+#include "Log.h"
+
+/**
+ * 混音器的一路输入：一个播放器重采样后的PCM环形缓冲区（16bit交错采样）。
+ *
+ * 生产者（播放器）写满时阻塞等待，消费者（混音器）从不阻塞，数据不够时按静音处理。
+ */
+class MixerSource {
+
+private:
+    int16_t *buffer = 0;
+    int capacity; // 缓冲区能容纳的采样数（所有声道）
+    int64_t read_pos = 0; // 累计读取的采样数
+    int64_t write_pos = 0; // 累计写入的采样数
+    bool work = true;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+public:
+    volatile int gain = 32767; // 增益，Q15定点数，32767 约等于 1.0
+    volatile bool mute = false; // 是否静音
+    int64_t underrun_samples = 0; // 混音时数据不足，用静音填充的采样数
+
+    explicit MixerSource(int capacity);
+
+    virtual ~MixerSource();
+
+    /**
+     * 写入PCM，缓冲区满时阻塞，直到全部写入或者停止工作。
+     */
+    void write(const int16_t *data, int count);
+
+    /**
+     * 读取PCM，不阻塞。
+     * @return 实际读取的采样数
+     */
+    int read(int16_t *data, int count);
+
+    /**
+     * @return 已经写入还没有被混音器读取的采样数
+     */
+    int queued();
+
+    /**
+     * 停止工作，唤醒阻塞的生产者。
+     */
+    void stop();
+};
+
+/**
+ * 进程内共享的软件混音器。
+ *
+ * 多个播放器（多画面）的声音各自写入一个MixerSource，混音器只打开一个输出，
+ * 在输出的回调中把各路PCM按增益累加（饱和运算）后交给输出。
+ * 与AudioEngine一样由引用计数管理：第一路输入加入时打开输出，最后一路离开时关闭输出。
+ */
+class AudioMixer {
+
+private:
+    static pthread_mutex_t mutex;
+    static AudioMixer *instance;
+    static int output_type; // 混音器输出类型 AUDIO_SINK_XXX
+    static char *output_path;
+    static AudioSink *output_sink; // 直接指定的输出，为空时按output_type创建
+
+    AudioSink *output = 0;
+    std::vector<MixerSource *> sources;
+    pthread_mutex_t sources_mutex; // 保护sources，混音回调和加入/移除输入会并发
+    int16_t *mix_buffer = 0; // 混音结果
+    int16_t *source_buffer = 0; // 从输入读取的临时数据
+
+    AudioMixer();
+
+    virtual ~AudioMixer();
+
+public:
+    static const int SAMPLE_RATE = 44100;
+    static const int CHANNELS = 2;
+    static const int SAMPLE_SIZE = 2; // 16bit
+    static const int MIX_SAMPLES = 1024 * CHANNELS; // 一次混音的采样数（所有声道），1024个采样点，约23ms
+
+    /**
+     * 设置混音器的输出，在第一路输入加入之前调用。默认是OpenSL，主机上可以用空输出驱动混音器。
+     */
+    static void setOutput(int type, const char *path);
+
+    /**
+     * 直接指定混音器的输出（如主机测试中检查混音结果的空输出），只用于下一次打开，优先于setOutput的类型。
+     * 输出交给混音器，最后一路输入离开时释放。
+     */
+    static void setOutputSink(AudioSink *sink);
+
+    /**
+     * 加入一路输入
+     * @return 第一路输入打开输出失败时返回空
+     */
+    static MixerSource *addSource();
+
+    /**
+     * 移除一路输入并释放
+     */
+    static void removeSource(MixerSource *source);
+
+    /**
+     * 输出拉取数据时调用，混合一段PCM
+     */
+    int mix(uint8_t **data);
+};
+
+#endif //VIDEOPLAYER_AUDIOMIXER_H
@@ -0,0 +1,31 @@
+#include "AudioSink.h"
+#ifdef __ANDROID__
+#include "OpenSLAudioSink.h"
+#endif
+#include "NullAudioSink.h"
+#include "WavAudioSink.h"
+#include "MixerAudioSink.h"
+
+AudioSink *AudioSink::create(int type, const char *path) {
+    switch (type) {
+        case AUDIO_SINK_NULL:
+            return new NullAudioSink(true);
+        case AUDIO_SINK_NULL_FREE_RUN:
+            return new NullAudioSink(false);
+        case AUDIO_SINK_WAV:
+            if (path) {
+                return new WavAudioSink(path);
+            }
+            LOGD("AUDIO_SINK_WAV 没有指定文件路径，改为空输出\n")
+            return new NullAudioSink(false);
+        case AUDIO_SINK_MIXER:
+            return new MixerAudioSink();
+        default:
+#ifdef __ANDROID__
+            return new OpenSLAudioSink();
+#else
+            // 主机上没有OpenSL ES，按实时速度的空输出代替声卡
+            return new NullAudioSink(true);
+#endif
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef VIDEOPLAYER_AUDIOSINK_H
+#define VIDEOPLAYER_AUDIOSINK_H
+
+#include <cstdint>
+
+#define AUDIO_SINK_OPENSL 0 // OpenSL ES 输出到声卡（默认）
+#define AUDIO_SINK_NULL 1 // 空输出，按实时速度消费PCM，不发声
+#define AUDIO_SINK_NULL_FREE_RUN 2 // 空输出，不限速（尽可能快），用于测量解码+重采样的吞吐
+#define AUDIO_SINK_WAV 3 // 把PCM写入wav文件
+#define AUDIO_SINK_MIXER 4 // 送入进程内共享的软件混音器，与其他播放器的声音合并为一路输出
+
+/**
+ * 拉取一段重采样后的PCM数据。
+ * 参数1：回调参数 参数2：输出PCM数据的地址
+ * 返回值：PCM数据的字节数，<= 0 表示当前没有数据（停止播放）。
+ */
+typedef int (*PcmCallback)(void *, uint8_t **);
+
+/**
+ * 音频输出的抽象。
+ *
+ * AudioChannel 只负责解码和重采样，声音最终输出到哪里由AudioSink决定。
+ * 所有的输出都是拉模式：由输出端按自己的节奏调用PcmCallback获取数据。
+ */
+class AudioSink {
+
+protected:
+    int sample_rate = 0; // 采样率
+    int channels = 0; // 声道数
+    int sample_size = 0; // 每个采样点的字节数
+
+    PcmCallback pcmCallback = 0;
+    void *args = 0; // 给pcmCallback的参数
+
+public:
+    int64_t setup_time = 0; // open中准备输出设备的耗时，单位微秒
+
+    virtual ~AudioSink() {}
+
+    void setPcmCallback(PcmCallback callback, void *callback_args) {
+        this->pcmCallback = callback;
+        this->args = callback_args;
+    }
+
+    /**
+     * 按照声音三要素打开输出，并开始拉取数据。
+     * @return 是否成功
+     */
+    virtual bool open(int sample_rate, int channels, int sample_size) = 0;
+
+    /**
+     * 停止拉取数据，并释放输出资源。
+     */
+    virtual void stop() = 0;
+
+    /**
+     * 设置增益和静音，默认不支持。
+     * @param gain 0.0 ~ 1.0
+     */
+    virtual void setGain(float gain, bool mute) {}
+
+    /**
+     * 已经从pcmCallback取走、还没有播放出来的时长，单位秒，默认为0。
+     * 音频时钟减去该时长才是正在听到的位置。
+     */
+    virtual double latency() {
+        return 0;
+    }
+
+    /**
+     * 根据类型创建输出
+     * @param type AUDIO_SINK_XXX
+     * @param path AUDIO_SINK_WAV时的文件路径
+     */
+    static AudioSink *create(int type, const char *path);
+};
+
+#endif //VIDEOPLAYER_AUDIOSINK_H
@@ -12,11 +12,18 @@ extern "C" {
 #include "JNICallbackHelper.h"
 
 #define MAX_SIZE_QUEUE 100
+#define MAX_BUFFER_DURATION 5.0 // 压缩包队列最多缓存的时长，单位秒
+#define MIN_BUFFER_DURATION 0.5 // 压缩包队列低于该时长时认为该通道处于饥饿状态，单位秒
+#define MAX_PACKETS_BACKSTOP 1000 // 没有设置 max_packets 的通道的包数上限：时间戳缺失或者回退时时长不增长，仍然不会无限缓存
+
+typedef void(*CompletedCallback)(void *); // 定义函数指针，通道播放到结尾时回调。
 
 class BaseChannel {
 
 private:
-    int zero_count = 0; // 视频队列数量为0的循环次数.
+    CompletedCallback completedCallback = 0;
+    void *completed_args = 0; // 给completedCallback的参数
+
 public:
     // VideoPlayer.cpp prepare的第三步.formatContext->nb_streams
     int stream_index; // 音/视频的下标 ，在使用for循环时获取的数据流的类型。是这个流的下标，并不是一帧的下标。
@@ -28,6 +35,28 @@ public:
     AVRational time_base; // 时间基
     JNICallbackHelper *helper = 0;
 
+    volatile bool finished = false; // 是否已经播放到结尾
+
+    volatile int64_t seek_request_time = 0; // seek请求的时间，seek后第一帧输出时用于统计耗时，单位微秒
+    int64_t seek_latency = 0; // 最近一次seek从请求到第一帧输出的耗时，单位微秒
+
+    volatile int serial = 0; // 当前的播放代数，seek或从后台恢复时加一，只在解封装线程中修改
+    int decoder_serial = 0; // 解码器中数据所属的播放代数，只在解码线程中使用
+    int64_t stale_dropped = 0; // 因为属于之前的播放代数而丢弃的压缩包和解压包数量
+
+    int max_packets = 0; // 压缩包队列最多的包数，0 表示按时长和 MAX_PACKETS_BACKSTOP 限制
+    int peak_packets = 0; // 压缩包队列中出现过的最多包数
+    volatile int64_t head_ts = AV_NOPTS_VALUE; // 解码线程最近取出的压缩包的时间戳（时间基）
+    volatile int64_t tail_ts = AV_NOPTS_VALUE; // 最近放入队列的压缩包的时间戳（时间基）
+    volatile int64_t play_ts = AV_NOPTS_VALUE; // 播放线程最近输出的帧的时间戳（时间基）
+    volatile bool buffering = false; // 缓冲中：播放线程暂停输出，时钟不前进
+    volatile bool paused = false; // 用户暂停：与缓冲相同，播放线程暂停输出，时钟不前进
+    volatile int64_t seek_target_pts = AV_NOPTS_VALUE; // 精确seek的目标（时间基），解码出的帧早于目标时直接丢弃
+    int64_t catchup_start_time = 0; // 精确seek开始追赶目标的时间，单位微秒
+    int64_t catchup_frames = 0; // 精确seek追赶过程中丢弃的帧数
+    int64_t catchup_time = 0; // 最近一次精确seek从关键帧解码追赶到目标的耗时，单位微秒
+    int64_t catchup_discarded = 0; // 最近一次精确seek追赶过程中丢弃的帧数
+
     BaseChannel(int streamIndex, AVCodecContext *codecContext, AVRational time_base) :
             stream_index(streamIndex),
             codecContext(codecContext),
@@ -46,25 +75,217 @@ public:
         this->helper = callback_helper;
     }
 
+    void setCompletedCallback(CompletedCallback callback, void *args) {
+        this->completedCallback = callback;
+        this->completed_args = args;
+    }
+
+    /**
+     * 播放阶段取到结束标记时调用，通知播放器该通道已经播放完成。
+     */
+    void notifyCompleted() {
+        if (finished) {
+            return;
+        }
+        finished = true;
+        if (completedCallback) {
+            completedCallback(completed_args);
+        }
+    }
+
+    /**
+     * seek之后第一帧输出（渲染/交给声卡）时调用，统计seek到第一帧的耗时。
+     */
+    void onFirstFrameAfterSeek() {
+        int64_t request_time = seek_request_time;
+        if (!request_time) {
+            return;
+        }
+        seek_request_time = 0;
+        seek_latency = av_gettime_relative() - request_time;
+        LOGD("seek到第一帧耗时 %lld ms\n", (long long) seek_latency / 1000)
+    }
+
     /**
-     * 视频压缩包是否采集完成
+     * seek执行后调用（解封装线程）：开始新的播放代数；精确seek时设置追赶的目标。
+     * 队列中之前代数的数据不在这里清空，由解码线程和播放线程取出时丢弃，解码线程遇到新的代数时清空解码器。
+     * @param target 目标时间，单位微秒。AV_NOPTS_VALUE 表示快速seek，从关键帧直接开始播放。
      */
-    void isEmptyVideoQueue(bool *finished) {
-        if (zero_count >= MAX_SIZE_QUEUE) {
-            *finished = true;
+    void startSeek(int64_t target) {
+        if (target == AV_NOPTS_VALUE) {
+            seek_target_pts = AV_NOPTS_VALUE;
         } else {
-            if (packets.size() == 0) {
-                zero_count++;
+            catchup_start_time = av_gettime_relative();
+            catchup_frames = 0;
+            seek_target_pts = av_rescale_q(target, AV_TIME_BASE_Q, time_base);
+        }
+        head_ts = AV_NOPTS_VALUE; // 队列中剩余的都是之前代数的包，缓存时长从新的包开始计算
+        tail_ts = AV_NOPTS_VALUE;
+        play_ts = AV_NOPTS_VALUE;
+        serial++; // 先设置目标再改变代数，解码线程看到新代数时一定能看到新目标
+    }
+
+    /**
+     * 压缩包的时间戳，用于计算队列缓存的时长。优先使用解码时间戳，它在流中是递增的。
+     */
+    static int64_t packetTs(AVPacket *packet) {
+        return packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    }
+
+    /**
+     * 解封装线程把压缩包放入队列（带上当前的播放代数）
+     */
+    void queuePacket(AVPacket *packet) {
+        int64_t ts = packetTs(packet);
+        if (ts != AV_NOPTS_VALUE) {
+            if (head_ts == AV_NOPTS_VALUE) {
+                head_ts = ts;
             }
-            *finished = false;
+            tail_ts = ts;
+        }
+        packets.insertToQueue(packet, serial);
+        int size = packets.size();
+        if (size > peak_packets) {
+            peak_packets = size;
+        }
+    }
+
+    /**
+     * 解码线程取出当前代数的压缩包时调用
+     */
+    void onPacketDequeued(AVPacket *packet) {
+        int64_t ts = packetTs(packet);
+        if (ts != AV_NOPTS_VALUE) {
+            head_ts = ts;
+        }
+    }
+
+    /**
+     * 压缩包队列缓存的时长，单位秒
+     */
+    double bufferedDuration() {
+        int64_t head = head_ts;
+        int64_t tail = tail_ts;
+        if (head == AV_NOPTS_VALUE || tail == AV_NOPTS_VALUE || tail <= head) {
+            return 0;
         }
+        return (tail - head) * av_q2d(time_base);
+    }
+
+    /**
+     * 已经读到的数据比正在播放的位置超前的时长（包括压缩包和解压包队列），单位秒。
+     * seek之后还没有开始播放时，只计算压缩包队列。
+     */
+    double aheadDuration() {
+        int64_t play = play_ts;
+        int64_t tail = tail_ts;
+        if (play == AV_NOPTS_VALUE) {
+            return bufferedDuration();
+        }
+        if (tail == AV_NOPTS_VALUE || tail <= play) {
+            return 0;
+        }
+        return (tail - play) * av_q2d(time_base);
+    }
+
+    /**
+     * 压缩包队列缓存的时长不足，解码很快会没有数据
+     */
+    bool isStarving() {
+        return bufferedDuration() < MIN_BUFFER_DURATION;
+    }
+
+    /**
+     * 解码线程取到压缩包后调用。
+     * @return true 表示压缩包属于之前的播放代数，需要丢弃
+     */
+    bool isStalePacket(int packet_serial) {
+        if (packet_serial != serial) {
+            stale_dropped++;
+            return true;
+        }
+        if (packet_serial != decoder_serial) {
+            // 新的播放代数的第一个压缩包（seek之后的关键帧），丢掉解码器中之前的参考帧和缓存的帧。
+            avcodec_flush_buffers(codecContext);
+            decoder_serial = packet_serial;
+        }
+        return false;
+    }
+
+    /**
+     * 播放线程取到解压包后调用。
+     * @return true 表示解压包属于之前的播放代数，需要丢弃
+     */
+    bool isStaleFrame(int frame_serial) {
+        if (frame_serial != serial) {
+            stale_dropped++;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * 解码线程中调用：精确seek时，早于目标的帧只解码（关键帧之后的帧需要参考），不做转换和播放，直接丢弃。
+     * 解码期间又发生了seek时，该帧属于之前的播放代数，也直接丢弃。
+     * @return true 表示该帧需要丢弃
+     */
+    bool discardBeforeSeekTarget(AVFrame *frame) {
+        if (decoder_serial != serial) {
+            stale_dropped++;
+            return true;
+        }
+        int64_t target = seek_target_pts;
+        if (target == AV_NOPTS_VALUE) {
+            return false;
+        }
+        int64_t pts = frame->best_effort_timestamp;
+        if (pts != AV_NOPTS_VALUE && pts + FFMAX(frame->pkt_duration, 1) <= target) {
+            catchup_frames++;
+            return true;
+        }
+        // 追上目标，统计从关键帧解码到目标的耗时
+        seek_target_pts = AV_NOPTS_VALUE;
+        catchup_time = av_gettime_relative() - catchup_start_time;
+        catchup_discarded = catchup_frames;
+        LOGD("精确seek追赶完成 stream = %d，丢弃 %lld 帧，耗时 %lld ms\n", stream_index,
+             (long long) catchup_discarded, (long long) catchup_time / 1000)
+        return false;
+    }
+
+    /**
+     * 创建结束标记压缩包：没有数据的空包（与ffmpeg冲刷解码器时传入的空包含义一致）。
+     * 解封装读到结尾时放入压缩包队列，解码线程取到后冲刷解码器，取出剩余的帧。
+     */
+    static AVPacket *createEofPacket() {
+        AVPacket *packet = av_packet_alloc();
+        packet->data = nullptr;
+        packet->size = 0;
+        return packet;
+    }
+
+    static bool isEofPacket(AVPacket *packet) {
+        return !packet->data && !packet->size;
+    }
+
+    /**
+     * 创建结束标记解压包：没有数据的空帧（解码出来的帧都是引用计数的，buf[0]不为空）。
+     * 解码器冲刷完成后放入解压包队列，播放线程取到后表示该通道已经播放完成。
+     */
+    static AVFrame *createEofFrame() {
+        return av_frame_alloc();
+    }
+
+    static bool isEofFrame(AVFrame *frame) {
+        return !frame->buf[0];
     }
 
     /**
-     * 压缩包队列是否超过阈值
+     * 压缩包队列是否超过阈值：缓存的时长超过 MAX_BUFFER_DURATION，
+     * 或者包数超过 max_packets（没有设置时为 MAX_PACKETS_BACKSTOP）
      */
     void beyondLimitsWithPackets(bool *limit) {
-        if (packets.size() >= MAX_SIZE_QUEUE) {
+        if (bufferedDuration() >= MAX_BUFFER_DURATION
+            || packets.size() >= (max_packets ? max_packets : MAX_PACKETS_BACKSTOP)) {
             *limit = true;
         } else {
             *limit = false;
@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <cstring>
+#include "CacheFile.h"
+#include "Log.h"
+
+pthread_mutex_t CacheFile::mutex = PTHREAD_MUTEX_INITIALIZER; // 静态初始化互斥锁
+char *CacheFile::cache_dir = nullptr;
+
+void CacheFile::setDir(const char *dir) {
+    pthread_mutex_lock(&mutex);
+    if (cache_dir) {
+        delete[] cache_dir;
+        cache_dir = nullptr;
+    }
+    if (dir) {
+        cache_dir = new char[strlen(dir) + 1];
+        strcpy(cache_dir, dir);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+bool CacheFile::path(const char *data_source, const char *suffix, char *path, int size,
+                     struct stat *st) {
+    if (strstr(data_source, "://") && strncmp(data_source, "file://", 7) != 0) {
+        return false; // 网络流没有缓存
+    }
+    if (!strncmp(data_source, "file://", 7)) {
+        data_source += 7;
+    }
+    if (stat(data_source, st) || !S_ISREG(st->st_mode)) {
+        return false;
+    }
+
+    return hashPath(data_source, suffix, path, size);
+}
+
+bool CacheFile::urlPath(const char *url, const char *suffix, char *path, int size) {
+    return hashPath(url, suffix, path, size);
+}
+
+bool CacheFile::hashPath(const char *key, const char *suffix, char *path, int size) {
+    // FNV-1a 64位哈希，作为缓存文件名
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = key; *p; p++) {
+        hash ^= (uint8_t) *p;
+        hash *= 1099511628211ULL;
+    }
+
+    pthread_mutex_lock(&mutex);
+    bool result = cache_dir != nullptr;
+    if (result) {
+        snprintf(path, size, "%s/%016llx.%s", cache_dir, (unsigned long long) hash, suffix);
+    }
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
+
+bool CacheFile::write(const char *path, const void *data, int64_t size) {
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        LOGD("缓存文件打开失败 %s\n", tmp_path)
+        return false;
+    }
+    bool result = fwrite(data, 1, size, file) == (size_t) size;
+    result = !fclose(file) && result;
+    if (!result || rename(tmp_path, path)) {
+        LOGD("缓存文件写入失败 %s\n", path)
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
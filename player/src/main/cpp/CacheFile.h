@@ -0,0 +1,51 @@
+#ifndef VIDEOPLAYER_CACHEFILE_H
+#define VIDEOPLAYER_CACHEFILE_H
+
+#include <cstdint>
+#include <pthread.h>
+#include <sys/stat.h>
+
+/**
+ * 本地媒体文件的缓存文件（旁路文件，如关键帧索引）。
+ *
+ * 缓存文件放在应用的缓存目录中，文件名由媒体路径的哈希和后缀组成。
+ * 媒体文件的大小和修改时间写在缓存文件的头部，读取时比对，文件改变后缓存自动失效。
+ */
+class CacheFile {
+
+private:
+    static pthread_mutex_t mutex;
+    static char *cache_dir; // 缓存目录，未设置时不使用缓存
+
+    static bool hashPath(const char *key, const char *suffix, char *path, int size);
+
+public:
+    /**
+     * 设置缓存目录（一般为 Context.getCacheDir()）
+     */
+    static void setDir(const char *dir);
+
+    /**
+     * 获取媒体文件对应的缓存文件路径。
+     * @param data_source 媒体地址，只有本地文件才有缓存
+     * @param suffix 缓存文件的后缀，区分不同的缓存
+     * @param path 输出缓存文件路径
+     * @param size path的大小
+     * @param st 输出媒体文件的信息（大小和修改时间），用于校验缓存
+     * @return 没有设置缓存目录或者不是本地文件时返回false
+     */
+    static bool path(const char *data_source, const char *suffix, char *path, int size, struct stat *st);
+
+    /**
+     * 获取网络媒体对应的缓存文件路径（按地址区分）。
+     * @return 没有设置缓存目录时返回false
+     */
+    static bool urlPath(const char *url, const char *suffix, char *path, int size);
+
+    /**
+     * 把数据写入缓存文件：先写入临时文件再重命名，读取的一方不会看到写了一半的文件。
+     */
+    static bool write(const char *path, const void *data, int64_t size);
+};
+
+#endif //VIDEOPLAYER_CACHEFILE_H
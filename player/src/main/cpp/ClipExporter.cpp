@@ -0,0 +1,203 @@
+#include <cstring>
+#include "ClipExporter.h"
+#include "VideoPlayer.h"
+#include "util.h"
+#include "Log.h"
+
+ClipExporter::ClipExporter(const char *data_source, const char *output_path, int64_t start, int64_t end,
+                           JNICallbackHelper *helper) :
+        start_time(start * 1000),
+        end_time(end * 1000),
+        helper(helper) {
+    this->data_source = new char[strlen(data_source) + 1];
+    strcpy(this->data_source, data_source);
+    this->output_path = new char[strlen(output_path) + 1];
+    strcpy(this->output_path, output_path);
+}
+
+ClipExporter::~ClipExporter() {
+    cancel();
+    delete[] data_source;
+    delete[] output_path;
+    DELETE(helper)
+}
+
+int ClipExporter::interrupt_callback(void *opaque) {
+    return static_cast<ClipExporter *>(opaque)->abort_request;
+}
+
+void *task_export(void *args) {
+    auto *exporter = static_cast<ClipExporter *>(args);
+    exporter->run();
+    return 0;
+}
+
+void ClipExporter::start() {
+    thread_started = true; // 先于线程设置，完成回调中释放时需要知道线程已经开始
+    pthread_create(&pid_export, 0, task_export, this);
+}
+
+void ClipExporter::cancel() {
+    if (!thread_started) {
+        return;
+    }
+    abort_request = true;
+    if (pthread_equal(pthread_self(), pid_export)) {
+        return; // 导出线程不能等待自己
+    }
+    pthread_join(pid_export, nullptr);
+    thread_started = false;
+}
+
+void ClipExporter::release(ClipExporter *exporter) {
+    if (!exporter) {
+        return;
+    }
+    if (exporter->thread_started && pthread_equal(pthread_self(), exporter->pid_export)) {
+        exporter->abort_request = true;
+        exporter->release_on_exit = true;
+        return;
+    }
+    delete exporter;
+}
+
+void ClipExporter::run() {
+    int64_t begin = av_gettime_relative();
+    int result = exportClip();
+    export_time = av_gettime_relative() - begin;
+    LOGD("片段导出结束 %d，复制 %lld 个包 %lld KB，耗时 %lld ms\n", result, (long long) copied_packets,
+         (long long) copied_bytes / 1024, (long long) export_time / 1000)
+    if (helper) {
+        helper->onExportCompleted(THREAD_CHILD, result);
+    }
+    if (release_on_exit) {
+        // 回调中释放了导出器，没有其他线程等待该线程，分离后自己释放
+        pthread_detach(pid_export);
+        thread_started = false;
+        delete this;
+    }
+}
+
+/**
+ * @return 0 表示成功，否则为ffmpeg的错误码
+ */
+int ClipExporter::exportClip() {
+    if (end_time <= start_time) {
+        return AVERROR(EINVAL);
+    }
+
+    AVFormatContext *context = nullptr;
+    MediaIO *io = nullptr;
+    int result = VideoPlayer::openInput(data_source, &context, nullptr, nullptr, &io, interrupt_callback, this);
+    if (!result) {
+        result = avformat_find_stream_info(context, nullptr);
+    }
+    if (result < 0) {
+        if (context) {
+            avformat_close_input(&context);
+        }
+        DELETE(io)
+        return result;
+    }
+
+    // 与prepare相同：第一个音频流和第一个视频流（不包括封面），其他的流不读取
+    int indexes[] = {-1, -1}; // 音频、视频
+    for (int i = 0; i < (int) context->nb_streams; i++) {
+        AVStream *stream = context->streams[i];
+        if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && indexes[0] < 0) {
+            indexes[0] = i;
+        } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && indexes[1] < 0
+                   && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            indexes[1] = i;
+        } else {
+            stream->discard = AVDISCARD_ALL;
+        }
+    }
+    int key_index = indexes[1] >= 0 ? indexes[1] : indexes[0]; // 按该流的关键帧开始
+    Remuxer *remuxer = key_index >= 0 ? Remuxer::create(output_path) : nullptr;
+    int out_indexes[] = {-1, -1};
+    for (int i = 0; remuxer && i < 2; i++) {
+        if (indexes[i] >= 0) {
+            AVStream *stream = context->streams[indexes[i]];
+            out_indexes[i] = remuxer->addStream(stream->codecpar, stream->time_base);
+        }
+    }
+    if (!remuxer || (indexes[0] >= 0 && out_indexes[0] < 0) || (indexes[1] >= 0 && out_indexes[1] < 0)
+        || !remuxer->begin()) {
+        DELETE(remuxer)
+        avformat_close_input(&context);
+        DELETE(io)
+        return AVERROR(EINVAL);
+    }
+
+    // 按容器的索引跳到开始之前（含）最近的关键帧
+    AVStream *key_stream = context->streams[key_index];
+    result = av_seek_frame(context, key_index, av_rescale_q(start_time, AV_TIME_BASE_Q, key_stream->time_base),
+                           AVSEEK_FLAG_BACKWARD);
+    if (result < 0) {
+        LOGD("片段导出seek失败 %d，从头开始读取\n", result)
+    }
+
+    int64_t offset = AV_NOPTS_VALUE; // 开始的关键帧的时间戳，单位微秒，输出文件从0开始
+    bool ended[] = {indexes[0] < 0, indexes[1] < 0}; // 各个流是否已经复制到结束
+    int percent = -1;
+    AVPacket *packet = av_packet_alloc();
+    result = 0;
+    while (!abort_request && !(ended[0] && ended[1])) {
+        int ret = av_read_frame(context, packet);
+        if (ret == AVERROR_EOF) {
+            break;
+        }
+        if (ret < 0) {
+            result = ret;
+            break;
+        }
+        int type = packet->stream_index == indexes[0] ? 0 : packet->stream_index == indexes[1] ? 1 : -1;
+        int64_t ts = BaseChannel::packetTs(packet);
+        if (type < 0 || ended[type] || ts == AV_NOPTS_VALUE) {
+            av_packet_unref(packet);
+            continue;
+        }
+        AVRational time_base = context->streams[packet->stream_index]->time_base;
+        int64_t time = av_rescale_q(ts, time_base, AV_TIME_BASE_Q);
+
+        if (offset == AV_NOPTS_VALUE) {
+            if (packet->stream_index != key_index || !(packet->flags & AV_PKT_FLAG_KEY)) {
+                av_packet_unref(packet); // 开始的关键帧之前的包
+                continue;
+            }
+            offset = time;
+        }
+        if (time < offset) {
+            av_packet_unref(packet); // 开始的关键帧之前的音频
+            continue;
+        }
+        if (time > end_time) {
+            ended[type] = true;
+            av_packet_unref(packet);
+            continue;
+        }
+
+        copied_packets++;
+        copied_bytes += packet->size;
+        remuxer->write(packet, out_indexes[type], time_base, offset);
+
+        int now = (int) ((time - offset) * 100 / FFMAX(end_time - offset, 1));
+        if (now != percent && helper) {
+            percent = now;
+            helper->onExportProgress(THREAD_CHILD, percent);
+        }
+    }
+    av_packet_free(&packet);
+
+    if (abort_request) {
+        result = AVERROR_EXIT;
+    }
+    if (!remuxer->end() && !result) {
+        result = AVERROR(EIO);
+    }
+    DELETE(remuxer)
+    avformat_close_input(&context);
+    DELETE(io)
+    return result;
+}
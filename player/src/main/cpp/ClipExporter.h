@@ -0,0 +1,69 @@
+#ifndef VIDEOPLAYER_CLIPEXPORTER_H
+#define VIDEOPLAYER_CLIPEXPORTER_H
+
+#include <pthread.h>
+#include "JNICallbackHelper.h"
+#include "MediaIO.h"
+#include "Remuxer.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * 片段导出：把媒体中 [start, end] 之间的压缩包原样复制到新的文件，不解码、不编码。
+ *
+ * 按容器的索引seek到start之前（含）最近的视频关键帧，从关键帧开始复制，复制到end之后结束，
+ * 耗时与复制的字节数成正比，与片段的播放时长无关。输出文件的时间戳从0开始。
+ * 只导出第一个音频流和第一个视频流（与播放器选择的流一致）。
+ *
+ * 在自己的线程中执行，进度（百分比）和结果通过JNICallbackHelper回调。
+ */
+class ClipExporter {
+
+private:
+    char *data_source = 0;
+    char *output_path = 0;
+    int64_t start_time; // 片段的开始，单位微秒
+    int64_t end_time; // 片段的结束，单位微秒
+    JNICallbackHelper *helper = 0;
+    pthread_t pid_export;
+    bool thread_started = false;
+    volatile bool abort_request = false; // 取消导出，阻塞的IO立即返回
+    bool release_on_exit = false; // 在完成回调中被释放，导出线程在回调返回后自己释放
+
+    static int interrupt_callback(void *opaque);
+
+    int exportClip();
+
+public:
+    int64_t copied_packets = 0; // 复制的压缩包数量
+    int64_t copied_bytes = 0; // 复制的压缩包字节数
+    int64_t export_time = 0; // 导出的耗时，单位微秒
+
+    /**
+     * @param start 片段的开始，单位毫秒
+     * @param end 片段的结束，单位毫秒
+     */
+    ClipExporter(const char *data_source, const char *output_path, int64_t start, int64_t end,
+                 JNICallbackHelper *helper);
+
+    ~ClipExporter();
+
+    void start();
+
+    /**
+     * 取消导出并等待导出线程结束；在导出线程中调用时只取消，不等待
+     */
+    void cancel();
+
+    /**
+     * 释放导出器。在导出线程中（完成回调里取消或者开始新的导出）不能等待自己结束，
+     * 标记后由导出线程在回调返回后释放。
+     */
+    static void release(ClipExporter *exporter);
+
+    void run();
+};
+
+#endif //VIDEOPLAYER_CLIPEXPORTER_H
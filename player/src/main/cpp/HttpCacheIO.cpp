@@ -0,0 +1,367 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "HttpCacheIO.h"
+#include "CacheFile.h"
+#include "PlayerStats.h"
+#include "Log.h"
+
+#define HTTP_CACHE_MAGIC 0x314d4348 // "HCM1"
+#define HTTP_CACHE_VERSION 1
+#define HTTP_CACHE_DATA_SUFFIX "httpcache"
+#define HTTP_CACHE_MAP_SUFFIX "httpmap"
+
+volatile int64_t HttpCacheIO::max_size = HTTP_CACHE_MAX_SIZE;
+
+void HttpCacheIO::setMaxSize(int64_t size) {
+    max_size = size;
+}
+
+HttpCacheIO *HttpCacheIO::open(const char *url, const AVIOInterruptCB *interrupt_callback) {
+    if (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) {
+        return nullptr;
+    }
+    if (max_size <= 0) {
+        return nullptr;
+    }
+    // hls的播放列表会更新（直播），不缓存；分片由hls解封装器自己打开，也不经过这里
+    const char *query = strchr(url, '?');
+    size_t length = query ? query - url : strlen(url);
+    if (length >= 5 && strncmp(url + length - 5, ".m3u8", 5) == 0) {
+        return nullptr;
+    }
+
+    auto *io = new HttpCacheIO();
+    if (!CacheFile::urlPath(url, HTTP_CACHE_DATA_SUFFIX, io->data_path, sizeof(io->data_path))
+        || !CacheFile::urlPath(url, HTTP_CACHE_MAP_SUFFIX, io->map_path, sizeof(io->map_path))) {
+        delete io;
+        return nullptr;
+    }
+    io->url = new char[strlen(url) + 1];
+    strcpy(io->url, url);
+    if (interrupt_callback) {
+        io->interrupt_callback = *interrupt_callback;
+    }
+
+    // 有块表时直接使用记录的文件大小，全部命中缓存时不需要访问网络；否则先打开网络连接得到文件大小。
+    if (!io->loadMap() && !io->openUpstream()) {
+        delete io;
+        return nullptr;
+    }
+
+    io->fd = ::open(io->data_path, O_RDWR | O_CREAT, 0644);
+    if (io->fd < 0) {
+        LOGD("缓存文件打开失败 %s\n", io->data_path)
+        delete io;
+        return nullptr;
+    }
+    utimes(io->data_path, nullptr); // 更新最近使用的时间，用于LRU淘汰
+
+    io->block_buffer = static_cast<uint8_t *>(av_malloc(HTTP_CACHE_BLOCK_SIZE));
+    auto *buffer = static_cast<uint8_t *>(av_malloc(HTTP_CACHE_BUFFER_SIZE));
+    io->pb = avio_alloc_context(buffer, HTTP_CACHE_BUFFER_SIZE, 0, io, read_packet, nullptr, seek);
+    if (!io->block_buffer || !io->pb) {
+        av_free(buffer);
+        delete io;
+        return nullptr;
+    }
+    return io;
+}
+
+HttpCacheIO::~HttpCacheIO() {
+    if (pb) {
+        av_freep(&pb->buffer);
+        avio_context_free(&pb);
+    }
+    if (upstream) {
+        avio_closep(&upstream);
+    }
+    if (fd >= 0) {
+        saveMap();
+        close(fd);
+        fd = -1;
+        trim(data_path);
+        LOGD("网络缓存 命中 %lld KB，下载 %lld KB，请求 %lld 次\n", (long long) hit_bytes / 1024,
+             (long long) miss_bytes / 1024, (long long) requests)
+    }
+    av_freep(&block_buffer);
+    if (url) {
+        delete[] url;
+        url = nullptr;
+    }
+}
+
+void HttpCacheIO::fetchStats(int64_t *stats) {
+    stats[STAT_HTTP_CACHE_HIT_BYTES] = hit_bytes;
+    stats[STAT_HTTP_CACHE_MISS_BYTES] = miss_bytes;
+    stats[STAT_HTTP_CACHE_REQUESTS] = requests;
+}
+
+/**
+ * 读取块表
+ */
+bool HttpCacheIO::loadMap() {
+    FILE *file = fopen(map_path, "rb");
+    if (!file) {
+        return false;
+    }
+    Header header;
+    bool result = fread(&header, sizeof(Header), 1, file) == 1
+                  && header.magic == HTTP_CACHE_MAGIC
+                  && header.version == HTTP_CACHE_VERSION
+                  && header.block_size == HTTP_CACHE_BLOCK_SIZE
+                  && header.file_size > 0
+                  && header.block_count == (header.file_size + HTTP_CACHE_BLOCK_SIZE - 1) / HTTP_CACHE_BLOCK_SIZE;
+    if (result) {
+        blocks.resize(header.block_count);
+        result = fread(blocks.data(), 1, blocks.size(), file) == blocks.size();
+    }
+    fclose(file);
+    if (!result) {
+        blocks.clear();
+        return false;
+    }
+    size = header.file_size;
+    return true;
+}
+
+void HttpCacheIO::saveMap() {
+    if (!map_changed) {
+        return;
+    }
+    std::vector<uint8_t> data(sizeof(Header) + blocks.size());
+    auto *header = reinterpret_cast<Header *>(data.data());
+    header->magic = HTTP_CACHE_MAGIC;
+    header->version = HTTP_CACHE_VERSION;
+    header->file_size = size;
+    header->block_size = HTTP_CACHE_BLOCK_SIZE;
+    header->block_count = (int32_t) blocks.size();
+    memcpy(data.data() + sizeof(Header), blocks.data(), blocks.size());
+    if (CacheFile::write(map_path, data.data(), data.size())) {
+        map_changed = false;
+    }
+}
+
+/**
+ * 打开网络连接。服务器上的文件大小与块表记录的不同时，之前的缓存失效。
+ */
+bool HttpCacheIO::openUpstream() {
+    AVDictionary *options = nullptr;
+    av_dict_set(&options, "timeout", "5000000", 0);
+    int result = avio_open2(&upstream, url, AVIO_FLAG_READ, &interrupt_callback, &options);
+    av_dict_free(&options);
+    requests++;
+    if (result < 0) {
+        LOGD("网络缓存打开连接失败 %d\n", result)
+        upstream = nullptr;
+        return false;
+    }
+    int64_t upstream_size = avio_size(upstream);
+    if (upstream_size <= 0 || !(upstream->seekable & AVIO_SEEKABLE_NORMAL)) {
+        // 不知道大小或者不支持Range，无法按块缓存
+        avio_closep(&upstream);
+        return false;
+    }
+    if (upstream_size != size) {
+        if (size) {
+            LOGD("网络文件已经改变，缓存失效 %lld -> %lld\n", (long long) size, (long long) upstream_size)
+            if (fd >= 0) {
+                ftruncate(fd, 0);
+            }
+            buffered_block = -1;
+        }
+        size = upstream_size;
+        blocks.assign((size + HTTP_CACHE_BLOCK_SIZE - 1) / HTTP_CACHE_BLOCK_SIZE, 0);
+        map_changed = true;
+    }
+    upstream_pos = 0;
+    return true;
+}
+
+bool HttpCacheIO::isInterrupted() {
+    return interrupt_callback.callback && interrupt_callback.callback(interrupt_callback.opaque);
+}
+
+/**
+ * 从网络下载一块到block_buffer，完整的块写入缓存。
+ * @return 下载的字节数，失败时返回错误码
+ */
+int HttpCacheIO::fetchBlock(int block) {
+    if (!upstream && !openUpstream()) {
+        return isInterrupted() ? AVERROR_EXIT : AVERROR(EIO);
+    }
+    if (block >= (int) blocks.size()) {
+        return AVERROR_EOF; // 文件变小了
+    }
+    int64_t start = (int64_t) block * HTTP_CACHE_BLOCK_SIZE;
+    if (upstream_pos != start) {
+        // http协议以新的Range从块的起始位置重新请求
+        if (avio_seek(upstream, start, SEEK_SET) < 0) {
+            upstream_pos = -1;
+            return isInterrupted() ? AVERROR_EXIT : AVERROR(EIO);
+        }
+        requests++;
+        upstream_pos = start;
+    }
+
+    int length = (int) FFMIN((int64_t) HTTP_CACHE_BLOCK_SIZE, size - start);
+    int read = 0;
+    while (read < length) {
+        int result = avio_read(upstream, block_buffer + read, length - read);
+        if (result <= 0) {
+            break;
+        }
+        read += result;
+    }
+    upstream_pos += read;
+    buffered_block = block;
+    buffered_length = read;
+    if (read < length) {
+        // 不完整的块不缓存，之后从当前位置重新请求
+        upstream_pos = -1;
+        if (read > 0) {
+            return read;
+        }
+        return isInterrupted() ? AVERROR_EXIT : AVERROR(EIO);
+    }
+
+    if (pwrite(fd, block_buffer, length, start) == length) {
+        blocks[block] = 1;
+        map_changed = true;
+    }
+    return length;
+}
+
+int HttpCacheIO::read_packet(void *opaque, uint8_t *buf, int buf_size) {
+    auto *io = static_cast<HttpCacheIO *>(opaque);
+    if (io->position >= io->size) {
+        return AVERROR_EOF;
+    }
+    int block = (int) (io->position / HTTP_CACHE_BLOCK_SIZE);
+    int offset = (int) (io->position % HTTP_CACHE_BLOCK_SIZE);
+    int64_t block_start = (int64_t) block * HTTP_CACHE_BLOCK_SIZE;
+    int length = (int) FFMIN((int64_t) buf_size, FFMIN((int64_t) HTTP_CACHE_BLOCK_SIZE, io->size - block_start) - offset);
+
+    if (block != io->buffered_block && io->blocks[block]) {
+        if (pread(io->fd, buf, length, io->position) == length) {
+            io->hit_bytes += length;
+            io->position += length;
+            return length;
+        }
+        io->blocks[block] = 0; // 缓存文件被删除或者截断
+        io->map_changed = true;
+    }
+
+    if (block != io->buffered_block) {
+        int result = io->fetchBlock(block);
+        if (result < 0) {
+            return result;
+        }
+    }
+    if (io->buffered_length <= offset) {
+        io->buffered_block = -1;
+        return AVERROR(EIO);
+    }
+    length = FFMIN(length, io->buffered_length - offset);
+    memcpy(buf, io->block_buffer + offset, length);
+    io->miss_bytes += length;
+    io->position += length;
+    return length;
+}
+
+int64_t HttpCacheIO::seek(void *opaque, int64_t offset, int whence) {
+    auto *io = static_cast<HttpCacheIO *>(opaque);
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return io->size;
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = io->position + offset;
+            break;
+        case SEEK_END:
+            target = io->size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (target < 0 || target > io->size) {
+        return AVERROR(EINVAL);
+    }
+    // 只改变位置，读取时才决定从缓存读还是下载
+    io->position = target;
+    return target;
+}
+
+/**
+ * 缓存总大小超过上限时，按最近使用的时间从旧到新删除其他地址的缓存。
+ * @param keep_path 当前地址的块数据文件，不删除
+ */
+void HttpCacheIO::trim(const char *keep_path) {
+    struct Entry {
+        std::string path;
+        time_t mtime;
+        int64_t usage;
+    };
+
+    std::string dir(keep_path);
+    size_t slash = dir.rfind('/');
+    if (slash == std::string::npos) {
+        return;
+    }
+    dir.resize(slash);
+    DIR *handle = opendir(dir.c_str());
+    if (!handle) {
+        return;
+    }
+
+    const char *suffix = "." HTTP_CACHE_DATA_SUFFIX;
+    size_t suffix_length = strlen(suffix);
+    std::vector<Entry> entries;
+    int64_t total = 0;
+    struct dirent *dirent;
+    while ((dirent = readdir(handle))) {
+        size_t name_length = strlen(dirent->d_name);
+        if (name_length <= suffix_length || strcmp(dirent->d_name + name_length - suffix_length, suffix) != 0) {
+            continue;
+        }
+        std::string path = dir + "/" + dirent->d_name;
+        struct stat st;
+        if (stat(path.c_str(), &st)) {
+            continue;
+        }
+        int64_t usage = (int64_t) st.st_blocks * 512; // 稀疏文件实际占用的空间
+        entries.push_back({path, st.st_mtime, usage});
+        total += usage;
+    }
+    closedir(handle);
+
+    if (total <= max_size) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.mtime < b.mtime;
+    });
+    for (const Entry &entry : entries) {
+        if (total <= max_size) {
+            break;
+        }
+        if (entry.path == keep_path) {
+            continue;
+        }
+        std::string map = entry.path.substr(0, entry.path.size() - strlen(HTTP_CACHE_DATA_SUFFIX))
+                          + HTTP_CACHE_MAP_SUFFIX;
+        remove(map.c_str()); // 先删除块表，块表指向已经不存在的数据也不会出错
+        remove(entry.path.c_str());
+        total -= entry.usage;
+        LOGD("网络缓存超过上限，删除 %s\n", entry.path.c_str())
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef VIDEOPLAYER_HTTPCACHEIO_H
+#define VIDEOPLAYER_HTTPCACHEIO_H
+
+#include <vector>
+#include "MediaIO.h"
+
+#define HTTP_CACHE_BLOCK_SIZE (256 * 1024) // 缓存块的大小，缓存和网络请求都以块为单位
+#define HTTP_CACHE_BUFFER_SIZE (64 * 1024) // AVIOContext的缓冲区大小
+#define HTTP_CACHE_MAX_SIZE (256LL * 1024 * 1024) // 默认的缓存总大小上限
+
+/**
+ * 网络媒体（http/https渐进式下载）的磁盘缓存读取。
+ *
+ * 每个地址在缓存目录中对应一个块数据文件（稀疏文件，第i块在 i * HTTP_CACHE_BLOCK_SIZE 处）和一个块表文件
+ * （文件大小和每块是否已缓存）。已缓存的块直接从磁盘读取；没有缓存的块通过ffmpeg的http协议读取，
+ * seek到块的起始位置时http协议用Range请求从该位置重新下载，下载的块写入缓存。
+ * 同一个地址再次播放、或者seek回已经播放过的位置时不再访问网络。
+ *
+ * 所有缓存的总大小超过上限时，按最近使用的时间淘汰最久没有使用的地址（LRU）。
+ * 服务器上的文件大小改变时，之前的缓存失效。
+ *
+ * 只在一个解封装线程中使用。不支持Range（不能seek）或者不知道大小的流（直播等）返回空，调用方使用默认的协议。
+ */
+class HttpCacheIO : public MediaIO {
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        int64_t file_size; // 网络文件的大小，用于校验
+        int32_t block_size;
+        int32_t block_count;
+    };
+
+    static volatile int64_t max_size; // 缓存总大小的上限，<= 0 表示不缓存
+
+    char *url = 0;
+    char data_path[512]; // 块数据文件
+    char map_path[512]; // 块表文件
+    int fd = -1; // 块数据文件
+    int64_t size = 0; // 网络文件的大小
+    int64_t position = 0; // 当前的读取位置
+    std::vector<uint8_t> blocks; // 每块是否已经缓存
+    bool map_changed = false; // 块表是否需要保存
+
+    AVIOInterruptCB interrupt_callback = {nullptr, nullptr}; // 网络连接的中断回调，停止时阻塞的读取立即返回
+    AVIOContext *upstream = 0; // 网络连接，第一次需要下载时才打开
+    int64_t upstream_pos = -1; // 网络连接当前的读取位置，-1 表示未知
+    uint8_t *block_buffer = 0; // 最近下载的块
+    int buffered_block = -1; // block_buffer中是第几块
+    int buffered_length = 0; // block_buffer中的字节数
+
+    HttpCacheIO() = default;
+
+    bool loadMap();
+
+    void saveMap();
+
+    bool openUpstream();
+
+    bool isInterrupted();
+
+    int fetchBlock(int block);
+
+    static void trim(const char *keep_path);
+
+    static int read_packet(void *opaque, uint8_t *buf, int buf_size);
+
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+
+public:
+    int64_t hit_bytes = 0; // 从磁盘缓存读取的字节数
+    int64_t miss_bytes = 0; // 从网络下载的字节数
+    int64_t requests = 0; // 向服务器发起的请求次数（打开连接和Range跳转）
+
+    /**
+     * 设置缓存总大小的上限，<= 0 表示不缓存
+     */
+    static void setMaxSize(int64_t size);
+
+    /**
+     * @param url 媒体地址，只支持http和https
+     * @param interrupt_callback 网络连接的中断回调，可以为空
+     * @return 不是http地址、没有设置缓存目录、或者流不支持Range时返回空
+     */
+    static HttpCacheIO *open(const char *url, const AVIOInterruptCB *interrupt_callback);
+
+    ~HttpCacheIO();
+
+    void fetchStats(int64_t *stats) override;
+};
+
+#endif //VIDEOPLAYER_HTTPCACHEIO_H
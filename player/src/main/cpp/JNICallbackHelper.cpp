@@ -15,12 +15,28 @@ JNICallbackHelper::JNICallbackHelper(JavaVM *vm, JNIEnv *env, jobject job) {
     jmd_prepared = env->GetMethodID(clazz, "jni_prepared", "()V");
     jmd_error = env->GetMethodID(clazz, "jni_error", "(Ljava/lang/String;)V");
     jmd_progress = env->GetMethodID(clazz, "jni_progress", "(I)V");
+    jmd_completed = env->GetMethodID(clazz, "jni_completed", "()V");
+    jmd_seek_completed = env->GetMethodID(clazz, "jni_seek_completed", "(I)V");
+    jmd_buffering = env->GetMethodID(clazz, "jni_buffering", "(Z)V");
+    jmd_buffered_position = env->GetMethodID(clazz, "jni_buffered_position", "(I)V");
+    jmd_export_progress = env->GetMethodID(clazz, "jni_export_progress", "(I)V");
+    jmd_export_completed = env->GetMethodID(clazz, "jni_export_completed", "(I)V");
 }
 
 
 JNICallbackHelper::~JNICallbackHelper() {
+    // 可能在创建之外的线程中释放（如导出线程结束时释放导出器），使用当前线程的env
+    JNIEnv *current = 0;
+    bool attached = false;
+    if (vm->GetEnv(reinterpret_cast<void **>(&current), JNI_VERSION_1_6) != JNI_OK) {
+        vm->AttachCurrentThread(&current, 0);
+        attached = true;
+    }
+    current->DeleteGlobalRef(job);
+    if (attached) {
+        vm->DetachCurrentThread();
+    }
     this->vm = 0;
-    env->DeleteGlobalRef(job);
     job = 0;
     env = 0;
 }
@@ -71,3 +87,87 @@ void JNICallbackHelper::onProgress(int thread_mode, int audio_time) {
         this->vm->DetachCurrentThread();
     }
 }
+
+void JNICallbackHelper::onCompleted(int thread_mode) {
+    if (thread_mode == THREAD_MAIN) {
+        this->env->CallVoidMethod(this->job, this->jmd_completed);// 利用反射
+    }
+    if (thread_mode == THREAD_CHILD) {
+        // 使用子线程的JniEnv，全新的env，调用java的方法。
+        JNIEnv *env_child;
+        this->vm->AttachCurrentThread(&env_child, 0);
+
+        env_child->CallVoidMethod(this->job, this->jmd_completed);// 利用反射
+        this->vm->DetachCurrentThread();
+    }
+}
+
+void JNICallbackHelper::onSeekCompleted(int thread_mode, int position) {
+    if (thread_mode == THREAD_MAIN) {
+        this->env->CallVoidMethod(this->job, this->jmd_seek_completed, position);// 利用反射
+    }
+    if (thread_mode == THREAD_CHILD) {
+        // 使用子线程的JniEnv，全新的env，调用java的方法。
+        JNIEnv *env_child;
+        this->vm->AttachCurrentThread(&env_child, 0);
+
+        env_child->CallVoidMethod(this->job, this->jmd_seek_completed, position);// 利用反射
+        this->vm->DetachCurrentThread();
+    }
+}
+
+void JNICallbackHelper::onBuffering(int thread_mode, bool buffering) {
+    if (thread_mode == THREAD_MAIN) {
+        this->env->CallVoidMethod(this->job, this->jmd_buffering, (jboolean) buffering);// 利用反射
+    }
+    if (thread_mode == THREAD_CHILD) {
+        // 使用子线程的JniEnv，全新的env，调用java的方法。
+        JNIEnv *env_child;
+        this->vm->AttachCurrentThread(&env_child, 0);
+
+        env_child->CallVoidMethod(this->job, this->jmd_buffering, (jboolean) buffering);// 利用反射
+        this->vm->DetachCurrentThread();
+    }
+}
+
+void JNICallbackHelper::onBufferedPosition(int thread_mode, int position) {
+    if (thread_mode == THREAD_MAIN) {
+        this->env->CallVoidMethod(this->job, this->jmd_buffered_position, position);// 利用反射
+    }
+    if (thread_mode == THREAD_CHILD) {
+        // 使用子线程的JniEnv，全新的env，调用java的方法。
+        JNIEnv *env_child;
+        this->vm->AttachCurrentThread(&env_child, 0);
+
+        env_child->CallVoidMethod(this->job, this->jmd_buffered_position, position);// 利用反射
+        this->vm->DetachCurrentThread();
+    }
+}
+
+void JNICallbackHelper::onExportProgress(int thread_mode, int percent) {
+    if (thread_mode == THREAD_MAIN) {
+        this->env->CallVoidMethod(this->job, this->jmd_export_progress, percent);// 利用反射
+    }
+    if (thread_mode == THREAD_CHILD) {
+        // 使用子线程的JniEnv，全新的env，调用java的方法。
+        JNIEnv *env_child;
+        this->vm->AttachCurrentThread(&env_child, 0);
+
+        env_child->CallVoidMethod(this->job, this->jmd_export_progress, percent);// 利用反射
+        this->vm->DetachCurrentThread();
+    }
+}
+
+void JNICallbackHelper::onExportCompleted(int thread_mode, int result) {
+    if (thread_mode == THREAD_MAIN) {
+        this->env->CallVoidMethod(this->job, this->jmd_export_completed, result);// 利用反射
+    }
+    if (thread_mode == THREAD_CHILD) {
+        // 使用子线程的JniEnv，全新的env，调用java的方法。
+        JNIEnv *env_child;
+        this->vm->AttachCurrentThread(&env_child, 0);
+
+        env_child->CallVoidMethod(this->job, this->jmd_export_completed, result);// 利用反射
+        this->vm->DetachCurrentThread();
+    }
+}
@@ -13,6 +13,12 @@ private:
     jmethodID jmd_prepared = 0;
     jmethodID jmd_error = 0;
     jmethodID jmd_progress = 0;
+    jmethodID jmd_completed = 0;
+    jmethodID jmd_seek_completed = 0;
+    jmethodID jmd_buffering = 0;
+    jmethodID jmd_buffered_position = 0;
+    jmethodID jmd_export_progress = 0;
+    jmethodID jmd_export_completed = 0;
 
 public:
     JNICallbackHelper(JavaVM *, JNIEnv *, jobject);
@@ -24,6 +30,18 @@ public:
     void onError(char*, int);
 
     void onProgress(int, int);
+
+    void onCompleted(int);
+
+    void onSeekCompleted(int, int);
+
+    void onBuffering(int, bool);
+
+    void onBufferedPosition(int, int);
+
+    void onExportProgress(int, int);
+
+    void onExportCompleted(int, int);
 };
 
 
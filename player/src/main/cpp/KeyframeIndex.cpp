@@ -0,0 +1,196 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "KeyframeIndex.h"
+#include "CacheFile.h"
+#include "Log.h"
+
+#define KEYFRAME_INDEX_MAGIC 0x3149464B // "KFI1"
+#define KEYFRAME_INDEX_VERSION 1
+
+KeyframeIndex::KeyframeIndex(const char *path, const struct stat &st, int stream_index,
+                             AVRational time_base) {
+    strncpy(this->path, path, sizeof(this->path) - 1);
+    this->path[sizeof(this->path) - 1] = 0;
+    this->file_stat = st;
+    this->stream_index = stream_index;
+    this->time_base = time_base;
+}
+
+KeyframeIndex::~KeyframeIndex() {
+    if (map) {
+        munmap(map, map_size);
+        map = nullptr;
+    }
+}
+
+KeyframeIndex *KeyframeIndex::open(const char *data_source, AVFormatContext *formatContext,
+                                   int stream_index) {
+    if (formatContext->iformat->flags & AVFMT_NO_BYTE_SEEK) {
+        return nullptr; // 不支持按字节seek的容器（如mp4）自带完整的索引，不需要
+    }
+    char path[512];
+    struct stat st;
+    if (!CacheFile::path(data_source, "kfi", path, sizeof(path), &st)) {
+        return nullptr;
+    }
+    auto *index = new KeyframeIndex(path, st, stream_index,
+                                    formatContext->streams[stream_index]->time_base);
+    index->load();
+    return index;
+}
+
+/**
+ * 映射旁路文件，校验失败（媒体文件已改变）时忽略，重新建立索引。
+ */
+void KeyframeIndex::load() {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < (off_t) sizeof(Header)) {
+        close(fd);
+        return;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // 映射建立后文件描述符可以关闭
+    if (data == MAP_FAILED) {
+        return;
+    }
+
+    auto *header = static_cast<const Header *>(data);
+    if (header->magic != KEYFRAME_INDEX_MAGIC
+        || header->version != KEYFRAME_INDEX_VERSION
+        || header->file_size != file_stat.st_size
+        || header->file_mtime != file_stat.st_mtime
+        || header->stream_index != stream_index
+        || header->time_base_num != time_base.num
+        || header->time_base_den != time_base.den
+        || header->count < 0
+        || sizeof(Header) + header->count * sizeof(Entry) != (size_t) st.st_size) {
+        LOGD("关键帧索引已失效，重新建立 %s\n", path)
+        munmap(data, st.st_size);
+        return;
+    }
+
+    map = data;
+    map_size = st.st_size;
+    mapped = reinterpret_cast<const Entry *>(static_cast<const uint8_t *>(data) + sizeof(Header));
+    mapped_count = header->count;
+    complete = header->complete;
+    LOGD("关键帧索引加载完成 %lld 条，complete = %d\n", (long long) mapped_count, complete)
+}
+
+int64_t KeyframeIndex::count() const {
+    return mapped_count + (int64_t) appended.size();
+}
+
+const KeyframeIndex::Entry &KeyframeIndex::at(int64_t i) const {
+    return i < mapped_count ? mapped[i] : appended[i - mapped_count];
+}
+
+void KeyframeIndex::add(AVPacket *packet) {
+    if (!(packet->flags & AV_PKT_FLAG_KEY) || packet->pos < 0) {
+        return;
+    }
+    int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (pts == AV_NOPTS_VALUE) {
+        return;
+    }
+    int64_t n = count();
+    if (!linked) {
+        // seek之后，读到已经索引过的关键帧，说明从这里顺序读下去可以接上已有的索引。
+        if (n && pts <= at(n - 1).pts) {
+            linked = true;
+        }
+        return;
+    }
+    if (complete || (n && pts <= at(n - 1).pts)) {
+        return; // 已经索引过
+    }
+    appended.push_back({pts, packet->pos, packet->size, 0});
+    dirty = true;
+}
+
+void KeyframeIndex::onSeek() {
+    linked = false;
+}
+
+void KeyframeIndex::onEof() {
+    if (linked && !complete) {
+        complete = true;
+        dirty = true;
+    }
+}
+
+bool KeyframeIndex::lookup(int64_t target, Entry *entry) {
+    int64_t n = count();
+    if (!n) {
+        return false;
+    }
+    int64_t target_pts = av_rescale_q(target, AV_TIME_BASE_Q, time_base);
+    if (target_pts < at(0).pts) {
+        return false;
+    }
+    if (!complete && target_pts > at(n - 1).pts) {
+        return false; // 最后一个关键帧之后还没有索引，中间可能还有关键帧
+    }
+    // 二分查找最后一个 pts <= target_pts 的关键帧
+    int64_t low = 0;
+    int64_t high = n - 1;
+    while (low < high) {
+        int64_t mid = (low + high + 1) / 2;
+        if (at(mid).pts <= target_pts) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    *entry = at(low);
+    return true;
+}
+
+int64_t KeyframeIndex::coveredDuration() {
+    int64_t n = count();
+    if (!n) {
+        return 0;
+    }
+    return av_rescale_q(at(n - 1).pts - at(0).pts, time_base, AV_TIME_BASE_Q);
+}
+
+void KeyframeIndex::save() {
+    if (!dirty) {
+        return;
+    }
+    int64_t n = count();
+    size_t size = sizeof(Header) + n * sizeof(Entry);
+    auto *data = new uint8_t[size];
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = KEYFRAME_INDEX_MAGIC;
+    header.version = KEYFRAME_INDEX_VERSION;
+    header.file_size = file_stat.st_size;
+    header.file_mtime = file_stat.st_mtime;
+    header.stream_index = stream_index;
+    header.time_base_num = time_base.num;
+    header.time_base_den = time_base.den;
+    header.complete = complete;
+    header.count = n;
+    memcpy(data, &header, sizeof(header));
+    uint8_t *entries = data + sizeof(Header);
+    if (mapped_count) {
+        memcpy(entries, mapped, mapped_count * sizeof(Entry));
+    }
+    if (!appended.empty()) {
+        memcpy(entries + mapped_count * sizeof(Entry), appended.data(), appended.size() * sizeof(Entry));
+    }
+
+    if (CacheFile::write(path, data, size)) {
+        dirty = false;
+        LOGD("关键帧索引保存完成 %lld 条，complete = %d\n", (long long) n, complete)
+    }
+    delete[] data;
+}
@@ -0,0 +1,117 @@
+#ifndef VIDEOPLAYER_KEYFRAMEINDEX_H
+#define VIDEOPLAYER_KEYFRAMEINDEX_H
+
+#include <vector>
+#include <sys/stat.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * 关键帧索引：视频流每个关键帧的 pts、字节偏移和大小。
+ *
+ * FLV、MPEG-TS、裸流等容器没有（或没有完整的）索引，av_seek_frame 需要二分查找或者顺序扫描，
+ * 几个G的录像文件seek会很慢。播放时顺序读取到的关键帧记录下来，停止时写入缓存目录的旁路文件，
+ * 下次打开同一个文件时用mmap映射，seek直接按字节偏移跳到目标之前最近的关键帧。
+ *
+ * 只在解封装线程中使用（seek也在解封装线程中执行），不需要加锁。
+ */
+class KeyframeIndex {
+
+public:
+    struct Entry {
+        int64_t pts; // 时间戳，单位为流的时间基
+        int64_t pos; // 压缩包在文件中的字节偏移
+        int32_t size; // 压缩包的大小
+        int32_t reserved;
+    };
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        int64_t file_size; // 媒体文件的大小，用于校验
+        int64_t file_mtime; // 媒体文件的修改时间，用于校验
+        int32_t stream_index;
+        int32_t time_base_num;
+        int32_t time_base_den;
+        int32_t complete; // 是否一直索引到了文件结尾
+        int64_t count; // 索引的条数
+    };
+
+    char path[512]; // 旁路文件路径
+    struct stat file_stat; // 媒体文件信息
+    int stream_index;
+    AVRational time_base;
+
+    void *map = 0; // mmap映射的旁路文件
+    size_t map_size = 0;
+    const Entry *mapped = 0; // 旁路文件中的索引（只读）
+    int64_t mapped_count = 0;
+    std::vector<Entry> appended; // 本次播放新增的索引，时间戳都大于旁路文件中的索引
+
+    bool complete = false; // 是否一直索引到了文件结尾
+    bool linked = true; // 当前读取的位置与已有的索引是否连续，seek到索引覆盖范围之外后不再记录，直到回到覆盖范围
+    bool dirty = false; // 是否有需要写入旁路文件的新索引
+
+    KeyframeIndex(const char *path, const struct stat &st, int stream_index, AVRational time_base);
+
+    void load();
+
+    const Entry &at(int64_t i) const;
+
+public:
+    int64_t seek_hits = 0; // 通过索引完成的seek次数
+
+    virtual ~KeyframeIndex();
+
+    /**
+     * 打开媒体文件的关键帧索引，旁路文件存在并且有效时映射进来。
+     * @return 网络流、没有设置缓存目录或者容器不支持按字节seek时返回nullptr
+     */
+    static KeyframeIndex *open(const char *data_source, AVFormatContext *formatContext, int stream_index);
+
+    /**
+     * 解封装线程读到视频压缩包时调用，记录关键帧。
+     */
+    void add(AVPacket *packet);
+
+    /**
+     * seek之后调用，读取位置可能离开了索引覆盖的范围。
+     */
+    void onSeek();
+
+    /**
+     * 读到文件结尾时调用。
+     */
+    void onEof();
+
+    /**
+     * 查找目标之前（含）最近的关键帧。
+     * @param target 目标时间，单位微秒
+     * @return 目标超出了索引覆盖的范围时返回false
+     */
+    bool lookup(int64_t target, Entry *entry);
+
+    /**
+     * 索引覆盖范围的时长，单位微秒。索引完整时可以作为没有时长信息的文件的总时长。
+     */
+    int64_t coveredDuration();
+
+    /**
+     * 索引的条数
+     */
+    int64_t count() const;
+
+    bool isComplete() const {
+        return complete;
+    }
+
+    /**
+     * 把索引写入旁路文件
+     */
+    void save();
+};
+
+#endif //VIDEOPLAYER_KEYFRAMEINDEX_H
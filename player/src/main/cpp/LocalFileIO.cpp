@@ -0,0 +1,137 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LocalFileIO.h"
+#include "PlayerStats.h"
+#include "Log.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+LocalFileIO *LocalFileIO::open(const char *data_source) {
+    if (strstr(data_source, "://") && strncmp(data_source, "file://", 7) != 0) {
+        return nullptr; // 网络流
+    }
+    if (!strncmp(data_source, "file://", 7)) {
+        data_source += 7;
+    }
+    int fd = ::open(data_source, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        LOGD("映射文件失败 %s\n", data_source)
+        close(fd);
+        return nullptr;
+    }
+
+    auto *io = new LocalFileIO();
+    io->fd = fd;
+    io->data = static_cast<uint8_t *>(data);
+    io->size = st.st_size;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL); // 顺序读取，内核加大预读
+    io->syscalls++;
+    io->readAhead();
+
+    auto *buffer = static_cast<uint8_t *>(av_malloc(LOCAL_IO_BUFFER_SIZE));
+    io->pb = avio_alloc_context(buffer, LOCAL_IO_BUFFER_SIZE, 0, io, read_packet, nullptr, seek);
+    if (!io->pb) {
+        av_free(buffer);
+        delete io;
+        return nullptr;
+    }
+    return io;
+}
+
+LocalFileIO::~LocalFileIO() {
+    if (pb) {
+        av_freep(&pb->buffer); // 缓冲区可能被ffmpeg重新分配过，释放当前的
+        avio_context_free(&pb);
+    }
+    if (data) {
+        munmap(data, size);
+        data = nullptr;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+void LocalFileIO::fetchStats(int64_t *stats) {
+    stats[STAT_IO_BYTES] = bytes_read;
+    stats[STAT_IO_SYSCALLS] = syscalls;
+    stats[STAT_IO_STALL_US] = stall_time;
+}
+
+/**
+ * 读取位置接近已经预读的结尾时，把之后的一个窗口交给内核异步读入页缓存（不阻塞）。
+ */
+void LocalFileIO::readAhead() {
+    if (advised_end >= size || position + LOCAL_IO_READ_AHEAD / 2 < advised_end) {
+        return;
+    }
+    int64_t start = position > advised_end ? position : advised_end;
+    posix_fadvise(fd, start, LOCAL_IO_READ_AHEAD, POSIX_FADV_WILLNEED);
+    syscalls++;
+    advised_end = start + LOCAL_IO_READ_AHEAD;
+}
+
+int LocalFileIO::read_packet(void *opaque, uint8_t *buf, int buf_size) {
+    auto *io = static_cast<LocalFileIO *>(opaque);
+    if (io->position >= io->size) {
+        return AVERROR_EOF;
+    }
+    int length = (int) FFMIN((int64_t) buf_size, io->size - io->position);
+
+    // 数据不在页缓存中时，拷贝会因为缺页等待存储
+    int64_t start = av_gettime_relative();
+    memcpy(buf, io->data + io->position, length);
+    int64_t cost = av_gettime_relative() - start;
+    if (cost > LOCAL_IO_STALL_THRESHOLD) {
+        io->stall_time += cost;
+    }
+
+    io->position += length;
+    io->bytes_read += length;
+    io->readAhead();
+    return length;
+}
+
+int64_t LocalFileIO::seek(void *opaque, int64_t offset, int whence) {
+    auto *io = static_cast<LocalFileIO *>(opaque);
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return io->size;
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = io->position + offset;
+            break;
+        case SEEK_END:
+            target = io->size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (target < 0 || target > io->size) {
+        return AVERROR(EINVAL);
+    }
+    if (target < io->position || target > io->advised_end) {
+        io->advised_end = target; // 跳出了预读窗口，从新的位置重新预读
+    }
+    io->position = target;
+    io->readAhead();
+    return target;
+}
@@ -0,0 +1,52 @@
+#ifndef VIDEOPLAYER_LOCALFILEIO_H
+#define VIDEOPLAYER_LOCALFILEIO_H
+
+#include "MediaIO.h"
+
+#define LOCAL_IO_BUFFER_SIZE (64 * 1024) // AVIOContext的缓冲区大小
+#define LOCAL_IO_READ_AHEAD (4 * 1024 * 1024) // 预读窗口，读取位置之后提前交给内核读入页缓存的字节数
+#define LOCAL_IO_STALL_THRESHOLD 2000 // 单次读取超过该耗时（缺页等待存储）记为卡顿，单位微秒
+
+/**
+ * 本地文件的自定义读取（AVIOContext）。
+ *
+ * ffmpeg默认的file协议在解封装线程中一次次地read小块数据，存储慢的时候av_read_frame直接等待IO。
+ * 这里把整个文件用mmap映射，读取就是内存拷贝；读取位置之后的一段用posix_fadvise(WILLNEED)提前交给内核异步读入页缓存，
+ * 解封装线程读到时数据已经在内存中。seek只是改变位置，预读窗口跟着移动。
+ *
+ * 只在一个解封装线程中使用。映射失败（32位进程映射很大的文件等）时返回空，调用方使用默认的file协议。
+ */
+class LocalFileIO : public MediaIO {
+
+private:
+    int fd = -1;
+    uint8_t *data = 0; // 映射的文件内容
+    int64_t size = 0; // 文件大小
+    int64_t position = 0; // 当前的读取位置
+    int64_t advised_end = 0; // 已经交给内核预读到的位置
+
+    LocalFileIO() = default;
+
+    void readAhead();
+
+    static int read_packet(void *opaque, uint8_t *buf, int buf_size);
+
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+
+public:
+    int64_t bytes_read = 0; // 读取的字节数
+    int64_t syscalls = 0; // 读取过程中的系统调用次数（预读），默认file协议每次read都是一次系统调用
+    int64_t stall_time = 0; // 卡顿（单次读取超过阈值）的累计耗时，单位微秒
+
+    /**
+     * @param data_source 媒体地址，只支持本地文件（路径或者file://）
+     * @return 不是本地文件或者映射失败时返回空
+     */
+    static LocalFileIO *open(const char *data_source);
+
+    ~LocalFileIO();
+
+    void fetchStats(int64_t *stats) override;
+};
+
+#endif //VIDEOPLAYER_LOCALFILEIO_H
@@ -5,9 +5,15 @@
 #ifndef VIDEOPLAYER_LOG_H
 #define VIDEOPLAYER_LOG_H
 
-#include <android/log.h>
-
 #define TAG "Lxc_log" // __VA_ARGS__ 代表...的可变参数
+
+#ifdef __ANDROID__
+#include <android/log.h>
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__);
+#else
+// 在主机上运行（如使用空音频输出跑性能测试）时，日志输出到标准错误。
+#include <cstdio>
+#define LOGD(...) fprintf(stderr, __VA_ARGS__);
+#endif
 
 #endif //VIDEOPLAYER_LOG_H
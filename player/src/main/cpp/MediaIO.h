@@ -0,0 +1,29 @@
+#ifndef VIDEOPLAYER_MEDIAIO_H
+#define VIDEOPLAYER_MEDIAIO_H
+
+#include <cstdint>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * 自定义读取（AVIOContext）的抽象。
+ *
+ * 设置给AVFormatContext的pb（同时设置 AVFMT_FLAG_CUSTOM_IO），解封装从这里读取数据，
+ * 而不是ffmpeg默认的协议。必须在使用它的AVFormatContext关闭之后释放。
+ */
+class MediaIO {
+
+public:
+    AVIOContext *pb = 0;
+
+    virtual ~MediaIO() {}
+
+    /**
+     * 填入读取的统计，下标见 PlayerStats.h
+     */
+    virtual void fetchStats(int64_t *stats) {}
+};
+
+#endif //VIDEOPLAYER_MEDIAIO_H
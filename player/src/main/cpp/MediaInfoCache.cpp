@@ -0,0 +1,267 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "MediaInfoCache.h"
+#include "CacheFile.h"
+#include "Log.h"
+
+#define MEDIA_INFO_MAGIC 0x31464E49 // "INF1"
+#define MEDIA_INFO_VERSION 1
+
+struct MediaInfoHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t file_size; // 媒体文件的大小，用于校验
+    int64_t file_mtime; // 媒体文件的修改时间，用于校验
+    int64_t duration; // 总时长，单位 AV_TIME_BASE
+    int64_t start_time;
+    int64_t bit_rate;
+    int32_t nb_streams;
+    int32_t reserved;
+};
+
+/**
+ * 一个流的信息，后面紧跟 extradata_size 字节的extradata。
+ */
+struct MediaInfoStream {
+    int32_t codec_type;
+    int32_t codec_id;
+    uint32_t codec_tag;
+    int32_t format; // 像素格式或采样格式
+    int64_t bit_rate;
+    int32_t bits_per_coded_sample;
+    int32_t bits_per_raw_sample;
+    int32_t profile;
+    int32_t level;
+    int32_t width;
+    int32_t height;
+    int32_t sample_aspect_ratio_num;
+    int32_t sample_aspect_ratio_den;
+    int32_t field_order;
+    int32_t color_range;
+    int32_t color_primaries;
+    int32_t color_trc;
+    int32_t color_space;
+    int32_t chroma_location;
+    int32_t video_delay;
+    uint64_t channel_layout;
+    int32_t channels;
+    int32_t sample_rate;
+    int32_t block_align;
+    int32_t frame_size;
+    int32_t initial_padding;
+    int32_t trailing_padding;
+    int32_t seek_preroll;
+    int32_t time_base_num;
+    int32_t time_base_den;
+    int32_t avg_frame_rate_num;
+    int32_t avg_frame_rate_den;
+    int32_t r_frame_rate_num;
+    int32_t r_frame_rate_den;
+    int32_t disposition;
+    int64_t start_time;
+    int64_t duration;
+    int32_t extradata_size;
+    int32_t reserved;
+};
+
+/**
+ * 读取整个缓存文件
+ */
+static bool read_file(const char *path, std::vector<uint8_t> &data) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    bool result = size > 0;
+    if (result) {
+        data.resize(size);
+        result = fread(data.data(), 1, size, file) == (size_t) size;
+    }
+    fclose(file);
+    return result;
+}
+
+bool MediaInfoCache::restore(const char *data_source, AVFormatContext *formatContext) {
+    char path[512];
+    struct stat st;
+    if (!CacheFile::path(data_source, "info", path, sizeof(path), &st)) {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    if (!read_file(path, data) || data.size() < sizeof(MediaInfoHeader)) {
+        return false;
+    }
+
+    MediaInfoHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != MEDIA_INFO_MAGIC || header.version != MEDIA_INFO_VERSION
+        || header.file_size != st.st_size || header.file_mtime != st.st_mtime) {
+        LOGD("媒体信息缓存已失效 %s\n", path)
+        return false;
+    }
+    // 部分容器（如flv、ts）在读取数据时才创建流，打开后流的个数与缓存不一致，只能重新探测。
+    if (header.nb_streams != (int) formatContext->nb_streams) {
+        return false;
+    }
+
+    // 先校验全部的流，再修改formatContext，失败时formatContext保持原样。
+    std::vector<MediaInfoStream> streams(header.nb_streams);
+    std::vector<const uint8_t *> extradata(header.nb_streams);
+    size_t offset = sizeof(header);
+    for (int i = 0; i < header.nb_streams; i++) {
+        if (offset + sizeof(MediaInfoStream) > data.size()) {
+            return false;
+        }
+        memcpy(&streams[i], data.data() + offset, sizeof(MediaInfoStream));
+        offset += sizeof(MediaInfoStream);
+        if (streams[i].extradata_size < 0 || offset + streams[i].extradata_size > data.size()) {
+            return false;
+        }
+        extradata[i] = data.data() + offset;
+        offset += streams[i].extradata_size;
+
+        AVStream *stream = formatContext->streams[i];
+        if (stream->codecpar->codec_id != AV_CODEC_ID_NONE
+            && stream->codecpar->codec_id != streams[i].codec_id) {
+            return false;
+        }
+        if (stream->time_base.num != streams[i].time_base_num
+            || stream->time_base.den != streams[i].time_base_den) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < header.nb_streams; i++) {
+        const MediaInfoStream &info = streams[i];
+        AVStream *stream = formatContext->streams[i];
+        AVCodecParameters *par = stream->codecpar;
+        par->codec_type = (AVMediaType) info.codec_type;
+        par->codec_id = (AVCodecID) info.codec_id;
+        par->codec_tag = info.codec_tag;
+        par->format = info.format;
+        par->bit_rate = info.bit_rate;
+        par->bits_per_coded_sample = info.bits_per_coded_sample;
+        par->bits_per_raw_sample = info.bits_per_raw_sample;
+        par->profile = info.profile;
+        par->level = info.level;
+        par->width = info.width;
+        par->height = info.height;
+        par->sample_aspect_ratio = {info.sample_aspect_ratio_num, info.sample_aspect_ratio_den};
+        par->field_order = (AVFieldOrder) info.field_order;
+        par->color_range = (AVColorRange) info.color_range;
+        par->color_primaries = (AVColorPrimaries) info.color_primaries;
+        par->color_trc = (AVColorTransferCharacteristic) info.color_trc;
+        par->color_space = (AVColorSpace) info.color_space;
+        par->chroma_location = (AVChromaLocation) info.chroma_location;
+        par->video_delay = info.video_delay;
+        par->channel_layout = info.channel_layout;
+        par->channels = info.channels;
+        par->sample_rate = info.sample_rate;
+        par->block_align = info.block_align;
+        par->frame_size = info.frame_size;
+        par->initial_padding = info.initial_padding;
+        par->trailing_padding = info.trailing_padding;
+        par->seek_preroll = info.seek_preroll;
+
+        av_freep(&par->extradata);
+        par->extradata_size = 0;
+        if (info.extradata_size) {
+            par->extradata = static_cast<uint8_t *>(
+                    av_mallocz(info.extradata_size + AV_INPUT_BUFFER_PADDING_SIZE));
+            memcpy(par->extradata, extradata[i], info.extradata_size);
+            par->extradata_size = info.extradata_size;
+        }
+
+        stream->avg_frame_rate = {info.avg_frame_rate_num, info.avg_frame_rate_den};
+        stream->r_frame_rate = {info.r_frame_rate_num, info.r_frame_rate_den};
+        stream->disposition = info.disposition;
+        stream->start_time = info.start_time;
+        stream->duration = info.duration;
+    }
+    formatContext->duration = header.duration;
+    formatContext->start_time = header.start_time;
+    formatContext->bit_rate = header.bit_rate;
+    return true;
+}
+
+void MediaInfoCache::save(const char *data_source, AVFormatContext *formatContext) {
+    char path[512];
+    struct stat st;
+    if (!CacheFile::path(data_source, "info", path, sizeof(path), &st)) {
+        return;
+    }
+
+    MediaInfoHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MEDIA_INFO_MAGIC;
+    header.version = MEDIA_INFO_VERSION;
+    header.file_size = st.st_size;
+    header.file_mtime = st.st_mtime;
+    header.duration = formatContext->duration;
+    header.start_time = formatContext->start_time;
+    header.bit_rate = formatContext->bit_rate;
+    header.nb_streams = formatContext->nb_streams;
+
+    std::vector<uint8_t> data(sizeof(header));
+    memcpy(data.data(), &header, sizeof(header));
+
+    for (int i = 0; i < header.nb_streams; i++) {
+        AVStream *stream = formatContext->streams[i];
+        AVCodecParameters *par = stream->codecpar;
+        MediaInfoStream info;
+        memset(&info, 0, sizeof(info));
+        info.codec_type = par->codec_type;
+        info.codec_id = par->codec_id;
+        info.codec_tag = par->codec_tag;
+        info.format = par->format;
+        info.bit_rate = par->bit_rate;
+        info.bits_per_coded_sample = par->bits_per_coded_sample;
+        info.bits_per_raw_sample = par->bits_per_raw_sample;
+        info.profile = par->profile;
+        info.level = par->level;
+        info.width = par->width;
+        info.height = par->height;
+        info.sample_aspect_ratio_num = par->sample_aspect_ratio.num;
+        info.sample_aspect_ratio_den = par->sample_aspect_ratio.den;
+        info.field_order = par->field_order;
+        info.color_range = par->color_range;
+        info.color_primaries = par->color_primaries;
+        info.color_trc = par->color_trc;
+        info.color_space = par->color_space;
+        info.chroma_location = par->chroma_location;
+        info.video_delay = par->video_delay;
+        info.channel_layout = par->channel_layout;
+        info.channels = par->channels;
+        info.sample_rate = par->sample_rate;
+        info.block_align = par->block_align;
+        info.frame_size = par->frame_size;
+        info.initial_padding = par->initial_padding;
+        info.trailing_padding = par->trailing_padding;
+        info.seek_preroll = par->seek_preroll;
+        info.time_base_num = stream->time_base.num;
+        info.time_base_den = stream->time_base.den;
+        info.avg_frame_rate_num = stream->avg_frame_rate.num;
+        info.avg_frame_rate_den = stream->avg_frame_rate.den;
+        info.r_frame_rate_num = stream->r_frame_rate.num;
+        info.r_frame_rate_den = stream->r_frame_rate.den;
+        info.disposition = stream->disposition;
+        info.start_time = stream->start_time;
+        info.duration = stream->duration;
+        info.extradata_size = par->extradata ? par->extradata_size : 0;
+
+        size_t offset = data.size();
+        data.resize(offset + sizeof(info) + info.extradata_size);
+        memcpy(data.data() + offset, &info, sizeof(info));
+        if (info.extradata_size) {
+            memcpy(data.data() + offset + sizeof(info), par->extradata, info.extradata_size);
+        }
+    }
+
+    if (CacheFile::write(path, data.data(), data.size())) {
+        LOGD("媒体信息缓存保存完成 %s\n", path)
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef VIDEOPLAYER_MEDIAINFOCACHE_H
+#define VIDEOPLAYER_MEDIAINFOCACHE_H
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * 媒体信息缓存：流的布局、解码参数（包括extradata）和时长。
+ *
+ * avformat_find_stream_info 会读取并解码一段数据来探测流信息，是prepare中最耗时的一步。
+ * 同一个本地文件再次打开时，直接把缓存的参数恢复到各个流中，跳过探测。
+ * 缓存以文件路径的哈希命名，头部记录文件的大小和修改时间，文件改变后自动失效并重新探测。
+ */
+class MediaInfoCache {
+
+public:
+    /**
+     * avformat_open_input 之后调用，把缓存的信息恢复到formatContext。
+     * @return 缓存有效并恢复成功返回true，此时不需要再调用 avformat_find_stream_info
+     */
+    static bool restore(const char *data_source, AVFormatContext *formatContext);
+
+    /**
+     * avformat_find_stream_info 成功之后调用，保存探测到的信息。
+     */
+    static void save(const char *data_source, AVFormatContext *formatContext);
+};
+
+#endif //VIDEOPLAYER_MEDIAINFOCACHE_H
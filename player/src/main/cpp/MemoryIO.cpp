@@ -0,0 +1,172 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "MemoryIO.h"
+#include "PlayerStats.h"
+#include "Log.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+pthread_mutex_t MemoryIO::mutex = PTHREAD_MUTEX_INITIALIZER;
+std::map<int, MemorySource *> MemoryIO::sources;
+int MemoryIO::next_id = 1;
+
+int MemoryIO::registerSource(const uint8_t *data, int64_t size, MemoryReadCallback read,
+                             MemoryReleaseCallback release, void *opaque, char *url, int url_size) {
+    auto *source = new MemorySource();
+    source->data = data;
+    source->size = size;
+    source->read = read;
+    source->release = release;
+    source->opaque = opaque;
+    source->refs = 1; // 注册表持有
+
+    pthread_mutex_lock(&mutex);
+    int id = next_id++;
+    sources[id] = source;
+    pthread_mutex_unlock(&mutex);
+
+    snprintf(url, url_size, "%s%d", MEMORY_IO_SCHEME, id);
+    LOGD("注册内存来源 %s，大小 %lld\n", url, (long long) size)
+    return id;
+}
+
+void MemoryIO::unregisterSource(const char *url) {
+    if (!isMemory(url)) {
+        return;
+    }
+    int id = atoi(url + strlen(MEMORY_IO_SCHEME));
+    MemorySource *source = nullptr;
+    pthread_mutex_lock(&mutex);
+    auto it = sources.find(id);
+    if (it != sources.end()) {
+        source = it->second;
+        sources.erase(it);
+    }
+    pthread_mutex_unlock(&mutex);
+    if (source) {
+        unref(source);
+    }
+}
+
+void MemoryIO::unref(MemorySource *source) {
+    pthread_mutex_lock(&mutex);
+    bool last = --source->refs == 0;
+    pthread_mutex_unlock(&mutex);
+    if (last) {
+        if (source->release) {
+            source->release(source->opaque);
+        }
+        delete source;
+    }
+}
+
+bool MemoryIO::isMemory(const char *data_source) {
+    return !strncmp(data_source, MEMORY_IO_SCHEME, strlen(MEMORY_IO_SCHEME));
+}
+
+MemoryIO *MemoryIO::open(const char *data_source) {
+    if (!isMemory(data_source)) {
+        return nullptr;
+    }
+    int id = atoi(data_source + strlen(MEMORY_IO_SCHEME));
+    MemorySource *source = nullptr;
+    pthread_mutex_lock(&mutex);
+    auto it = sources.find(id);
+    if (it != sources.end()) {
+        source = it->second;
+        source->refs++;
+    }
+    pthread_mutex_unlock(&mutex);
+    if (!source) {
+        LOGD("内存来源不存在 %s\n", data_source)
+        return nullptr;
+    }
+
+    auto *io = new MemoryIO();
+    io->source = source;
+    auto *buffer = static_cast<uint8_t *>(av_malloc(MEMORY_IO_BUFFER_SIZE));
+    io->pb = avio_alloc_context(buffer, MEMORY_IO_BUFFER_SIZE, 0, io, read_packet, nullptr, seek);
+    if (!io->pb) {
+        av_free(buffer);
+        delete io;
+        return nullptr;
+    }
+    return io;
+}
+
+MemoryIO::~MemoryIO() {
+    if (pb) {
+        av_freep(&pb->buffer); // 缓冲区可能被ffmpeg重新分配过，释放当前的
+        avio_context_free(&pb);
+    }
+    if (source) {
+        unref(source);
+        source = nullptr;
+    }
+}
+
+void MemoryIO::fetchStats(int64_t *stats) {
+    stats[STAT_IO_BYTES] = bytes_read;
+    stats[STAT_MEMORY_SOURCE_BYTES] = source->size > 0 ? source->size : 0;
+    stats[STAT_PULL_CALLS] = pull_calls;
+    stats[STAT_PULL_US] = pull_time;
+}
+
+int MemoryIO::read_packet(void *opaque, uint8_t *buf, int buf_size) {
+    auto *io = static_cast<MemoryIO *>(opaque);
+    MemorySource *source = io->source;
+    if (source->size >= 0 && io->position >= source->size) {
+        return AVERROR_EOF;
+    }
+
+    int length;
+    if (source->data) {
+        length = (int) FFMIN((int64_t) buf_size, source->size - io->position);
+        memcpy(buf, source->data + io->position, length);
+    } else {
+        int64_t start = av_gettime_relative();
+        length = source->read(source->opaque, buf, buf_size, io->position);
+        io->pull_time += av_gettime_relative() - start;
+        io->pull_calls++;
+        if (length <= 0) {
+            return AVERROR_EOF;
+        }
+        length = FFMIN(length, buf_size);
+    }
+    io->position += length;
+    io->bytes_read += length;
+    return length;
+}
+
+int64_t MemoryIO::seek(void *opaque, int64_t offset, int whence) {
+    auto *io = static_cast<MemoryIO *>(opaque);
+    int64_t size = io->source->size;
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return size >= 0 ? size : AVERROR(ENOSYS);
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = io->position + offset;
+            break;
+        case SEEK_END:
+            if (size < 0) {
+                return AVERROR(ENOSYS);
+            }
+            target = size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    // 回调来源按位置拉取，seek只是改变位置；不知道大小时不能相对结尾seek
+    if (target < 0 || (size >= 0 && target > size)) {
+        return AVERROR(EINVAL);
+    }
+    io->position = target;
+    return target;
+}
@@ -0,0 +1,84 @@
+#ifndef VIDEOPLAYER_MEMORYIO_H
+#define VIDEOPLAYER_MEMORYIO_H
+
+#include <map>
+#include <pthread.h>
+#include "MediaIO.h"
+
+#define MEMORY_IO_SCHEME "memory://" // 内存来源的地址前缀，后面是注册的编号
+#define MEMORY_IO_BUFFER_SIZE (64 * 1024) // AVIOContext的缓冲区大小
+
+typedef int (*MemoryReadCallback)(void *opaque, uint8_t *buf, int size, int64_t position); // 按位置拉取数据，返回读到的字节数，<= 0 表示结尾
+typedef void (*MemoryReleaseCallback)(void *opaque); // 来源不再使用时释放opaque
+
+/**
+ * 内存中的媒体来源：一块已有的内存（如Java的DirectByteBuffer），或者按位置拉取数据的回调（分块解密、下载等）。
+ * 由注册表和正在读取它的MemoryIO共同持有，最后一个持有者释放时调用release。
+ */
+struct MemorySource {
+    const uint8_t *data; // 内存的地址，使用回调时为空
+    int64_t size; // 数据的大小，回调不知道大小时为-1
+    MemoryReadCallback read;
+    MemoryReleaseCallback release;
+    void *opaque; // 交给read和release的参数
+    int refs;
+};
+
+/**
+ * 内存来源的自定义读取（AVIOContext）。
+ *
+ * 加密或者打包在应用中的媒体不需要先写入临时文件：注册内存来源得到一个 memory:// 地址，按普通的地址播放，
+ * 打开时按地址找到来源。内存块直接从原来的内存拷贝到AVIOContext的缓冲区，不复制整个媒体；
+ * 回调直接填充AVIOContext的缓冲区。
+ *
+ * 每次打开都是独立的读取位置，辅助读取器、双读取器可以同时读取同一个来源（回调需要支持按位置并发读取）。
+ */
+class MemoryIO : public MediaIO {
+
+private:
+    static pthread_mutex_t mutex;
+    static std::map<int, MemorySource *> sources; // 注册表，编号 -> 来源
+    static int next_id;
+
+    MemorySource *source = 0;
+    int64_t position = 0; // 当前的读取位置
+
+    MemoryIO() = default;
+
+    static void unref(MemorySource *source);
+
+    static int read_packet(void *opaque, uint8_t *buf, int buf_size);
+
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+
+public:
+    int64_t bytes_read = 0; // 读取的字节数
+    int64_t pull_calls = 0; // 调用拉取回调的次数
+    int64_t pull_time = 0; // 拉取回调的累计耗时，单位微秒
+
+    /**
+     * 注册内存来源
+     * @param url 输出播放使用的地址
+     * @return 来源的编号
+     */
+    static int registerSource(const uint8_t *data, int64_t size, MemoryReadCallback read,
+                              MemoryReleaseCallback release, void *opaque, char *url, int url_size);
+
+    /**
+     * 取消注册，正在读取的播放器读取结束后才释放来源
+     */
+    static void unregisterSource(const char *url);
+
+    static bool isMemory(const char *data_source);
+
+    /**
+     * @return 不是内存来源的地址、或者来源已经取消注册时返回空
+     */
+    static MemoryIO *open(const char *data_source);
+
+    ~MemoryIO();
+
+    void fetchStats(int64_t *stats) override;
+};
+
+#endif //VIDEOPLAYER_MEMORYIO_H
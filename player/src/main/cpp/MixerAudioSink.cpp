@@ -0,0 +1,86 @@
+#include <unistd.h>
+#include "MixerAudioSink.h"
+#include "util.h"
+
+MixerAudioSink::~MixerAudioSink() {
+    stop();
+}
+
+void *task_mixer_pull(void *args) {
+    auto *sink = static_cast<MixerAudioSink *>(args);
+    sink->pull();
+    return nullptr;
+}
+
+bool MixerAudioSink::open(int sample_rate, int channels, int sample_size) {
+    if (sample_rate != AudioMixer::SAMPLE_RATE || channels != AudioMixer::CHANNELS
+        || sample_size != AudioMixer::SAMPLE_SIZE) {
+        LOGD("混音器不支持的PCM格式 %d %d %d\n", sample_rate, channels, sample_size)
+        return false;
+    }
+    this->sample_rate = sample_rate;
+    this->channels = channels;
+    this->sample_size = sample_size;
+
+    int64_t begin = monotonic_time();
+    source = AudioMixer::addSource();
+    if (!source) {
+        return false;
+    }
+    setGain(gain, mute);
+    setup_time = monotonic_time() - begin;
+
+    is_running = true;
+    pthread_create(&pid_pull, nullptr, task_mixer_pull, this);
+    return true;
+}
+
+/**
+ * 运行在子线程，把PCM搬运到混音器
+ */
+void MixerAudioSink::pull() {
+    uint8_t *pcm_data = 0;
+    while (is_running) {
+        int pcm_size = pcmCallback(args, &pcm_data);
+        if (pcm_size <= 0) {
+            usleep(2 * 1000); // 没有数据（已停止），避免空转
+            continue;
+        }
+        source->write(reinterpret_cast<int16_t *>(pcm_data), pcm_size / sample_size);
+    }
+}
+
+void MixerAudioSink::stop() {
+    if (!is_running) {
+        return;
+    }
+    is_running = false;
+    source->stop(); // 唤醒阻塞在混音器缓冲区上的线程
+    pthread_join(pid_pull, nullptr);
+    AudioMixer::removeSource(source);
+    source = nullptr;
+}
+
+void MixerAudioSink::setGain(float gain, bool mute) {
+    this->gain = gain;
+    this->mute = mute;
+    if (source) {
+        if (gain < 0) {
+            gain = 0;
+        } else if (gain > 1) {
+            gain = 1;
+        }
+        source->gain = (int) (gain * 32767);
+        source->mute = mute;
+    }
+}
+
+/**
+ * 环形缓冲区中等待混音的数据，加上混音器交给输出的一块
+ */
+double MixerAudioSink::latency() {
+    if (!source) {
+        return 0;
+    }
+    return (double) (source->queued() + AudioMixer::MIX_SAMPLES) / (AudioMixer::SAMPLE_RATE * AudioMixer::CHANNELS);
+}
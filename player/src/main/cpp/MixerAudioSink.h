@@ -0,0 +1,37 @@
+#ifndef VIDEOPLAYER_MIXERAUDIOSINK_H
+#define VIDEOPLAYER_MIXERAUDIOSINK_H
+
+#include <pthread.h>
+#include "AudioSink.h"
+#include "AudioMixer.h"
+
+/**
+ * 把PCM送入共享的软件混音器。
+ *
+ * 在自己的线程中拉取PCM写入MixerSource，混音器的缓冲区满时阻塞，节奏由混音器的输出决定。
+ * 要求PCM的格式与混音器一致（44100、双声道、16bit）。
+ */
+class MixerAudioSink : public AudioSink {
+
+private:
+    pthread_t pid_pull;
+    bool is_running = false;
+    MixerSource *source = 0;
+    float gain = 1.0f;
+    bool mute = false;
+
+public:
+    virtual ~MixerAudioSink();
+
+    bool open(int sample_rate, int channels, int sample_size) override;
+
+    void stop() override;
+
+    void setGain(float gain, bool mute) override;
+
+    double latency() override;
+
+    void pull();
+};
+
+#endif //VIDEOPLAYER_MIXERAUDIOSINK_H
@@ -0,0 +1,73 @@
+#include "NullAudioSink.h"
+
+NullAudioSink::NullAudioSink(bool real_time) {
+    this->real_time = real_time;
+}
+
+NullAudioSink::~NullAudioSink() {
+    stop();
+}
+
+void *task_audio_pull(void *args) {
+    auto *sink = static_cast<NullAudioSink *>(args);
+    sink->pull();
+    return nullptr;
+}
+
+bool NullAudioSink::open(int sample_rate, int channels, int sample_size) {
+    this->sample_rate = sample_rate;
+    this->channels = channels;
+    this->sample_size = sample_size;
+
+    total_bytes = 0;
+    start_time = monotonic_time();
+    is_running = true;
+    pthread_create(&pid_pull, nullptr, task_audio_pull, this);
+    return true;
+}
+
+/**
+ * 运行在子线程，代替声卡驱动拉取PCM
+ */
+void NullAudioSink::pull() {
+    int bytes_per_second = sample_rate * channels * sample_size;
+    uint8_t *pcm_data = 0;
+
+    while (is_running) {
+        int pcm_size = pcmCallback(args, &pcm_data);
+        if (pcm_size <= 0) {
+            usleep(2 * 1000); // 没有数据（已停止），避免空转
+            continue;
+        }
+
+        onPcm(pcm_data, pcm_size);
+        total_bytes += pcm_size;
+
+        if (real_time) {
+            // 按照已消费PCM的时长等待，与声卡的消费速度一致。
+            int64_t play_time = total_bytes * 1000000 / bytes_per_second;
+            int64_t wait_time = start_time + play_time - monotonic_time();
+            if (wait_time > 0) {
+                usleep(wait_time);
+            }
+        }
+    }
+}
+
+void NullAudioSink::stop() {
+    if (!is_running) {
+        return;
+    }
+    is_running = false;
+    pthread_join(pid_pull, nullptr);
+
+    // 统计：消费的音频时长与实际耗时的比值，free run 模式下即为解码+重采样的吞吐（多少倍实时）。
+    int64_t elapsed = monotonic_time() - start_time;
+    int bytes_per_second = sample_rate * channels * sample_size;
+    if (elapsed > 0 && bytes_per_second > 0) {
+        double media_seconds = (double) total_bytes / bytes_per_second;
+        LOGD("NullAudioSink 消费PCM %lld 字节，音频时长 %.2lfs，耗时 %.2lfs，%.2lf 倍实时\n",
+             (long long) total_bytes, media_seconds, elapsed / 1000000.0,
+             media_seconds * 1000000.0 / elapsed)
+    }
+}
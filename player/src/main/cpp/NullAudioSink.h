@@ -0,0 +1,44 @@
+#ifndef VIDEOPLAYER_NULLAUDIOSINK_H
+#define VIDEOPLAYER_NULLAUDIOSINK_H
+
+#include <pthread.h>
+#include <unistd.h>
+#include "AudioSink.h"
+#include "Log.h"
+#include "util.h"
+
+/**
+ * 空输出：在自己的线程中拉取PCM并丢弃，不依赖声卡，可以在没有OpenSL的主机上运行。
+ *
+ * real_time 为 true 时按照PCM的时长控制拉取速度（模拟声卡）；
+ * 为 false 时尽可能快地拉取，stop时输出解码+重采样的吞吐。
+ */
+class NullAudioSink : public AudioSink {
+
+private:
+    pthread_t pid_pull;
+    bool real_time;
+    bool is_running = false;
+
+protected:
+    int64_t total_bytes = 0; // 已消费的PCM字节数
+    int64_t start_time = 0; // 开始拉取的时间，单位微秒
+
+    /**
+     * 拿到一段PCM后的处理，空输出直接丢弃。
+     */
+    virtual void onPcm(uint8_t *data, int size) {}
+
+public:
+    explicit NullAudioSink(bool real_time);
+
+    virtual ~NullAudioSink();
+
+    bool open(int sample_rate, int channels, int sample_size) override;
+
+    void stop() override;
+
+    void pull();
+};
+
+#endif //VIDEOPLAYER_NULLAUDIOSINK_H
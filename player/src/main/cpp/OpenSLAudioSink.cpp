@@ -0,0 +1,161 @@
+#include "OpenSLAudioSink.h"
+
+OpenSLAudioSink::~OpenSLAudioSink() {
+    stop();
+}
+
+/**
+ * 回调函数
+ *
+ * @param bq 缓冲池队列接口
+ * @param args 给回调函数的参数
+ */
+void bqPlayerCallback(SLAndroidSimpleBufferQueueItf bq, void *args) {
+    auto *sink = static_cast<OpenSLAudioSink *>(args);
+    sink->enqueue(bq);
+}
+
+void OpenSLAudioSink::enqueue(SLAndroidSimpleBufferQueueItf bq) {
+    uint8_t *pcm_data = 0;
+    int pcm_size = pcmCallback(args, &pcm_data);
+    if (pcm_size <= 0) {
+        return; // 停止播放时不再入队，声卡驱动随之停止回调。
+    }
+
+    // 添加数据到缓冲区
+    (*bq)->Enqueue(bq,
+                   pcm_data, // PCM数据(重采样后的数据)
+                   pcm_size// PCM数据对应的大小(重采样后的缓冲区大小)
+    );
+}
+
+/**
+ * 音频播放可以使用OpenSL
+ * 可以直接在C++层进行播放。
+ * 进行了硬件加速。
+ */
+bool OpenSLAudioSink::open(int sample_rate, int channels, int sample_size) {
+    this->sample_rate = sample_rate;
+    this->channels = channels;
+    this->sample_size = sample_size;
+
+    SLresult result; // 执行成功或失败的返回值
+
+    // 第一步和第二步，获取共享的引擎和混音器（只有第一个播放器需要真正创建）
+    engine = AudioEngine::acquire(&setup_time);
+    if (!engine) {
+        LOGD("获取sl引擎失败.")
+        return false;
+    }
+    SLEngineItf engineInterface = engine->engineInterface;
+
+    // 第三步，创建播放器
+    // 播放器的声音卡顿和画面卡顿的本质一致。60帧的速率，16ms会从缓冲区获取一次声音数据，如果没有数据那么就会产生卡顿。
+    // 3.1 创建缓冲队列buffer。
+    SLDataLocator_AndroidSimpleBufferQueue loc_buf = {
+            SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE,
+            10// 10个大小
+    };
+    // 注，PCM无法直接播放，因为它不包含数据参数（采样率、采样格式等等）。
+    // 注，另外需要把声音转换为扬声器支持的格式，所以需要重采样。
+
+    // pcm数据格式 == PCM是不能直接播放，mp3可以直接播放(参数集)，人家不知道PCM的参数
+    // SL_DATAFORMAT_PCM：数据格式为pcm格式
+    // 2：双声道
+    // sample_rate * 1000：采样率，OpenSL的单位是毫赫兹（44100对应SL_SAMPLINGRATE_44_1）
+    // SL_PCMSAMPLEFORMAT_FIXED_16：采样格式为16bit （每个采样点为16bit，大小）
+    // SL_PCMSAMPLEFORMAT_FIXED_16：数据大小为16bit
+    // SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT：左右声道（双声道）
+    // SL_BYTEORDER_LITTLEENDIAN：小端模式
+    SLDataFormat_PCM format_pcm = {SL_DATAFORMAT_PCM, // PCM数据格式
+                                   (SLuint32) channels, // 声道数
+                                   (SLuint32) sample_rate * 1000, // 采样率（每秒44100个点）
+                                   SL_PCMSAMPLEFORMAT_FIXED_16, // 每秒采样样本 存放大小 16bit
+                                   SL_PCMSAMPLEFORMAT_FIXED_16, // 每个样本位数 16bit
+                                   SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT, // 前左声道  前右声道
+                                   SL_BYTEORDER_LITTLEENDIAN}; // 字节序(小端) 例如：int类型四个字节（到底是 高位在前 还是 低位在前 的排序方式，一般我们都是小端）
+
+    // 数据源 将上述配置信息放到这个数据源中
+    // audioSrc最终配置音频信息的成果，给后面代码使用
+    SLDataSource audio_src = {&loc_buf, &format_pcm};
+    // 3.2 配置音轨（输出）
+    // 设置混音器
+    SLDataLocator_OutputMix loc_outmix = {SL_DATALOCATOR_OUTPUTMIX,
+                                          engine->outputMixObject}; // SL_DATALOCATOR_OUTPUTMIX:输出混音器类型
+    SLDataSink audioSnk = {&loc_outmix, NULL}; // outmix最终混音器的成果，给后面代码使用
+    // 需要的接口 操作队列的接口
+    const SLInterfaceID ids[1] = {SL_IID_BUFFERQUEUE};
+    const SLboolean req[1] = {SL_BOOLEAN_TRUE};
+
+    // 3.3 创建播放器 SLObjectItf bqPlayerObject
+    result = (*engineInterface)->CreateAudioPlayer(engineInterface, // 参数1：引擎接口
+                                                   &bqPlayerObject, // 参数2：播放器
+                                                   &audio_src, // 参数3：音频配置信息
+                                                   &audioSnk, // 参数4：混音器
+
+            // 下面代码都是 打开队列的工作
+                                                   1, // 参数5：开放的参数的个数
+                                                   ids,  // 参数6：代表我们需要 Buff
+                                                   req // 参数7：代表我们上面的Buff 需要开放出去
+    );
+    if (SL_RESULT_SUCCESS != result) {
+        LOGD("创建播放器bqPlayerObject失败.");
+        return false;
+    }
+    // 3.4 初始化播放器
+    result = (*bqPlayerObject)->Realize(bqPlayerObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGD("初始化播放器bqPlayerObject失败.");
+        return false;
+    }
+    // 3.5 获取播放器接口 【以后播放全部使用 播放器接口（核心）】
+    result = (*bqPlayerObject)->GetInterface(bqPlayerObject, SL_IID_PLAY,
+                                             &bqPlayerPlay); // SL_IID_PLAY:播放接口 == iplayer
+    if (SL_RESULT_SUCCESS != result) {
+        LOGD("获取播放接口 GetInterface SL_IID_PLAY failed!");
+        return false;
+    }
+
+    // 第四步，把播放器队列和声卡缓冲池队列进行绑定。方便我们向播放器队列添加数据时，缓冲池可以通过回调获取播放器队列中的数据。
+
+    // 4.1 获取播放器队列接口对象：SLAndroidSimpleBufferQueueItf bqPlayerBufferQueue  // 播放需要的队列
+    result = (*bqPlayerObject)->GetInterface(bqPlayerObject, SL_IID_BUFFERQUEUE,
+                                             &bqPlayerBufferQueue);
+    if (result != SL_RESULT_SUCCESS) {
+        LOGD("绑定播放队列 GetInterface SL_IID_BUFFERQUEUE failed!");
+        return false;
+    }
+    // 4.2 给播放器队列接口对象设置回调函数。
+    (*bqPlayerBufferQueue)->RegisterCallback(bqPlayerBufferQueue,  // 传入刚刚设置好的队列
+                                             bqPlayerCallback,  // 回调函数
+                                             this); // 给回调函数的参数
+
+    // 第五步，设置播放器状态为播放状态。
+    (*bqPlayerPlay)->SetPlayState(bqPlayerPlay, SL_PLAYSTATE_PLAYING);
+
+    // 第六步，手动激活回调函数 (需要手动激活才可以让声卡驱动转起来。)
+    bqPlayerCallback(bqPlayerBufferQueue, this);
+    return true;
+}
+
+void OpenSLAudioSink::stop() {
+    // OpenSLES释放工作
+    // 7.1 设置停止状态
+    if (bqPlayerPlay) {
+        (*bqPlayerPlay)->SetPlayState(bqPlayerPlay, SL_PLAYSTATE_STOPPED);
+        bqPlayerPlay = nullptr;
+    }
+
+    // 7.2 销毁播放器
+    if (bqPlayerObject) {
+        (*bqPlayerObject)->Destroy(bqPlayerObject);
+        bqPlayerObject = nullptr;
+        bqPlayerBufferQueue = nullptr;
+    }
+
+    // 7.3 释放共享的引擎和混音器，最后一个使用者负责销毁
+    if (engine) {
+        AudioEngine::release();
+        engine = nullptr;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef VIDEOPLAYER_OPENSLAUDIOSINK_H
+#define VIDEOPLAYER_OPENSLAUDIOSINK_H
+
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
+#include "AudioSink.h"
+#include "AudioEngine.h"
+#include "Log.h"
+
+/**
+ * 使用OpenSL ES播放PCM
+ *
+ * 引擎和混音器由AudioEngine共享，这里只创建和销毁自己的播放器。
+ */
+class OpenSLAudioSink : public AudioSink {
+
+public:
+    // 共享的引擎和混音器
+    AudioEngine *engine = 0;
+    // 播放器
+    SLObjectItf bqPlayerObject = 0;
+    // 播放器接口
+    SLPlayItf bqPlayerPlay = 0;
+
+    // 播放器队列接口
+    SLAndroidSimpleBufferQueueItf bqPlayerBufferQueue = 0;
+
+public:
+    virtual ~OpenSLAudioSink();
+
+    bool open(int sample_rate, int channels, int sample_size) override;
+
+    void stop() override;
+
+    /**
+     * 缓冲区播放完成，获取下一段PCM入队
+     */
+    void enqueue(SLAndroidSimpleBufferQueueItf bq);
+};
+
+#endif //VIDEOPLAYER_OPENSLAUDIOSINK_H
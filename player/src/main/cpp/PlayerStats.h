@@ -0,0 +1,71 @@
+#ifndef VIDEOPLAYER_PLAYERSTATS_H
+#define VIDEOPLAYER_PLAYERSTATS_H
+
+/**
+ * 播放统计的下标，通过 fetchStatsNative 以 long[] 的形式返回给Java层。
+ * 新增统计项只能追加在末尾，并同步修改 STAT_COUNT 和 Java 层的常量。
+ */
+#define STAT_BACKGROUND_DROPPED_PACKETS 0 // 后台模式下丢弃的视频压缩包数量
+#define STAT_BACKGROUND_DROPPED_BYTES 1 // 后台模式下丢弃的视频压缩包字节数
+#define STAT_BACKGROUND_SAVED_CPU_US 2 // 后台模式节省的CPU时间估算（丢弃帧数 * 平均每帧解码+转换耗时），单位微秒
+#define STAT_VIDEO_FRAME_CPU_US 3 // 平均每帧视频解码+格式转换的CPU耗时，单位微秒
+#define STAT_SEEK_COUNT 4 // 执行的seek次数
+#define STAT_SEEK_COALESCED 5 // 被后来的seek覆盖（合并）的seek次数
+#define STAT_SEEK_FIRST_FRAME_US 6 // 最近一次seek从请求到第一帧画面（没有视频时为第一段声音）的耗时，单位微秒
+#define STAT_SEEK_CATCHUP_US 7 // 最近一次精确seek从关键帧解码追赶到目标的耗时，单位微秒
+#define STAT_SEEK_CATCHUP_FRAMES 8 // 最近一次精确seek追赶过程中只解码、不转换不渲染而丢弃的帧数
+#define STAT_STALE_DROPPED 9 // seek之后在队列中丢弃的旧压缩包和解压包数量（音视频合计）
+#define STAT_KEYFRAME_INDEX_ENTRIES 10 // 关键帧索引的条数
+#define STAT_KEYFRAME_INDEX_SEEKS 11 // 通过关键帧索引按字节偏移完成的seek次数
+#define STAT_PREPARE_US 12 // prepare的耗时（打开媒体到通知准备完成），单位微秒
+#define STAT_MEDIA_INFO_CACHED 13 // prepare是否使用了媒体信息缓存，跳过了流信息探测（1 是，0 否）
+#define STAT_PREPARE_OPEN_US 14 // prepare中打开媒体（avformat_open_input）的耗时，单位微秒
+#define STAT_PREPARE_PROBE_US 15 // prepare中探测流信息（avformat_find_stream_info）的耗时，单位微秒
+#define STAT_FIRST_VIDEO_FRAME_US 16 // 从start到第一帧画面渲染的耗时，单位微秒
+#define STAT_FIRST_AUDIO_US 17 // 从start到第一段声音交给输出的耗时，单位微秒
+#define STAT_DISCARDED_PACKETS 18 // 不属于任何通道（字幕、数据、多余的音轨等）而丢弃的压缩包数量
+#define STAT_DISCARDED_BYTES 19 // 不属于任何通道而丢弃的压缩包字节数
+#define STAT_INTERLEAVE_SKEW_US 20 // 观察到的最大交错不均衡（一个通道队列已满时两个通道已读到的位置之差），单位微秒
+#define STAT_AUX_READER_OPENS 21 // 为饥饿的通道打开辅助读取器的次数
+#define STAT_AUX_READER_PACKETS 22 // 辅助读取器送出的压缩包数量
+#define STAT_DUAL_READER 23 // 是否使用了双读取器，音频和视频各自解封装（1 是，0 否）
+#define STAT_VIDEO_PEAK_PACKETS 24 // 视频压缩包队列中出现过的最多包数
+#define STAT_AUDIO_PEAK_PACKETS 25 // 音频压缩包队列中出现过的最多包数
+#define STAT_IO_BYTES 26 // 本地文件映射读取（或者内存来源）的字节数（主读取器）
+#define STAT_IO_SYSCALLS 27 // 本地文件映射读取的系统调用次数（预读）
+#define STAT_IO_STALL_US 28 // 本地文件读取等待存储（单次读取超过2ms）的累计耗时，单位微秒
+#define STAT_HTTP_CACHE_HIT_BYTES 29 // 网络媒体从磁盘缓存读取的字节数，命中率 = 命中 / (命中 + 下载)
+#define STAT_HTTP_CACHE_MISS_BYTES 30 // 网络媒体从网络下载的字节数
+#define STAT_HTTP_CACHE_REQUESTS 31 // 网络媒体向服务器发起的请求次数（打开连接和Range跳转）
+#define STAT_INTERRUPTED_READS 32 // 因为停止或者新的seek而中断的读取次数
+#define STAT_LAST_TEARDOWN_US 33 // 最近一次停止（任意播放器，从调用stop到解封装线程全部退出）的耗时，单位微秒
+#define STAT_LIVE_LATENCY_US 34 // 最近测得的直播延时（已经收到的数据比正在播放的位置超前的时长），单位微秒
+#define STAT_LIVE_DROPS 35 // 直播延时过大，丢弃缓存跳到下一个关键帧的次数
+#define STAT_LIVE_SPEEDUPS 36 // 直播延时超过目标，加快播放的次数
+#define STAT_BUFFERING_COUNT 37 // 网络流数据不足进入缓冲的次数（包括开始播放和seek之后的缓冲）
+#define STAT_BUFFERING_US 38 // 缓冲的累计时长，单位微秒
+#define STAT_RECONNECTS 39 // 直播断开后重连成功的次数
+#define STAT_RECONNECT_ATTEMPTS 40 // 直播尝试重连的次数
+#define STAT_LAST_OUTAGE_US 41 // 最近一次直播断开到重连后收到第一个压缩包的时长，单位微秒
+#define STAT_OUTAGE_US 42 // 直播断开的累计时长，单位微秒
+#define STAT_ABR_VARIANTS 43 // HLS可以切换的码率数量，0 表示不是多码率的hls
+#define STAT_ABR_BITRATE 44 // HLS当前播放的码率，单位 bit/s
+#define STAT_ABR_THROUGHPUT 45 // HLS测得的下载吞吐，单位 bit/s
+#define STAT_ABR_SWITCHES 46 // HLS切换码率的次数
+#define STAT_TIME_SHIFT_MEMORY_BYTES 47 // 直播时移缓存占用的内存，单位字节
+#define STAT_TIME_SHIFT_PEAK_MEMORY_BYTES 48 // 直播时移缓存占用内存的峰值，单位字节
+#define STAT_TIME_SHIFT_DISK_BYTES 49 // 直播时移溢出文件中的数据，单位字节
+#define STAT_TIME_SHIFT_SPAN_US 50 // 直播时移缓存覆盖的时长，单位微秒
+#define STAT_TIME_SHIFT_DELAY_US 51 // 直播时移播放的位置落后直播的时长，单位微秒
+#define STAT_RECORD_PACKETS 52 // 交给录制写入线程的压缩包数量
+#define STAT_RECORD_BYTES 53 // 录制写入文件的压缩包字节数
+#define STAT_RECORD_COPIED_BYTES 54 // 录制时拷贝的字节数（压缩包有引用计数时只增加引用，为0）
+#define STAT_RECORD_QUEUE_PEAK 55 // 录制写入队列中出现过的最多包数
+#define STAT_RECORD_DROPPED 56 // 录制写入跟不上而丢弃的压缩包数量
+#define STAT_MEMORY_SOURCE_BYTES 57 // 内存来源（memory://）的大小，数据直接从这块内存读取，不复制
+#define STAT_PULL_CALLS 58 // 回调来源调用拉取回调的次数
+#define STAT_PULL_US 59 // 回调来源拉取回调的累计耗时，单位微秒
+
+#define STAT_COUNT 60
+
+#endif //VIDEOPLAYER_PLAYERSTATS_H
@@ -0,0 +1,187 @@
+#include "Recorder.h"
+#include "util.h"
+#include "Log.h"
+
+Recorder *Recorder::create(const char *path, AVFormatContext *formatContext,
+                           BaseChannel *audio_channel, BaseChannel *video_channel) {
+    Remuxer *remuxer = Remuxer::create(path);
+    if (!remuxer) {
+        return nullptr;
+    }
+    auto *recorder = new Recorder();
+    recorder->remuxer = remuxer;
+    BaseChannel *channels[] = {audio_channel, video_channel};
+    for (int i = 0; i < 2; i++) {
+        if (!channels[i]) {
+            continue;
+        }
+        AVStream *stream = formatContext->streams[channels[i]->stream_index];
+        int index = remuxer->addStream(stream->codecpar, channels[i]->time_base);
+        if (index < 0) {
+            LOGD("录制添加输出流失败\n")
+            delete recorder;
+            return nullptr;
+        }
+        recorder->channels[i] = channels[i];
+        recorder->out_indexes[i] = index;
+        recorder->time_bases[i] = channels[i]->time_base;
+    }
+    recorder->key_channel = video_channel ? video_channel : audio_channel;
+    recorder->packets.setReleaseCallback(BaseChannel::releaseAVPacket);
+    return recorder;
+}
+
+Recorder::~Recorder() {
+    finish();
+    packets.clear();
+    DELETE(remuxer)
+}
+
+void *task_record(void *args) {
+    auto *recorder = static_cast<Recorder *>(args);
+    recorder->run();
+    return 0;
+}
+
+void Recorder::start() {
+    packets.working(true);
+    pthread_create(&pid_write, 0, task_record, this);
+    thread_started = true;
+}
+
+int Recorder::outIndex(BaseChannel *channel) {
+    for (int i = 0; i < 2; i++) {
+        if (channels[i] == channel) {
+            return out_indexes[i];
+        }
+    }
+    return -1;
+}
+
+void Recorder::write(AVPacket *packet, BaseChannel *channel) {
+    if (finished || !thread_started) {
+        return;
+    }
+    int out_index = outIndex(channel);
+    if (out_index < 0 || BaseChannel::isEofPacket(packet)) {
+        return;
+    }
+    bool keyframe = channel == key_channel && (packet->flags & AV_PKT_FLAG_KEY);
+    if (stop_requested && (keyframe || !started || key_channel != channels[1])) {
+        // 停止：在关键帧处结束（没有视频时立即结束）
+        endInput();
+        return;
+    }
+
+    int64_t ts = BaseChannel::packetTs(packet);
+    if (!started) {
+        if (!keyframe || ts == AV_NOPTS_VALUE) {
+            return;
+        }
+        started = true;
+        start_time = av_rescale_q(ts, channel->time_base, AV_TIME_BASE_Q);
+        LOGD("开始录制\n")
+    } else if (ts != AV_NOPTS_VALUE && av_rescale_q(ts, channel->time_base, AV_TIME_BASE_Q) < start_time) {
+        return; // 开始的关键帧之前的音频
+    }
+
+    if (dropping) {
+        if (!keyframe) {
+            dropped_packets++;
+            return;
+        }
+        dropping = false;
+    }
+    int size = packets.size();
+    if (size >= RECORDER_MAX_QUEUE) {
+        // 写入跟不上（存储太慢），不阻塞解封装线程，丢弃到下一个关键帧
+        dropping = true;
+        dropped_packets++;
+        LOGD("录制写入队列已满，丢弃到下一个关键帧\n")
+        return;
+    }
+
+    AVPacket *ref = av_packet_alloc();
+    if (!packet->buf) {
+        copied_bytes += packet->size; // 没有引用计数的缓冲区时av_packet_ref会拷贝数据
+    }
+    if (av_packet_ref(ref, packet) < 0) {
+        av_packet_free(&ref);
+        return;
+    }
+    packets.insertToQueue(ref, out_index);
+    queued_packets++;
+    if (size + 1 > peak_queue) {
+        peak_queue = size + 1;
+    }
+}
+
+/**
+ * 放入结束标记，写入线程写完之前的包后写入文件尾
+ */
+void Recorder::endInput() {
+    if (finished) {
+        return;
+    }
+    finished = true; // 不再接收新的包
+    packets.insertToQueue(BaseChannel::createEofPacket(), -1);
+}
+
+void Recorder::requestStop() {
+    stop_requested = true;
+}
+
+void Recorder::finish() {
+    if (!thread_started) {
+        return;
+    }
+    endInput();
+    pthread_join(pid_write, nullptr);
+    thread_started = false;
+}
+
+void *task_release_recorder(void *args) {
+    delete static_cast<Recorder *>(args);
+    return 0;
+}
+
+void Recorder::releaseAsync(Recorder *recorder) {
+    if (!recorder) {
+        return;
+    }
+    pthread_t pid_release;
+    if (pthread_create(&pid_release, 0, task_release_recorder, recorder)) {
+        delete recorder;
+        return;
+    }
+    pthread_detach(pid_release);
+}
+
+void Recorder::run() {
+    bool ok = remuxer->begin();
+    AVPacket *packet = nullptr;
+    while (true) {
+        int out_index = -1;
+        if (!packets.popQueueAndDel(packet, &out_index)) {
+            break;
+        }
+        if (BaseChannel::isEofPacket(packet)) {
+            BaseChannel::releaseAVPacket(&packet);
+            break;
+        }
+        if (ok) {
+            AVRational time_base = out_index == out_indexes[0] ? time_bases[0] : time_bases[1];
+            remuxer->write(packet, out_index, time_base, start_time);
+            written_bytes = remuxer->bytes;
+        }
+        BaseChannel::releaseAVPacket(&packet);
+    }
+    if (ok) {
+        remuxer->end();
+    }
+    packets.working(false);
+    finished = true;
+    LOGD("录制结束，写入 %lld 个包 %lld KB，丢弃 %lld 个包，写入队列最多 %d 个包\n",
+         (long long) remuxer->packets, (long long) remuxer->bytes / 1024,
+         (long long) dropped_packets, peak_queue)
+}
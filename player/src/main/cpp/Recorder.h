@@ -0,0 +1,85 @@
+#ifndef VIDEOPLAYER_RECORDER_H
+#define VIDEOPLAYER_RECORDER_H
+
+#include <pthread.h>
+#include "BaseChannel.h"
+#include "Remuxer.h"
+
+#define RECORDER_MAX_QUEUE 1000 // 写入队列最多的包数，写入跟不上时丢弃到下一个关键帧，不阻塞播放
+
+/**
+ * 录制正在播放的流：解封装线程把分发给通道的压缩包增加引用（不拷贝数据）交给录制，
+ * 录制在自己的写入线程中转封装到mp4/mkv等文件，不解码、不编码，不需要第二个连接。
+ *
+ * 从视频的关键帧开始录制；请求停止后在下一个视频关键帧处结束，文件的最后一组画面是完整的。
+ * 没有视频时从第一个包开始，请求停止后立即结束。
+ *
+ * write 在解封装线程中调用（双读取器时有两个解封装线程，由调用方加锁），写入在录制自己的线程中。
+ */
+class Recorder {
+
+private:
+    Remuxer *remuxer = 0;
+    SafeQueue<AVPacket *> packets; // 写入队列，代数为输出流的下标
+    pthread_t pid_write;
+    bool thread_started = false;
+
+    BaseChannel *channels[2] = {0, 0}; // 录制的通道（音频、视频）
+    int out_indexes[2] = {-1, -1}; // 通道对应的输出流
+    AVRational time_bases[2] = {{0, 1}, {0, 1}}; // 通道的时间基，写入线程不再访问通道（异步释放时播放器可能已经释放）
+    BaseChannel *key_channel = 0; // 按该通道的关键帧开始和结束
+
+    bool started = false; // 是否已经收到开始的关键帧
+    bool stop_requested = false; // 是否请求了停止
+    bool dropping = false; // 写入队列满了，丢弃到下一个关键帧
+    int64_t start_time = AV_NOPTS_VALUE; // 开始的关键帧的时间戳，单位微秒，输出文件从0开始
+
+    Recorder() = default;
+
+    int outIndex(BaseChannel *channel);
+
+    void endInput();
+
+public:
+    volatile bool finished = false; // 写入线程是否已经结束（文件已经关闭）
+    int64_t queued_packets = 0; // 交给写入线程的压缩包数量
+    int64_t copied_bytes = 0; // 增加引用时不得不拷贝的字节数（压缩包没有引用计数的缓冲区）
+    int64_t dropped_packets = 0; // 写入队列满了而丢弃的压缩包数量
+    int peak_queue = 0; // 写入队列中出现过的最多包数
+    volatile int64_t written_bytes = 0; // 写入文件的压缩包字节数
+
+    /**
+     * @param path 输出文件，按后缀选择容器
+     * @param formatContext 输入的解封装上下文，复制流的编码参数
+     */
+    static Recorder *create(const char *path, AVFormatContext *formatContext,
+                            BaseChannel *audio_channel, BaseChannel *video_channel);
+
+    ~Recorder();
+
+    void start();
+
+    /**
+     * 解封装线程中调用：把压缩包的引用交给写入线程，packet仍然由调用方使用和释放。
+     */
+    void write(AVPacket *packet, BaseChannel *channel);
+
+    /**
+     * 请求停止，在下一个关键帧处结束
+     */
+    void requestStop();
+
+    /**
+     * 立即结束（播放停止时），等待写入线程写完队列中的包并关闭文件
+     */
+    void finish();
+
+    /**
+     * 在单独的线程中结束并释放（等待写入线程写完文件尾），不阻塞调用线程
+     */
+    static void releaseAsync(Recorder *recorder);
+
+    void run();
+};
+
+#endif //VIDEOPLAYER_RECORDER_H
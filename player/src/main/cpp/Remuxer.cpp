@@ -0,0 +1,96 @@
+#include "Remuxer.h"
+#include "Log.h"
+
+Remuxer *Remuxer::create(const char *path) {
+    auto *remuxer = new Remuxer();
+    int result = avformat_alloc_output_context2(&remuxer->output, nullptr, nullptr, path);
+    if (result < 0 || !remuxer->output) {
+        LOGD("不支持的输出容器 %s %d\n", path, result)
+        delete remuxer;
+        return nullptr;
+    }
+    return remuxer;
+}
+
+Remuxer::~Remuxer() {
+    if (output) {
+        if (output->pb && !(output->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&output->pb);
+        }
+        avformat_free_context(output);
+        output = nullptr;
+    }
+}
+
+int Remuxer::addStream(const AVCodecParameters *parameters, AVRational time_base) {
+    AVStream *stream = avformat_new_stream(output, nullptr);
+    if (!stream) {
+        return -1;
+    }
+    if (avcodec_parameters_copy(stream->codecpar, parameters) < 0) {
+        return -1;
+    }
+    // 输入容器的codec_tag（如flv、ts中的标记）在输出容器中不一定有效，由输出容器重新选择
+    stream->codecpar->codec_tag = 0;
+    stream->time_base = time_base; // 只是建议值，写入文件头时容器可能修改
+    return stream->index;
+}
+
+bool Remuxer::begin() {
+    int result = 0;
+    if (!(output->oformat->flags & AVFMT_NOFILE)) {
+        result = avio_open(&output->pb, output->url, AVIO_FLAG_WRITE);
+        if (result < 0) {
+            LOGD("打开输出文件失败 %s %d\n", output->url, result)
+            return false;
+        }
+    }
+    result = avformat_write_header(output, nullptr);
+    if (result < 0) {
+        LOGD("写入文件头失败 %d\n", result)
+        return false;
+    }
+    header_written = true;
+    return true;
+}
+
+int Remuxer::write(AVPacket *packet, int out_index, AVRational time_base, int64_t offset) {
+    AVStream *stream = output->streams[out_index];
+    int64_t start = av_rescale_q(offset, AV_TIME_BASE_Q, time_base);
+    if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts -= start;
+    }
+    if (packet->dts != AV_NOPTS_VALUE) {
+        packet->dts -= start;
+    }
+    av_packet_rescale_ts(packet, time_base, stream->time_base);
+    packet->stream_index = out_index;
+    packet->pos = -1;
+
+    int size = packet->size;
+    int result = av_interleaved_write_frame(output, packet); // 取走packet的数据
+    if (result < 0) {
+        write_errors++;
+        av_packet_unref(packet);
+        return result;
+    }
+    packets++;
+    bytes += size;
+    return 0;
+}
+
+bool Remuxer::end() {
+    if (!header_written) {
+        return false;
+    }
+    header_written = false;
+    int result = av_write_trailer(output);
+    if (output->pb && !(output->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&output->pb);
+    }
+    if (result < 0) {
+        LOGD("写入文件尾失败 %d\n", result)
+        return false;
+    }
+    return true;
+}
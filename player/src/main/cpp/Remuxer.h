@@ -0,0 +1,61 @@
+#ifndef VIDEOPLAYER_REMUXER_H
+#define VIDEOPLAYER_REMUXER_H
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * 转封装：把压缩包原样（不解码、不编码）写入新的容器文件，容器由文件的后缀决定（mp4、mkv等）。
+ *
+ * 用法：create -> addStream（每个流一次）-> begin -> write ... -> end。
+ * 只在一个线程中使用。
+ */
+class Remuxer {
+
+private:
+    AVFormatContext *output = 0;
+    bool header_written = false;
+
+    Remuxer() = default;
+
+public:
+    int64_t packets = 0; // 写入的压缩包数量
+    int64_t bytes = 0; // 写入的压缩包字节数
+    int64_t write_errors = 0; // 写入失败（时间戳不递增等）而丢弃的压缩包数量
+
+    /**
+     * @param path 输出文件的路径，按后缀选择容器
+     * @return 不支持的容器时返回空
+     */
+    static Remuxer *create(const char *path);
+
+    ~Remuxer();
+
+    /**
+     * 添加输出流，编码参数从输入流复制
+     * @return 输出流的下标，失败时返回负数
+     */
+    int addStream(const AVCodecParameters *parameters, AVRational time_base);
+
+    /**
+     * 打开输出文件并写入文件头
+     */
+    bool begin();
+
+    /**
+     * 写入一个压缩包，时间戳从输入流的时间基转换到输出流的时间基。
+     * 写入后packet中的数据被取走（packet变为空包），由调用方释放packet本身。
+     * @param out_index 输出流的下标
+     * @param time_base 输入流的时间基
+     * @param offset 从所有时间戳中减去的起始时间，单位微秒，输出文件从0开始
+     */
+    int write(AVPacket *packet, int out_index, AVRational time_base, int64_t offset);
+
+    /**
+     * 写入文件尾（mp4的索引等）并关闭文件
+     */
+    bool end();
+};
+
+#endif //VIDEOPLAYER_REMUXER_H
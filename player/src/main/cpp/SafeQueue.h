@@ -9,12 +9,22 @@ using namespace std;
 template<typename T> // 定义泛型
 class SafeQueue {
 
+public:
+    /**
+     * 队列中的元素：数据和它所属的播放代数（serial）。
+     * seek之后代数加一，之前代数的数据由取出它的线程丢弃，不需要清空队列，也不需要停止任何线程。
+     */
+    struct Item {
+        T value;
+        int serial;
+    };
+
 private:
     typedef void (*ReleaseCallback)(T *);// 函数指针定义 作为回调
-    typedef void (*SyncCallback)(queue<T> &);// 函数指针定义 作为回调 用来完成丢帧工作
+    typedef void (*SyncCallback)(queue<Item> &, int);// 函数指针定义 作为回调 用来完成丢帧工作，第二个参数为当前的播放代数
 
 private:
-    queue<T> queue; // 队列
+    queue<Item> queue; // 队列
     pthread_mutex_t mutex; // 互斥锁，用于线程安全。
     pthread_cond_t cond; // 条件变量，用于控制线程睡眠和唤醒。
     bool work = false; // 标记队列是否工作
@@ -35,12 +45,14 @@ public:
 
     /**
      * 数据入队 [AVPacket 类型为压缩包] [AVFrame 类型为解压包]
+     *
+     * @param serial 数据所属的播放代数
      */
-    void insertToQueue(T value) {
+    void insertToQueue(T value, int serial = 0) {
         pthread_mutex_lock(&mutex); // 锁住代码块
 
         if (work) {
-            queue.push(value);
+            queue.push({value, serial});
             pthread_cond_signal(&cond); // 当插入数据包 进入队列后，发出通知唤醒其他线程
         } else {
             // 没有工作时，释放value的空间，由于是T类型，类型不明确，所以由外界释放。
@@ -55,9 +67,10 @@ public:
     /**
     * 数据出队 [AVPacket 类型为压缩包] [AVFrame 类型为解压包]
      *
+     * @param serial 不为空时，输出数据所属的播放代数
      * @return 取数据是否成功
     */
-    bool popQueueAndDel(T &value) {
+    bool popQueueAndDel(T &value, int *serial = nullptr) {
         int ret = false;
 
         pthread_mutex_lock(&mutex); // 锁住代码块
@@ -67,7 +80,10 @@ public:
         }
 
         if (!queue.empty()) {
-            value = queue.front(); // 获取队列中第一个数据
+            value = queue.front().value; // 获取队列中第一个数据
+            if (serial) {
+                *serial = queue.front().serial;
+            }
             queue.pop(); // 删除队列中第一个条数据
             ret = true;
         }
@@ -106,7 +122,7 @@ public:
         unsigned int size = queue.size();
         for (; i < size; i++) {
             // 循环释放队列中的数据
-            T value = queue.front();
+            T value = queue.front().value;
             if (releaseCallback) {
                 releaseCallback(&value);
             }
@@ -125,12 +141,14 @@ public:
 
     /**
      * 同步操作 丢包
+     *
+     * @param serial 当前的播放代数，只丢弃属于该代数的数据
      */
-     void sync() {
+     void sync(int serial) {
         pthread_mutex_lock(&mutex);
 
         if(syncCallback) {
-            syncCallback(queue);
+            syncCallback(queue, serial);
         }
 
         pthread_mutex_unlock(&mutex);
@@ -0,0 +1,222 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include "TimeShiftBuffer.h"
+#include "CacheFile.h"
+#include "Log.h"
+
+TimeShiftBuffer::TimeShiftBuffer(BaseChannel *key_channel, int64_t max_duration, int64_t max_memory,
+                                 const char *data_source, int64_t max_disk) :
+        key_channel(key_channel),
+        max_duration(max_duration),
+        max_memory(max_memory) {
+
+    if (max_disk > 0 && CacheFile::urlPath(data_source, TIME_SHIFT_SUFFIX, spill_path, sizeof(spill_path))) {
+        // 溢出文件只在本次播放中使用，打开后立即删除目录项，进程退出时自动回收空间
+        fd = ::open(spill_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0) {
+            unlink(spill_path);
+            disk_capacity = max_disk;
+        }
+    }
+    LOGD("直播时移：最长 %lld s，内存上限 %lld KB，溢出文件 %lld KB\n", (long long) max_duration / AV_TIME_BASE,
+         (long long) max_memory / 1024, (long long) disk_capacity / 1024)
+}
+
+TimeShiftBuffer::~TimeShiftBuffer() {
+    for (Entry &entry : entries) {
+        if (entry.packet) {
+            av_packet_free(&entry.packet);
+        }
+    }
+    entries.clear();
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool TimeShiftBuffer::isKeyframe(const Entry &entry) {
+    return entry.channel == key_channel && (entry.flags & AV_PKT_FLAG_KEY);
+}
+
+void TimeShiftBuffer::append(AVPacket *packet, BaseChannel *channel) {
+    Entry entry = {};
+    entry.packet = av_packet_alloc();
+    if (av_packet_ref(entry.packet, packet) < 0) {
+        av_packet_free(&entry.packet);
+        return;
+    }
+    entry.channel = channel;
+    entry.recv_time = av_gettime_relative();
+    entry.size = packet->size;
+    entry.pts = packet->pts;
+    entry.dts = packet->dts;
+    entry.duration = packet->duration;
+    entry.flags = packet->flags;
+
+    if (isKeyframe(entry)) {
+        keyframes.push_back(first_seq + (int64_t) entries.size());
+    }
+    entries.push_back(entry);
+    memory_bytes += entry.size;
+    if (memory_bytes > peak_memory_bytes) {
+        peak_memory_bytes = memory_bytes;
+    }
+    trim();
+}
+
+/**
+ * 淘汰超过最长时长的包；内存超过上限时把最早的包写入溢出文件，没有溢出文件时直接淘汰。
+ */
+void TimeShiftBuffer::trim() {
+    int64_t newest = entries.back().recv_time;
+    while (entries.size() > 1 && newest - entries.front().recv_time > max_duration) {
+        removeFront();
+    }
+    while (memory_bytes > max_memory && entries.size() > 1) {
+        if (fd >= 0 && spilled < (int64_t) entries.size() - 1) {
+            spill();
+        } else {
+            removeFront();
+        }
+    }
+}
+
+void TimeShiftBuffer::removeFront() {
+    Entry &entry = entries.front();
+    if (entry.packet) {
+        memory_bytes -= entry.size;
+        av_packet_free(&entry.packet);
+    } else {
+        disk_bytes -= entry.size;
+        spilled--;
+    }
+    entries.pop_front();
+    first_seq++;
+    evicted_packets++;
+    while (!keyframes.empty() && keyframes.front() < first_seq) {
+        keyframes.pop_front();
+    }
+    if (cursor < first_seq) {
+        // 还没有送出的包被淘汰（暂停或者回退太久），从剩下的第一个关键帧继续
+        cursor = keyframes.empty() ? first_seq + (int64_t) entries.size() : keyframes.front();
+        discontinuity = true;
+    }
+}
+
+/**
+ * 把内存中最早的包写入溢出文件。溢出文件环形写入，写到末尾放不下时从头开始；
+ * 溢出的包在文件中按写入顺序排列，写入位置上被覆盖的一定是最早溢出的包，同时淘汰。
+ * 包的附加数据（side data）不写入溢出文件。
+ */
+void TimeShiftBuffer::spill() {
+    Entry &entry = entries[spilled];
+    if (entry.size > disk_capacity) {
+        removeFront(); // 单个包超过溢出文件的容量，不可能写入
+        return;
+    }
+
+    int64_t pos = write_pos;
+    bool wrapped = false;
+    if (pos + entry.size > disk_capacity) {
+        pos = 0;
+        wrapped = true;
+    }
+    while (spilled > 0) {
+        const Entry &front = entries.front();
+        bool overlap = front.offset < pos + entry.size && front.offset + front.size > pos;
+        // 从头开始写时，上一轮写在末尾的包比开头的包更早，也需要先淘汰
+        if (!overlap && !(wrapped && front.offset >= write_pos)) {
+            break;
+        }
+        removeFront();
+    }
+
+    if (pwrite(fd, entry.packet->data, entry.size, pos) != entry.size) {
+        LOGD("直播时移溢出文件写入失败，只使用内存\n")
+        while (spilled > 0) {
+            removeFront(); // 已经溢出的包无法再读取
+        }
+        close(fd);
+        fd = -1;
+        return;
+    }
+    entry.offset = pos;
+    write_pos = pos + entry.size;
+    memory_bytes -= entry.size;
+    disk_bytes += entry.size;
+    av_packet_free(&entry.packet);
+    spilled++;
+}
+
+AVPacket *TimeShiftBuffer::next(BaseChannel **channel) {
+    while (cursor < first_seq + (int64_t) entries.size()) {
+        const Entry &entry = entries[cursor - first_seq];
+        cursor++;
+
+        AVPacket *packet = av_packet_alloc();
+        if (entry.packet) {
+            if (av_packet_ref(packet, entry.packet) < 0) {
+                av_packet_free(&packet);
+                continue;
+            }
+        } else {
+            if (av_new_packet(packet, entry.size) < 0
+                || pread(fd, packet->data, entry.size, entry.offset) != entry.size) {
+                av_packet_free(&packet);
+                continue;
+            }
+            packet->pts = entry.pts;
+            packet->dts = entry.dts;
+            packet->duration = entry.duration;
+            packet->flags = entry.flags;
+        }
+        packet->stream_index = entry.channel->stream_index;
+        *channel = entry.channel;
+        return packet;
+    }
+    return nullptr;
+}
+
+bool TimeShiftBuffer::seekBehind(int64_t behind) {
+    if (entries.empty() || keyframes.empty()) {
+        return false;
+    }
+    int64_t target = entries.back().recv_time - behind;
+    int64_t seq = keyframes.front(); // 目标早于缓存的开头时，从最早的关键帧开始
+    for (auto it = keyframes.rbegin(); it != keyframes.rend(); ++it) {
+        if (entries[*it - first_seq].recv_time <= target) {
+            seq = *it;
+            break;
+        }
+    }
+    cursor = seq;
+    discontinuity = false;
+    return true;
+}
+
+void TimeShiftBuffer::seekLive() {
+    // 从最新的关键帧开始，立即有画面，剩下的延时由直播延时控制追赶
+    cursor = keyframes.empty() ? first_seq + (int64_t) entries.size() : keyframes.back();
+    discontinuity = false;
+}
+
+int64_t TimeShiftBuffer::delay() {
+    if (isLive()) {
+        return 0;
+    }
+    return entries.back().recv_time - entries[cursor - first_seq].recv_time;
+}
+
+int64_t TimeShiftBuffer::span() {
+    if (entries.empty()) {
+        return 0;
+    }
+    return entries.back().recv_time - entries.front().recv_time;
+}
+
+bool TimeShiftBuffer::takeDiscontinuity() {
+    bool result = discontinuity;
+    discontinuity = false;
+    return result;
+}
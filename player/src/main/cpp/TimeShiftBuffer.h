@@ -0,0 +1,124 @@
+#ifndef VIDEOPLAYER_TIMESHIFTBUFFER_H
+#define VIDEOPLAYER_TIMESHIFTBUFFER_H
+
+#include <deque>
+#include "BaseChannel.h"
+
+#define TIME_SHIFT_SUFFIX "timeshift" // 时移溢出文件的后缀
+
+/**
+ * 直播时移（DVR）缓存：保存最近一段时间内解封装出的压缩包，直播可以暂停、回退，再回到直播。
+ *
+ * 压缩包按接收的顺序保存（引用计数，不拷贝数据），每个包记录所属的通道和接收时间，
+ * 回退的时长按接收时间计算，不受直播时间戳跳变（重连等）的影响。
+ * 视频关键帧单独建立索引，回退和追不上被淘汰的数据时都从关键帧开始送。
+ *
+ * 超过最长时长的包从头部淘汰；内存超过上限时，有溢出文件则把最早的包写入溢出文件（环形写入，
+ * 写满后覆盖最早的数据，被覆盖的包同时淘汰），没有溢出文件则直接淘汰。
+ *
+ * 只在主解封装线程中使用，统计字段可以在其他线程中读取。
+ */
+class TimeShiftBuffer {
+
+private:
+    struct Entry {
+        AVPacket *packet; // 内存中的压缩包，已经写入溢出文件时为空
+        BaseChannel *channel; // 压缩包所属的通道
+        int64_t recv_time; // 接收的时间，单位微秒
+        int64_t offset; // 在溢出文件中的位置
+        int size; // 数据的大小
+        int64_t pts;
+        int64_t dts;
+        int64_t duration;
+        int flags;
+    };
+
+    std::deque<Entry> entries;
+    std::deque<int64_t> keyframes; // 视频关键帧（没有视频时为每个包）的序号
+    int64_t first_seq = 0; // entries[0]的序号，序号一直递增，淘汰不改变剩余包的序号
+    int64_t spilled = 0; // 头部已经写入溢出文件的包数
+    int64_t cursor = 0; // 下一个送给通道的包的序号
+    BaseChannel *key_channel = 0; // 建立关键帧索引的通道（视频，没有视频时为音频）
+    bool discontinuity = false; // 送出的位置被淘汰，跳到了下一个关键帧
+
+    int64_t max_duration; // 最长保存的时长，单位微秒
+    int64_t max_memory; // 内存中压缩包数据的上限，单位字节
+
+    char spill_path[512] = {0};
+    int fd = -1; // 溢出文件，没有时只使用内存
+    int64_t disk_capacity = 0; // 溢出文件的大小上限
+    int64_t write_pos = 0; // 溢出文件下一次写入的位置
+
+    void trim();
+
+    void spill();
+
+    void removeFront();
+
+    bool isKeyframe(const Entry &entry);
+
+public:
+    int64_t memory_bytes = 0; // 内存中压缩包数据的字节数
+    int64_t disk_bytes = 0; // 溢出文件中压缩包数据的字节数
+    int64_t peak_memory_bytes = 0; // 内存中压缩包数据的最大字节数
+    int64_t evicted_packets = 0; // 超过时长或者容量而淘汰的包数
+
+    /**
+     * @param key_channel 建立关键帧索引的通道
+     * @param max_duration 最长保存的时长，单位微秒
+     * @param max_memory 内存中压缩包数据的上限，单位字节
+     * @param data_source 媒体地址，用于生成溢出文件的路径（缓存目录）
+     * @param max_disk 溢出文件的上限，单位字节，<= 0 或者没有缓存目录时不使用溢出文件
+     */
+    TimeShiftBuffer(BaseChannel *key_channel, int64_t max_duration, int64_t max_memory,
+                    const char *data_source, int64_t max_disk);
+
+    ~TimeShiftBuffer();
+
+    /**
+     * 保存解封装出的压缩包（增加引用，调用方仍然持有原来的包）
+     */
+    void append(AVPacket *packet, BaseChannel *channel);
+
+    /**
+     * 取出下一个要送给通道的包，送到最新的包时返回空
+     * @param channel 输出包所属的通道
+     * @return 新的压缩包（引用或者从溢出文件读出），由调用方释放
+     */
+    AVPacket *next(BaseChannel **channel);
+
+    /**
+     * 把送出的位置移到回退目标（接收时间早于最新的包 behind 微秒）之前最近的关键帧
+     * @return 是否找到关键帧
+     */
+    bool seekBehind(int64_t behind);
+
+    /**
+     * 把送出的位置移到最新的包之后，之后收到的包直接送出（回到直播）
+     */
+    void seekLive();
+
+    /**
+     * 送出的位置是否已经在最新的包之后（正在播放直播）
+     */
+    bool isLive() {
+        return cursor >= first_seq + (int64_t) entries.size();
+    }
+
+    /**
+     * 送出的位置落后最新的包的时长（按接收时间），单位微秒
+     */
+    int64_t delay();
+
+    /**
+     * 缓存覆盖的时长（按接收时间），单位微秒
+     */
+    int64_t span();
+
+    /**
+     * 送出的位置被淘汰后移到了下一个关键帧，通道需要开始新的播放代数。调用后清除该标记。
+     */
+    bool takeDiscontinuity();
+};
+
+#endif //VIDEOPLAYER_TIMESHIFTBUFFER_H
@@ -4,20 +4,29 @@
 
 /**
  * 这里的解码包不需要考虑I帧的问题。
+ * 结束标记和其他播放代数的帧不能丢：结束标记丢了视频就不会通知播放完成，
+ * 其他代数的帧（seek之后的新帧）交给播放线程按代数处理。
  * @param q
+ * @param serial 当前的播放代数
  */
-void task_drop_frame(queue<AVFrame *> &q) {
+void task_drop_frame(queue<SafeQueue<AVFrame *>::Item> &q, int serial) {
     if (!q.empty()) {
-        AVFrame *frame = q.front();
+        AVFrame *frame = q.front().value;
+        if (q.front().serial != serial || BaseChannel::isEofFrame(frame)) {
+            return;
+        }
         av_frame_unref(frame);
         BaseChannel::releaseAVFrame(&frame);
         q.pop();
     }
 }
 
-void task_drop_packet(queue<AVPacket *> &q) {
+void task_drop_packet(queue<SafeQueue<AVPacket *>::Item> &q, int serial) {
     while (!q.empty()) {
-        AVPacket *packet = q.front();
+        AVPacket *packet = q.front().value;
+        if (q.front().serial != serial || BaseChannel::isEofPacket(packet)) {
+            break; // 同上，结束标记和其他播放代数的压缩包不丢
+        }
         if (packet->flags != AV_PKT_FLAG_KEY) { // 如果不是I帧
             av_packet_unref(packet);
             BaseChannel::releaseAVPacket(&packet);
@@ -32,22 +41,24 @@ VideoChannel::VideoChannel(int stream_index, AVCodecContext *codecContext,
                            AVRational time_base, int fps)
         : BaseChannel(stream_index, codecContext, time_base) {
     this->fps = fps;
+    this->max_packets = MAX_SIZE_QUEUE; // 视频压缩包较大，同时限制包数
     packets.setSyncCallback(task_drop_packet);
     frames.setSyncCallback(task_drop_frame);
 }
 
 VideoChannel::~VideoChannel() {
-    DELETE(audio_channel)
+    audio_channel = nullptr; // 音频通道由VideoPlayer持有和释放，这里只是引用。
 }
 
 void VideoChannel::stop() {
-    pthread_join(pid_video_decode, nullptr);
-    pthread_join(pid_video_play, nullptr);
-
+    // 先让队列停止工作，唤醒阻塞在队列上的解码线程和播放线程，再等待线程结束。
     is_playing = false;
 
     packets.working(false);
-    packets.working(false);
+    frames.working(false);
+
+    pthread_join(pid_video_decode, nullptr);
+    pthread_join(pid_video_play, nullptr);
 
     packets.clear();
     frames.clear();
@@ -75,7 +86,8 @@ void VideoChannel::video_decode() {
             continue;
         }
 
-        int result = packets.popQueueAndDel(packet); // 阻塞式队列
+        int packet_serial = 0;
+        int result = packets.popQueueAndDel(packet, &packet_serial); // 阻塞式队列
 
         if (!is_playing) { // 用户停止播放,跳出循环并释放资源。
             break;
@@ -85,43 +97,71 @@ void VideoChannel::video_decode() {
             continue;
         }
 
+        if (isStalePacket(packet_serial)) {
+            // seek之前读取的压缩包，不再解码。
+            av_packet_unref(packet);
+            releaseAVPacket(&packet);
+            continue;
+        }
+        onPacketDequeued(packet);
+
+        // 结束标记：传入空包让解码器进入冲刷模式，输出内部缓存的所有帧。
+        bool eof = isEofPacket(packet);
+
+        int64_t cpu_time = thread_cpu_time();
+
         // 把packet解码成frame，需要把packet给ffmpeg内的缓冲区，再获取frame。
-        result = avcodec_send_packet(codecContext, packet);
+        result = avcodec_send_packet(codecContext, eof ? nullptr : packet);
 
-        //avcodec_send_packet 会把packet进行深拷贝，所以可以直接在这里释放。
-//        releaseAVPacket(&packet);
+        // avcodec_send_packet 会对packet的数据增加引用（或深拷贝），所以可以直接在这里释放。
+        // 此时把packet完全释放。释放packet对象，和packet成员指向的空间。 先释放内部成员，再释放本身。
+        av_packet_unref(packet); // AVPacket对象成员中，也存在开辟堆空间的指针，所以需要用api把对象成员的堆空间释放。
+        releaseAVPacket(&packet);
 
         if (result != 0) {
             //这里各种异常
             break;
         }
 
-        AVFrame *frame = av_frame_alloc();
-        result = avcodec_receive_frame(codecContext, frame);
+        // 一个压缩包可能解码出0个或多个帧（B帧需要参考后面的帧，冲刷时会一次输出全部缓存），所以循环取出。
+        while (true) {
+            AVFrame *frame = av_frame_alloc();
+            result = avcodec_receive_frame(codecContext, frame);
+            if (result != 0) {
+                releaseAVFrame(&frame);
+                break;
+            }
 
-        // 进行异常判断
-        if (result == AVERROR(EAGAIN)) {
-            // IBP的理论???
-            // 当不是关键帧时，无法通过单独的一帧解码。所以可以继续，参考下一帧进行解码。
-            continue;
-        } else if (result != 0) { // 失败
-            if (frame) {
+            decode_cpu_time += thread_cpu_time() - cpu_time;
+            decoded_frames++;
+            cpu_time = thread_cpu_time();
+
+            if (discardBeforeSeekTarget(frame)) {
                 av_frame_unref(frame);
                 releaseAVFrame(&frame);
+                continue;
             }
-            break;
+
+            frames.insertToQueue(frame, decoder_serial);
         }
 
-        frames.insertToQueue(frame);
+        if (result == AVERROR_EOF) {
+            // 解码器已冲刷完毕，把结束标记交给播放线程。重置解码器，之后seek还可以继续解码。
+            frames.insertToQueue(createEofFrame(), decoder_serial);
+            avcodec_flush_buffers(codecContext);
+            continue;
+        }
 
-        // 此时把packet完全释放。释放packet对象，和packet成员指向的空间。 先释放内部成员，再释放本身。
-        av_packet_unref(packet); // AVPacket对象成员中，也存在开辟堆空间的指针，所以需要用api把对象成员的堆空间释放。
-        releaseAVPacket(&packet);
+        if (result != AVERROR(EAGAIN)) { // EAGAIN 表示需要更多的压缩包，其他为失败
+            break;
+        }
     }
 
     is_playing = false;
-    av_packet_unref(packet);
-    releaseAVPacket(&packet);
+    if (packet) {
+        av_packet_unref(packet);
+        releaseAVPacket(&packet);
+    }
 }
 
 void *task_video_play(void *args) {
@@ -139,25 +179,15 @@ void *task_video_play(void *args) {
  */
 void VideoChannel::video_play() {
     AVFrame *frame = 0;
-    uint8_t *dst_data[4];//转换后的像素数据。二维数组，每个像素点有四个元素，数据分别为RGBA，范围为0-255
+    uint8_t *dst_data[4] = {0};//转换后的像素数据。二维数组，每个像素点有四个元素，数据分别为RGBA，范围为0-255
     int dst_line_size[4];//转换后的像素大小。二维数组.
 
-    // 在堆中申请空间
-    av_image_alloc(dst_data, dst_line_size,
-                   codecContext->width, codecContext->height,
-                   AV_PIX_FMT_RGBA,
-                   1);
-
-    SwsContext *sws_context = sws_getContext(
-            codecContext->width, // 视频输入的宽
-            codecContext->height, // 视频输入的高
-            codecContext->pix_fmt, // 视频输入的像素格式，80%的视频格式是 AV_PIX_FMT_YUV420P
-            codecContext->width, // 视频输出的宽
-            codecContext->height, // 视频输出的高
-            AV_PIX_FMT_RGBA, // 视频输出的格式
-            SWS_BILINEAR, // 格式转换的算法，各种类型，需要学习.
-            NULL, NULL, NULL
-    );
+    // 格式转换的上下文和输出空间在第一帧到来时按帧的实际参数创建，分辨率或像素格式改变时重新创建。
+    // 快速启动时prepare只做了很少的探测，解码器上下文中的宽高和像素格式可能还是未知的。
+    SwsContext *sws_context = nullptr;
+    int src_width = 0;
+    int src_height = 0;
+    int src_format = AV_PIX_FMT_NONE;
 
     // 定义临时变量
     double extra_delay;
@@ -166,8 +196,19 @@ void VideoChannel::video_play() {
     double video_time;
     double audio_time;
     double time_diff;
+    // 没有音频时（纯视频的直播或文件）使用视频自己的时钟：系统时间减去起点，起点在开始、seek、丢弃缓存和暂停后重新对齐
+    double clock_start = 0;
+    int clock_serial = -1;
     while (is_playing) {
-        int result = frames.popQueueAndDel(frame);
+        if (buffering || paused) {
+            // 缓冲或者暂停中：停在当前画面，不再取出帧。
+            clock_serial = -1; // 时钟停止，恢复后从下一帧重新对齐
+            av_usleep(10 * 1000); // 单位微秒
+            continue;
+        }
+
+        int frame_serial = 0;
+        int result = frames.popQueueAndDel(frame, &frame_serial);
         if (!is_playing) { // 用户停止播放,跳出循环并释放资源。
             break;
         }
@@ -180,16 +221,74 @@ void VideoChannel::video_play() {
             continue;
         }
 
+        if (isStaleFrame(frame_serial)) {
+            // seek之前解码的帧，不再转换和渲染。
+            av_frame_unref(frame);
+            releaseAVFrame(&frame);
+            continue;
+        }
+
+        if (isEofFrame(frame)) {
+            // 解码线程送来的结束标记，视频播放完成。
+            releaseAVFrame(&frame);
+            notifyCompleted();
+            continue;
+        }
+
+        if (resync) {
+            // 从后台恢复：落后于音频时钟的帧不再转换和渲染，直接丢弃。
+            if (audio_channel
+                && frame->best_effort_timestamp * av_q2d(time_base) < audio_channel->audio_time) {
+                av_frame_unref(frame);
+                releaseAVFrame(&frame);
+                continue;
+            }
+            resync = false;
+        }
+        play_ts = frame->best_effort_timestamp;
+
+        int64_t cpu_time = thread_cpu_time();
+
+        if (!sws_context || frame->width != src_width || frame->height != src_height
+            || frame->format != src_format) {
+            src_width = frame->width;
+            src_height = frame->height;
+            src_format = frame->format;
+
+            // 在堆中申请空间
+            av_freep(&dst_data[0]);
+            av_image_alloc(dst_data, dst_line_size,
+                           src_width, src_height,
+                           AV_PIX_FMT_RGBA,
+                           1);
+
+            sws_context = sws_getCachedContext(
+                    sws_context, // 参数相同时直接复用
+                    src_width, // 视频输入的宽
+                    src_height, // 视频输入的高
+                    (AVPixelFormat) src_format, // 视频输入的像素格式，80%的视频格式是 AV_PIX_FMT_YUV420P
+                    src_width, // 视频输出的宽
+                    src_height, // 视频输出的高
+                    AV_PIX_FMT_RGBA, // 视频输出的格式
+                    SWS_BILINEAR, // 格式转换的算法，各种类型，需要学习.
+                    NULL, NULL, NULL
+            );
+            LOGD("创建格式转换 %d x %d, format = %d\n", src_width, src_height, src_format)
+        }
+
         // 格式转换
         sws_scale(sws_context,
                   frame->data, // 输入渲染一行的数据
                   frame->linesize, // 输入渲染一行的大小
                   0, // 输入渲染一行的宽度，一般为0
-                  codecContext->height, // 输入渲染一行的高度
+                  src_height, // 输入渲染一行的高度
                   dst_data, // 输出渲染的数据
                   dst_line_size // 输出渲染的大小
         );
 
+        convert_cpu_time += thread_cpu_time() - cpu_time;
+        converted_frames++;
+
         // 把rgba渲染到屏幕上。
         // 如何渲染一帧图像？
         // 答：需要 宽/高/数据
@@ -210,7 +309,17 @@ void VideoChannel::video_play() {
 
         // 获取音视频的当前帧时间戳
         video_time = frame->best_effort_timestamp * av_q2d(time_base);
-        audio_time = audio_channel->audio_time;
+        if (audio_channel) {
+            audio_time = audio_channel->audio_time;
+        } else {
+            double now = av_gettime_relative() / 1000000.0;
+            if (clock_serial != frame_serial || fabs(now - clock_start - video_time) > 1) {
+                // 新的播放代数，或者时间戳不连续（直播重连），从当前帧重新开始计时
+                clock_start = now - video_time;
+                clock_serial = frame_serial;
+            }
+            audio_time = now - clock_start;
+        }
         // 定义差值
         time_diff = video_time - audio_time;
         // 判断两个时间差值
@@ -228,19 +337,29 @@ void VideoChannel::video_play() {
             if (fabs(time_diff) <= 0.05) { // fabs()把数值取绝对值。
                 // 此处丢包时，涉及到多线程。
 
-                frames.sync();
+                frames.sync(frame_serial);
 
+                av_frame_unref(frame);
+                releaseAVFrame(&frame); // 当前帧也不再渲染，释放
                 continue;
             }
         } else { // 音视频播放完全同步
 
         }
 
-        renderCallback(dst_data[0],  // 数组被传递会退化成指针
-                       codecContext->width,
-                       codecContext->height,
+        renderCallback(render_args,
+                       dst_data[0],  // 数组被传递会退化成指针
+                       src_width,
+                       src_height,
                        dst_line_size[0]);
 
+        if (!first_frame_time) {
+            first_frame_time = av_gettime_relative() - start_time;
+            LOGD("首帧画面耗时 %lld ms\n", (long long) first_frame_time / 1000)
+        }
+
+        onFirstFrameAfterSeek();
+
         av_frame_unref(frame);
         releaseAVFrame(&frame); // 此处不考虑回退，所以渲染完成后可以直接被释放。
     }
@@ -249,12 +368,13 @@ void VideoChannel::video_play() {
     releaseAVFrame(&frame);
     sws_freeContext(sws_context);
     is_playing = false;
-    av_free(dst_data);
-    av_free(dst_line_size);
+    av_freep(&dst_data[0]); // av_image_alloc 申请的是一整块空间，释放第一个指针即可
 }
 
 void VideoChannel::start() {
     is_playing = true;
+    start_time = av_gettime_relative();
+    first_frame_time = 0;
 
     // 队列开始工作
     packets.working(true);
@@ -267,10 +387,80 @@ void VideoChannel::start() {
     pthread_create(&pid_video_play, 0, task_video_play, this);
 }
 
-void VideoChannel::setRenderCallback(RenderCallback renderCallback) {
+void VideoChannel::setRenderCallback(RenderCallback renderCallback, void *args) {
     this->renderCallback = renderCallback;
+    this->render_args = args;
 }
 
 void VideoChannel::setAudioChannel(AudioChannel *channel) {
     this->audio_channel = channel;
 }
+
+/**
+ * 设置后台模式（解封装线程调用）。
+ * 进入后台：开始新的播放代数，队列中的数据在取出时丢弃，之后的视频压缩包在分发时丢弃，
+ * 解码线程和播放线程阻塞在空队列上，不再占用CPU。
+ * 回到前台：等待下一个关键帧，清空解码器后从关键帧开始解码，并丢弃落后于音频时钟的帧。
+ */
+void VideoChannel::setBackground(bool background) {
+    if (this->background == background) {
+        return;
+    }
+    if (background) {
+        this->background = true;
+        wait_keyframe = false;
+        startSeek(AV_NOPTS_VALUE); // 不清空队列：结束标记等由解封装线程按新的代数重新放入
+        LOGD("进入后台模式，停止视频解码\n")
+    } else {
+        wait_keyframe = true;
+        this->background = false;
+        LOGD("退出后台模式，丢弃压缩包 %lld 个，估算节省CPU %lld ms\n",
+             (long long) background_dropped_packets,
+             (long long) (background_dropped_packets * frameCpuTime() / 1000))
+    }
+}
+
+/**
+ * 分发视频压缩包时调用，判断该包是否需要进入队列。
+ * @return false 表示丢弃，由调用者释放
+ */
+bool VideoChannel::acceptPacket(AVPacket *packet) {
+    if (background) {
+        background_dropped_packets++;
+        background_dropped_bytes += packet->size;
+        return false;
+    }
+    if (wait_keyframe) {
+        if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+            background_dropped_packets++;
+            background_dropped_bytes += packet->size;
+            return false;
+        }
+        wait_keyframe = false;
+        serial++; // 从关键帧开始新的播放代数，解码线程会先清空解码器
+        resync = true;
+    }
+    return true;
+}
+
+/**
+ * 丢弃队列中的数据，从下一个关键帧开始播放（解封装线程调用，直播延时过大时追赶）。
+ */
+void VideoChannel::skipToKeyframe() {
+    startSeek(AV_NOPTS_VALUE); // 队列中已有的包和帧都属于之前的代数，取出时丢弃
+    wait_keyframe = true;
+}
+
+/**
+ * 平均每帧视频解码+格式转换的CPU时间，单位微秒
+ */
+int64_t VideoChannel::frameCpuTime() {
+    int64_t time = 0;
+    if (decoded_frames) {
+        time += decode_cpu_time / decoded_frames;
+    }
+    if (converted_frames) {
+        time += convert_cpu_time / converted_frames;
+    }
+    return time;
+}
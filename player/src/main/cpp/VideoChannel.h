@@ -9,7 +9,7 @@
 #include "BaseChannel.h"
 #include "AudioChannel.h"
 
-typedef void(*RenderCallback)(uint8_t *, int, int, int);// 定义函数指针，用于渲染视频时返回必须参数。
+typedef void(*RenderCallback)(void *, uint8_t *, int, int, int);// 定义函数指针，用于渲染视频时返回必须参数，第一个参数为设置回调时的args。
 
 class VideoChannel : public BaseChannel {
 
@@ -17,11 +17,25 @@ private:
     pthread_t pid_video_decode;
     pthread_t pid_video_play;
     RenderCallback renderCallback;
+    void *render_args = 0; // 给renderCallback的参数
 
     int fps; // 一秒多少帧画面
     AudioChannel *audio_channel = 0;
 
+    int64_t decode_cpu_time = 0; // 解码累计的CPU时间，单位微秒
+    int64_t convert_cpu_time = 0; // 格式转换累计的CPU时间，单位微秒
+    int64_t decoded_frames = 0; // 解码的帧数
+    int64_t converted_frames = 0; // 格式转换的帧数
+
 public:
+    volatile bool background = false; // 后台模式：没有surface时只播放音频，视频压缩包在分发时直接丢弃
+    volatile bool wait_keyframe = false; // 从后台恢复，等待下一个关键帧
+    volatile bool resync = false; // 从后台恢复，丢弃落后于音频时钟的帧，直到追上音频
+    int64_t background_dropped_packets = 0; // 后台模式丢弃的压缩包数量
+    int64_t background_dropped_bytes = 0; // 后台模式丢弃的压缩包字节数
+    int64_t start_time = 0; // 调用start的时间，单位微秒
+    int64_t first_frame_time = 0; // 第一帧画面渲染的耗时（time-to-first-frame），单位微秒
+
     VideoChannel(int, AVCodecContext *, AVRational, int);
 
     virtual ~VideoChannel();
@@ -34,9 +48,17 @@ public:
 
     void video_play();
 
-    void setRenderCallback(RenderCallback renderCallback);
+    void setRenderCallback(RenderCallback renderCallback, void *args);
 
     void setAudioChannel(AudioChannel *channel);
+
+    void setBackground(bool background);
+
+    bool acceptPacket(AVPacket *packet);
+
+    void skipToKeyframe();
+
+    int64_t frameCpuTime();
 };
 
 
@@ -1,6 +1,8 @@
 
 #include "VideoPlayer.h"
 
+int64_t VideoPlayer::last_teardown_time = 0;
+
 VideoPlayer::VideoPlayer(const char *data_source, JNICallbackHelper *helper) {
     // 这里的赋值在栈中，当jni函数弹栈后，会被回收。this->data_source指针会悬空。所以需要深拷贝。
 //    this->data_source = data_source;
@@ -11,6 +13,9 @@ VideoPlayer::VideoPlayer(const char *data_source, JNICallbackHelper *helper) {
     this->helper = helper;
 
     pthread_mutex_init(&seek_mutex, nullptr);
+    pthread_mutex_init(&record_mutex, nullptr);
+    pthread_mutex_init(&stats_mutex, nullptr);
+    pthread_cond_init(&demux_cond, nullptr);
 }
 
 VideoPlayer::~VideoPlayer() {
@@ -22,8 +27,20 @@ VideoPlayer::~VideoPlayer() {
         delete this->helper;
         this->helper = nullptr;
     }
+    if (this->audio_sink_path) {
+        delete[] this->audio_sink_path;
+        this->audio_sink_path = nullptr;
+    }
+
+    // 使用它的解封装上下文都已经关闭
+    DELETE(file_io)
+    DELETE(aux_io)
+    DELETE(audio_io)
 
     pthread_mutex_destroy(&seek_mutex);
+    pthread_mutex_destroy(&record_mutex);
+    pthread_mutex_destroy(&stats_mutex);
+    pthread_cond_destroy(&demux_cond);
 }
 
 /**
@@ -43,6 +60,90 @@ void VideoPlayer::releaseWithFailed(int result) {
     }
 }
 
+/**
+ * 打开数据源的一个解封装上下文。本地文件使用映射读取（LocalFileIO），http使用磁盘缓存（HttpCacheIO），
+ * 其他使用ffmpeg默认的协议。
+ * @param io 输出自定义读取，需要在上下文关闭之后释放
+ */
+int VideoPlayer::openInput(AVFormatContext **context, AVInputFormat *format, AVDictionary **options,
+                           MediaIO **io) {
+    // 打开和读取过程中阻塞的网络IO，在停止或者有新的seek时立即返回。
+    return openInput(this->data_source, context, format, options, io, interrupt_callback, this);
+}
+
+/**
+ * 打开媒体：内存来源从注册的内存或回调读取，本地文件使用映射读取，http使用磁盘缓存，其他使用ffmpeg默认的协议。
+ * 播放器之外需要解封装的地方（如片段导出）也使用该函数。
+ * @param callback 中断回调，阻塞的IO在回调返回非0时立即返回
+ * @param io 输出自定义读取，没有时为空，在关闭上下文之后由调用方释放
+ */
+int VideoPlayer::openInput(const char *data_source, AVFormatContext **context, AVInputFormat *format,
+                           AVDictionary **options, MediaIO **io, int (*callback)(void *), void *opaque) {
+    if (!*context) {
+        *context = avformat_alloc_context();
+    }
+    (*context)->interrupt_callback.callback = callback;
+    (*context)->interrupt_callback.opaque = opaque;
+
+    *io = MemoryIO::open(data_source);
+    if (!*io) {
+        *io = LocalFileIO::open(data_source);
+    }
+    if (!*io) {
+        *io = HttpCacheIO::open(data_source, &(*context)->interrupt_callback);
+    }
+    if (*io) {
+        (*context)->pb = (*io)->pb;
+        (*context)->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    return avformat_open_input(context, data_source, format, options);
+}
+
+/**
+ * ffmpeg在阻塞的IO中反复调用，返回非0时IO立即以 AVERROR_EXIT 返回。
+ * 停止时中断一切IO；有新的seek时中断正在进行的读取或者已经过时的seek，解封装线程马上执行新的seek。
+ */
+int VideoPlayer::interrupt_callback(void *opaque) {
+    auto *player = static_cast<VideoPlayer *>(opaque);
+    if (player->demux_running && pthread_equal(pthread_self(), player->demux_thread)) {
+        // 解封装线程阻塞在网络IO中时不会回到读取循环，在这里检查数据是否快要用完。
+        // 这里在ffmpeg的IO内部，只暂停播放，不回调Java，等读取返回后由读取循环通知。
+        player->updateBuffering(false);
+    }
+    return player->abort_request || player->seek_pending;
+}
+
+/**
+ * 辅助读取器和音频读取器的中断回调：只在停止时中断。
+ * 主读取器的seek与它们无关（音频读取器的seek由自己的线程执行），不能因此中断它们的读取。
+ */
+int VideoPlayer::abort_interrupt_callback(void *opaque) {
+    auto *player = static_cast<VideoPlayer *>(opaque);
+    return player->abort_request;
+}
+
+/**
+ * 在同一个数据源上再打开一个解封装上下文（辅助读取器、音频读取器），直接使用主读取器探测到的容器格式。
+ */
+int VideoPlayer::openSecondaryInput(AVFormatContext **context, MediaIO **io) {
+    return openInput(this->data_source, context, formatContext->iformat, nullptr, io,
+                     abort_interrupt_callback, this);
+}
+
+/**
+ * 打开媒体的参数，prepare和直播重连共用。
+ */
+void VideoPlayer::setOpenOptions(AVDictionary **dictionary) {
+    av_dict_set(dictionary, "timeout", "5000000", 0);
+    if (fast_start) {
+        // 快速启动：限制探测的数据量和时长，只要拿到各个流的参数集就开始播放，其余信息在解码时补全。
+        av_dict_set(dictionary, "probesize", "32768", 0); // 最多探测32KB
+        av_dict_set(dictionary, "analyzeduration", "500000", 0); // 最多分析0.5秒，单位微秒
+        av_dict_set(dictionary, "fpsprobesize", "0", 0); // 不为了计算帧率额外读取帧
+        av_dict_set(dictionary, "fflags", "nobuffer", 0); // 探测读取的数据不缓存，直接交给播放，减少延时
+    }
+}
+
 /**
  * 子线程回调的函数
  */
@@ -59,32 +160,65 @@ void *task_prepare(void *args) {
  * ffmpeg大量使用了上下文context，因为它是C语言，没有对象的概念，所有的内容全部都存在于上下文中，保证自始至终使用的都是同一个成员。
  */
 void VideoPlayer::prepare_() {
+    int64_t prepare_start = av_gettime_relative();
+
     // 第一步，打开媒体地址（文件路径，rtmp地址）
     formatContext = avformat_alloc_context(); // 使用自带的api开辟上下文。
     AVDictionary *dictionary = nullptr;
-    av_dict_set(&dictionary, "timeout", "5000000", 0);
-    int result = avformat_open_input(&formatContext, this->data_source, nullptr, &dictionary);
+    setOpenOptions(&dictionary);
+    MediaIO *io = nullptr;
+    int result = openInput(&formatContext, nullptr, &dictionary, &io);
     av_dict_free(&dictionary); // 释放字典,自我理解是把字典中的内容赋值到上下文中，所以此处不需要字典了。
+    pthread_mutex_lock(&stats_mutex);
+    file_io = io;
+    pthread_mutex_unlock(&stats_mutex);
     if (result) {
         LOGD("第一步异常\n")
         releaseWithFailed(result);
         return;
     }
+    open_time = av_gettime_relative() - prepare_start;
 
     // 这种方式获取mp4文件没有问题，但是获取flv文件获取不到。因为mp4的头文件中存在总时长信息。
 //    formatContext->duration;
 
     // 第二步，查询媒体中的音视频流信息。avformat_find_stream_info会对整个流进行扫描
-    result = avformat_find_stream_info(formatContext, nullptr);
-    if (result < 0) {
-        LOGD("第二步异常\n")
-        releaseWithFailed(result);
-        return;
+    // 同一个文件再次打开时，直接使用上次探测的结果，跳过扫描。
+    media_info_cached = MediaInfoCache::restore(this->data_source, formatContext);
+    if (!media_info_cached) {
+        result = avformat_find_stream_info(formatContext, nullptr);
+        if (result < 0) {
+            LOGD("第二步异常\n")
+            releaseWithFailed(result);
+            return;
+        }
+        MediaInfoCache::save(this->data_source, formatContext);
     }
+    probe_time = av_gettime_relative() - prepare_start - open_time;
 
     // 此处需要除以时间基，因为formatContext->duration的单位是有理数(时间基)，不是总时长。
     this->duration = formatContext->duration / AV_TIME_BASE;
 
+    // 打开视频流的关键帧索引（之前播放时建立的旁路文件），用于之后的seek。
+    // 与下面创建通道的规则一致：第一个不是封面的视频流。
+    int video_index = -1;
+    for (int i = 0; i < (int) formatContext->nb_streams; i++) {
+        AVStream *stream = formatContext->streams[i];
+        if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO
+            && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            video_index = i;
+            break;
+        }
+    }
+    if (video_index >= 0) {
+        keyframe_index = KeyframeIndex::open(this->data_source, formatContext, video_index);
+        if (keyframe_index && keyframe_index->isComplete() && this->duration <= 0) {
+            // 裸流等没有时长信息的文件，完整的索引覆盖了整个文件，可以作为总时长，支持拖动。
+            this->duration = keyframe_index->coveredDuration() / AV_TIME_BASE;
+            LOGD("使用关键帧索引的时长 %d s\n", this->duration)
+        }
+    }
+
     // 此时说明流是一个合格的流媒体。
 
 
@@ -99,11 +233,24 @@ void VideoPlayer::prepare_() {
         // 第五步，从流中获取编码解码的参数(包含了所有的视频、音频、字幕参数)
         AVCodecParameters *parameters = stream->codecpar;
 
+        LOGD("流类型 %d \n", parameters->codec_type)
+
+        // 只播放第一个音频流和第一个视频流（封面流只有一帧，也跳过），
+        // 其余的流（字幕、数据、多余的音轨等）设置为丢弃，解封装时直接跳过，不再读出压缩包。
+        bool used = (parameters->codec_type == AVMediaType::AVMEDIA_TYPE_AUDIO && !this->audio_channel)
+                    || (parameters->codec_type == AVMediaType::AVMEDIA_TYPE_VIDEO && !this->video_channel
+                        && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC));
+        if (!used) {
+            stream->discard = AVDISCARD_ALL;
+            continue;
+        }
+
         // 第六步，获取解码器（根据上面的参数）,解码播放，编码封包
         AVCodec *codec = avcodec_find_decoder(parameters->codec_id);
         if (!codec) {
-            LOGD("第六步异常\n")
-            releaseWithFailed(result);
+            LOGD("第六步异常，没有解码器 codec_id = %d\n", parameters->codec_id)
+            stream->discard = AVDISCARD_ALL;
+            continue;
         }
 
         // 第七步，通过上下文，协助解码器进行播放
@@ -122,13 +269,6 @@ void VideoPlayer::prepare_() {
             return;
         }
 
-        LOGD("流类型 %d \n", parameters->codec_type)
-
-        if (parameters->codec_type != AVMediaType::AVMEDIA_TYPE_AUDIO
-            && parameters->codec_type != AVMediaType::AVMEDIA_TYPE_VIDEO) {
-            continue;
-        }
-
         // 第九步，打开解码器
         result = avcodec_open2(codecContext, codec, nullptr);
         if (result) {
@@ -142,9 +282,8 @@ void VideoPlayer::prepare_() {
         AVRational time_base = stream->time_base;
 
         // 第十步，从编解码器参数中，获取流的类型
-        // 注意：this->audio_channel == nullptr此处判空，主要用于防止重复创建。媒体流的类型可能重复。
-        if (parameters->codec_type == AVMediaType::AVMEDIA_TYPE_AUDIO
-            && this->audio_channel == nullptr) { // 音频流
+        // 注意：上面已经判断了通道是否已经创建，媒体流的类型可能重复，每种类型只创建一个通道。
+        if (parameters->codec_type == AVMediaType::AVMEDIA_TYPE_AUDIO) { // 音频流
             this->audio_channel = new AudioChannel(stream_index, codecContext, time_base);
 
             if (this->duration) { // 非直播
@@ -154,22 +293,25 @@ void VideoPlayer::prepare_() {
         }
         if (parameters->codec_type == AVMediaType::AVMEDIA_TYPE_VIDEO) { // 视频流
 
-            // 如果该媒体流是封面流，只有一帧，那么跳过
-            if (stream->disposition == AV_DISPOSITION_ATTACHED_PIC) {
-                continue;
-            }
-
             // 获取视频的fps(一秒多少帧)
             AVRational fps_rational = stream->avg_frame_rate;
             int fps = av_q2d(fps_rational);
+            if (fps <= 0) {
+                // 快速启动（fpsprobesize为0）或者直播流可能拿不到平均帧率，依次尝试推测的帧率和默认值。
+                fps = av_q2d(av_guess_frame_rate(formatContext, stream, nullptr));
+                if (fps <= 0) {
+                    fps = 25;
+                }
+            }
 
             this->video_channel = new VideoChannel(stream_index, codecContext, time_base, fps);
-            this->video_channel->setRenderCallback(this->renderCallback);
+            this->video_channel->setRenderCallback(this->renderCallback, this->render_args);
 
             if (this->duration) { // 非直播
                 video_channel->setJniCallbackHelper(helper);
             }
         }
+        codecContext = nullptr; // 解码器上下文已经交给通道
     }
 
     // 第十一步，如果流中没有音频也没有视频。（对流进行再次校验）
@@ -179,6 +321,34 @@ void VideoPlayer::prepare_() {
         return;
     }
 
+    // 压缩包分发表：流的下标 -> 通道，分发时直接查表。
+    stream_channels.assign(formatContext->nb_streams, nullptr);
+    if (audio_channel) {
+        stream_channels[audio_channel->stream_index] = audio_channel;
+    }
+    if (video_channel) {
+        stream_channels[video_channel->stream_index] = video_channel;
+    }
+
+    // 没有时长的网络流按直播处理，控制延时。
+    network = strstr(data_source, "://") && strncmp(data_source, "file://", 7) != 0
+              && !MemoryIO::isMemory(data_source);
+    live = this->duration <= 0 && network;
+
+    // 多码率的hls：其他码率的流在上面已经设置为丢弃，按下载吞吐切换。
+    if (video_channel && strstr(formatContext->iformat->name, "hls")) {
+        AbrController *controller = AbrController::create(formatContext, video_channel->stream_index,
+                                                          audio_channel ? audio_channel->stream_index : -1);
+        pthread_mutex_lock(&stats_mutex);
+        abr = controller;
+        pthread_mutex_unlock(&stats_mutex);
+    }
+
+    prepare_time = av_gettime_relative() - prepare_start;
+    LOGD("prepare耗时 %lld ms（打开 %lld ms，探测 %lld ms），快速启动 %d，媒体信息缓存 %s\n",
+         (long long) prepare_time / 1000, (long long) open_time / 1000,
+         (long long) probe_time / 1000, fast_start, media_info_cached ? "命中" : "未命中")
+
     // 第十二步，prepare完成。通知Java层。
     if (this->helper) {
         LOGD("prepare完成\n")
@@ -205,34 +375,122 @@ void *task_start(void *args) {
     return nullptr; // 必须返回数据
 }
 
+/**
+ * 通道播放完成的回调，运行在该通道的播放线程
+ */
+void task_channel_completed(void *args) {
+    auto *player = static_cast<VideoPlayer *>(args);
+    player->onChannelCompleted();
+}
+
+/**
+ * 音频和视频都播放完成后，通知Java层。
+ */
+void VideoPlayer::onChannelCompleted() {
+    pthread_mutex_lock(&seek_mutex);
+    bool completed = (!audio_channel || audio_channel->finished)
+                     && (!video_channel || video_channel->finished);
+    if (completed && !completed_notified) {
+        completed_notified = true;
+        LOGD("播放完成\n")
+        if (this->helper) {
+            this->helper->onCompleted(THREAD_CHILD);
+        }
+    }
+    pthread_mutex_unlock(&seek_mutex);
+}
+
+/**
+ * 给压缩包带上流的编码参数（AV_PKT_DATA_NEW_EXTRADATA），解码器收到后使用新的参数。
+ * 切换码率后新的流的编码参数（sps/pps等）可能与原来的流不同。
+ */
+static void addNewExtradata(AVPacket *packet, AVStream *stream) {
+    AVCodecParameters *parameters = stream->codecpar;
+    if (parameters->extradata_size <= 0) {
+        return;
+    }
+    uint8_t *data = av_packet_new_side_data(packet, AV_PKT_DATA_NEW_EXTRADATA, parameters->extradata_size);
+    if (data) {
+        memcpy(data, parameters->extradata, parameters->extradata_size);
+    }
+}
+
+/**
+ * 读到结尾，给每个通道放入结束标记。结束标记会依次流过压缩包队列、解码器（冲刷）、解压包队列，
+ * 最终由播放线程通知播放完成。
+ */
+void VideoPlayer::sendEof() {
+    if (video_channel) {
+        video_channel->packets.insertToQueue(BaseChannel::createEofPacket(), video_channel->serial);
+    }
+    if (audio_channel && !audio_context) { // 双读取器模式下音频由自己的解封装线程放入结束标记
+        audio_channel->packets.insertToQueue(BaseChannel::createEofPacket(), audio_channel->serial);
+    }
+}
+
 void VideoPlayer::start_() {
 
     // 第一步，把媒体压缩包保存到对应的数据队列中.
     // 注意：如果音频采样率较高（单通道采样数为1024），视频帧率较低时，此时音频包的生产速度大于视频包生产速度。
 
-    bool videoReadFinished = false;
-    bool is_limit = false;
+    demux_thread = pthread_self();
+    pthread_mutex_lock(&seek_mutex); // setBackground按是否已经开始决定由谁执行
+    demux_running = true;
+    pthread_mutex_unlock(&seek_mutex);
+
+    // 直播时移：读到的压缩包先保存在时移缓存中，再按通道的需要送出，暂停和回退时网络数据继续保存。
+    if (live && time_shift_seconds > 0 && (audio_channel || video_channel)) {
+        auto *buffer = new TimeShiftBuffer(video_channel ? (BaseChannel *) video_channel : audio_channel,
+                                           (int64_t) time_shift_seconds * AV_TIME_BASE, time_shift_memory,
+                                           data_source, time_shift_disk);
+        pthread_mutex_lock(&stats_mutex);
+        time_shift = buffer;
+        pthread_mutex_unlock(&stats_mutex);
+    }
 
-    while (is_playing) {
+    while (is_playing && !abort_request) {
 
-        // 判断如果生产视频编码包太快，超过阈值，则让生产队列等待。
+        updateBuffering();
 
-        if (video_channel) {
-            video_channel->beyondLimitsWithPackets(&is_limit);
+        if (seek_pending) {
+            // seek在解封装线程中执行，不会与av_read_frame并发。
+            seek_();
+            continue;
         }
 
-        if (is_limit) {
-            av_usleep(2 * 1000); // 单位微秒
+        if (time_shift_pending) {
+            timeShift_();
             continue;
         }
 
-        if (video_channel) {
-            video_channel->isEmptyVideoQueue(&videoReadFinished);
+        if (background_pending) {
+            background_();
+            continue;
         }
 
-        if (videoReadFinished) {
-            if (video_channel->frames.empty() && audio_channel->frames.empty()) {
-                break;
+        if (time_shift) {
+            feedTimeShift();
+        }
+
+        if (read_eof) {
+            // 已经读到结尾，结束标记已经放入队列。此时不再读取，睡眠等待seek或者停止，不占用CPU。
+            pthread_mutex_lock(&seek_mutex);
+            while (is_playing && read_eof && !seek_pending && !background_pending) {
+                pthread_cond_wait(&demux_cond, &seek_mutex);
+            }
+            pthread_mutex_unlock(&seek_mutex);
+            continue;
+        }
+
+        // 判断如果某个通道的压缩包生产太快，超过阈值，则让生产队列等待。
+        // 交错不均匀的文件，一个通道的队列满了，另一个通道可能还在饥饿，此时用辅助读取器单独读取饥饿的通道。
+        BaseChannel *full_channel = nullptr;
+        BaseChannel *starving_channel = nullptr;
+        checkBufferLevels(&full_channel, &starving_channel);
+
+        if (full_channel && !time_shift) { // 时移时网络数据一直读取，不受通道的队列限制
+            if (!starving_channel || !readAuxiliary(starving_channel)) {
+                av_usleep(2 * 1000); // 单位微秒
             }
             continue;
         }
@@ -243,38 +501,783 @@ void VideoPlayer::start_() {
         // AVPacket 是压缩包的类型(音频和视频的帧数据，都在这个包中)
         AVPacket *packet = av_packet_alloc();
         // 此时，formatContext中存在了流媒体的数据源，可以直接读取。
+        int64_t read_start = av_gettime_relative();
         int result = av_read_frame(this->formatContext, packet); // 从媒体中读取音/视频包.
         if (!result) { // if(result) 表示 if(result != null)
+            if (abr) {
+                abr->onRead(packet->size, av_gettime_relative() - read_start);
+            }
 
             // 把AVPacket假如队列，提前区分音频和视频，加入不同的数据队列
+            BaseChannel *channel = nullptr;
+            if (packet->stream_index < (int) stream_channels.size()) {
+                channel = stream_channels[packet->stream_index];
+            }
+
+            if (abr && abr->isPending(packet->stream_index)) {
+                // 正在切换到的码率：从视频关键帧开始接替原来的流，之前的包丢弃
+                if (!switchVariant(packet)) {
+                    av_packet_unref(packet);
+                    BaseChannel::releaseAVPacket(&packet);
+                    continue;
+                }
+                channel = stream_channels[packet->stream_index];
+            }
+
+            if (packet->stream_index == abr_extradata_stream) {
+                addNewExtradata(packet, formatContext->streams[packet->stream_index]);
+                abr_extradata_stream = -1;
+            }
+
+            if (!channel) {
+                // 不播放的流。读取过程中新出现的流（flv、ts等）也设置为丢弃，之后不再读出。
+                formatContext->streams[packet->stream_index]->discard = AVDISCARD_ALL;
+                discarded_packets++;
+                discarded_bytes += packet->size;
+                av_packet_unref(packet);
+                BaseChannel::releaseAVPacket(&packet);
+                continue;
+            }
+
+            if (channel == aux_channel) {
+                int64_t ts = BaseChannel::packetTs(packet);
+                if (ts != AV_NOPTS_VALUE && ts <= aux_last_ts) {
+                    // 辅助读取器已经送过的包
+                    av_packet_unref(packet);
+                    BaseChannel::releaseAVPacket(&packet);
+                    continue;
+                }
+                // 主读取器追上了辅助读取器，之后的包由主读取器继续送
+                closeAuxiliary();
+                aux_channel = nullptr;
+            }
+
+            recordPacket(packet, channel); // 后台模式丢弃的视频包也要录制
 
             // if条件表示为视频
-            if (video_channel->stream_index == packet->stream_index) {
-                video_channel->packets.insertToQueue(packet);
+            if (channel == video_channel) {
+                if (keyframe_index) {
+                    keyframe_index->add(packet); // 后台模式下丢弃的包也要记录
+                }
+                if (!time_shift && !video_channel->acceptPacket(packet)) {
+                    // 后台模式，视频包直接丢弃，不再解码。
+                    av_packet_unref(packet);
+                    BaseChannel::releaseAVPacket(&packet);
+                    continue;
+                }
             }
 
-            // if条件表示为音频
-            if (audio_channel->stream_index == packet->stream_index) {
-                audio_channel->packets.insertToQueue(packet);
+            if (time_shift) {
+                // 保存到时移缓存，下一轮按通道的需要送出
+                time_shift->append(packet, channel);
+                av_packet_unref(packet);
+                BaseChannel::releaseAVPacket(&packet);
+            } else {
+                channel->queuePacket(packet);
             }
-        } else if (result == AVERROR_EOF) { // 表示流媒体读取完毕
-            // 但并不代表播放完成。
-            // 此处文件读取到末尾时，判断编码包队列中是否还存在数据，如果没有数据表示视频已经播放完毕。此时退出while循环。
-            if (video_channel->frames.empty() && audio_channel->frames.empty()) {
-                break;
+
+            if (outage_start_time) {
+                // 重连后的第一个压缩包，断开结束
+                last_outage_time = av_gettime_relative() - outage_start_time;
+                outage_time += last_outage_time;
+                outage_start_time = 0;
+                LOGD("直播恢复，断开 %lld ms\n", (long long) last_outage_time / 1000)
+            }
+
+            if (live && live_latency_target > 0 && !paused && !time_shifted) {
+                checkLiveLatency();
+            }
+
+            if (abr) {
+                checkVariant();
             }
         } else {
-            break; //av_read_frame出现异常。
+            av_packet_unref(packet);
+            BaseChannel::releaseAVPacket(&packet);
+
+            if (abort_request || seek_pending) {
+                // 读取被中断（或者中断导致的读取失败），不是读到了结尾。停止时退出循环，seek时执行新的seek。
+                interrupted_reads++;
+                continue;
+            }
+
+            if (live) {
+                // 直播没有结尾，读取失败或者服务器关闭连接都是断开，重连后继续播放。
+                if (!outage_start_time) {
+                    outage_start_time = av_gettime_relative();
+                }
+                LOGD("直播断开 %d，开始重连\n", result)
+                if (reconnect()) {
+                    continue;
+                }
+                if (!is_playing || abort_request) {
+                    continue; // 停止播放
+                }
+            }
+
+            // AVERROR_EOF 表示流媒体读取完毕，但并不代表播放完成，队列中还有数据。
+            // 其他为av_read_frame出现异常，同样把已经读到的数据播放完。
+            if (result != AVERROR_EOF) {
+                LOGD("av_read_frame异常 %d\n", result)
+            } else if (keyframe_index) {
+                keyframe_index->onEof();
+            }
+            pthread_mutex_lock(&seek_mutex);
+            read_eof = true;
+            sendEof();
+            pthread_mutex_unlock(&seek_mutex);
+            updateBuffering(); // 已经读到结尾，剩下的数据直接播放完
         }
     }
-    is_playing = false;
+}
+
+/**
+ * 网络流的缓冲状态（解封装线程调用）。
+ *
+ * 超前播放位置的数据（各个通道取最少的，后台模式的视频不计入）低于低水位时进入缓冲：播放线程暂停，时钟不前进，
+ * 不会在数据用完时卡在任意位置；达到高水位、队列已满或者读到结尾时恢复播放。
+ * 同时把已经读到的位置作为缓冲位置通知Java，显示在拖动条的第二进度上。
+ * @param notify 是否回调Java；在中断回调中为false，状态变化留到读取循环中通知
+ */
+void VideoPlayer::updateBuffering(bool notify) {
+    if (!network) {
+        return;
+    }
+    if (notify && buffering_notify_pending) {
+        buffering_notify_pending = false;
+        if (this->helper) {
+            this->helper->onBuffering(THREAD_CHILD, buffering);
+        }
+    }
+    double level = -1;
+    double position = 0;
+    bool full = false;
+    BaseChannel *channels[] = {video_channel, audio_channel};
+    for (BaseChannel *channel : channels) {
+        if (!channel || (channel == video_channel && video_channel->background)) {
+            continue;
+        }
+        double ahead = channel->aheadDuration();
+        if (level < 0 || ahead < level) {
+            level = ahead;
+        }
+        bool is_limit = false;
+        channel->beyondLimitsWithPackets(&is_limit);
+        full = full || is_limit;
+        int64_t tail_ts = channel->tail_ts;
+        if (tail_ts != AV_NOPTS_VALUE && tail_ts * av_q2d(channel->time_base) > position) {
+            position = tail_ts * av_q2d(channel->time_base);
+        }
+    }
+    if (level < 0) {
+        return;
+    }
+
+    if (notify && this->duration > 0 && (int) position != buffered_position) {
+        buffered_position = (int) position;
+        if (this->helper) {
+            this->helper->onBufferedPosition(THREAD_CHILD, buffered_position);
+        }
+    }
+
+    // 直播的高水位不超过目标延时，否则恢复播放时延时已经超过目标
+    double high = BUFFER_HIGH_WATERMARK;
+    if (live && live_latency_target > 0) {
+        high = FFMAX(BUFFER_LOW_WATERMARK, FFMIN(high, live_latency_target / 1000.0));
+    }
+    if (!buffering && level < BUFFER_LOW_WATERMARK && !read_eof) {
+        setBuffering(true, notify);
+    } else if (buffering && (level >= high || full || read_eof)) {
+        setBuffering(false, notify);
+    }
+}
+
+void VideoPlayer::setBuffering(bool buffering, bool notify) {
+    this->buffering = buffering;
+    if (audio_channel) {
+        audio_channel->buffering = buffering;
+    }
     if (video_channel) {
-        video_channel->stop();
+        video_channel->buffering = buffering;
+    }
+    int64_t now = av_gettime_relative();
+    if (buffering) {
+        buffering_count++;
+        buffering_start_time = now;
+        LOGD("开始缓冲\n")
+    } else {
+        buffering_time += now - buffering_start_time;
+        LOGD("缓冲结束，耗时 %lld ms\n", (long long) (now - buffering_start_time) / 1000)
     }
+    if (!notify) {
+        buffering_notify_pending = true;
+    } else if (this->helper) {
+        this->helper->onBuffering(THREAD_CHILD, buffering);
+    }
+}
+
+/**
+ * 直播的延时控制（解封装线程每送出一个压缩包调用一次）。
+ *
+ * 延时为已经收到的数据比正在播放的位置超前的时长：有音频时是音频最新的压缩包与音频时钟之差，
+ * 只有视频时是视频压缩包队列的缓存时长。网络抖动后数据集中到达，延时会一直累积。
+ * 超过目标不多时，音频加快播放（视频跟随音频时钟），回到目标以内后恢复正常速度；
+ * 超过很多时，直接丢弃缓存，从下一个关键帧开始播放。
+ */
+void VideoPlayer::checkLiveLatency() {
+    if (buffering) {
+        return; // 缓冲中播放暂停，数据超前是正常的
+    }
+    int64_t now = av_gettime_relative();
+    if (now - live_drop_time < LIVE_DROP_COOLDOWN) {
+        return; // 刚刚丢弃过缓存，音频时钟还是之前的位置
+    }
+
+    int64_t latency;
     if (audio_channel) {
-        audio_channel->stop();
+        int64_t tail_ts = audio_channel->tail_ts;
+        if (tail_ts == AV_NOPTS_VALUE || audio_channel->audio_time <= 0) {
+            return; // 还没有开始播放
+        }
+        latency = (int64_t) ((tail_ts * av_q2d(audio_channel->time_base) - audio_channel->audio_time) * AV_TIME_BASE);
+    } else {
+        latency = (int64_t) (video_channel->bufferedDuration() * AV_TIME_BASE);
+    }
+    live_latency = latency;
+
+    int64_t target = (int64_t) live_latency_target * 1000;
+    if (latency > target + LIVE_DROP_MARGIN) {
+        if (audio_channel) {
+            audio_channel->speedup = false;
+            audio_channel->startSeek(AV_NOPTS_VALUE);
+        }
+        if (video_channel) {
+            video_channel->skipToKeyframe();
+        }
+        live_drop_time = now;
+        live_drops++;
+        LOGD("直播延时 %lld ms 超过目标 %d ms，丢弃缓存\n", (long long) latency / 1000, live_latency_target)
+        return;
+    }
+
+    if (!audio_channel) {
+        return;
+    }
+    if (latency > target + LIVE_SPEEDUP_MARGIN && !audio_channel->speedup) {
+        audio_channel->speedup = true;
+        live_speedups++;
+        LOGD("直播延时 %lld ms 超过目标 %d ms，加快播放\n", (long long) latency / 1000, live_latency_target)
+    } else if (latency <= target && audio_channel->speedup) {
+        audio_channel->speedup = false;
+        LOGD("直播延时回到目标以内 %lld ms，恢复正常速度\n", (long long) latency / 1000)
+    }
+}
+
+/**
+ * 直播断开后重连，等待时长从 RECONNECT_DELAY_MIN 开始加倍，直到成功或者停止播放。
+ * 等待在demux_cond上，停止时立即返回。
+ *
+ * 依赖JNI和ANativeWindow，没有主机测试，在设备上手动验证：本机起一个RTMP服务器推流，播放中杀掉服务器，
+ * 日志中重连的间隔应为 0.5、1、2、4、8、8… 秒；重启服务器并推流后画面从关键帧恢复，
+ * STAT_RECONNECTS 加一，STAT_RECONNECT_ATTEMPTS 为尝试的次数，STAT_LAST_OUTAGE_US 为断开到恢复的时长。
+ * @return 是否重连成功
+ */
+bool VideoPlayer::reconnect() {
+    int64_t delay = RECONNECT_DELAY_MIN;
+    while (is_playing && !abort_request) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        int64_t nsec = deadline.tv_nsec + delay % 1000000 * 1000;
+        deadline.tv_sec += delay / 1000000 + nsec / 1000000000;
+        deadline.tv_nsec = nsec % 1000000000;
+
+        pthread_mutex_lock(&seek_mutex);
+        while (is_playing && !abort_request) {
+            if (pthread_cond_timedwait(&demux_cond, &seek_mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&seek_mutex);
+        if (!is_playing || abort_request) {
+            break;
+        }
+
+        reconnect_attempts++;
+        if (reopen()) {
+            reconnects++;
+            return true;
+        }
+        LOGD("直播重连失败，%lld ms 后重试\n", (long long) FFMIN(delay * 2, RECONNECT_DELAY_MAX) / 1000)
+        delay = FFMIN(delay * 2, RECONNECT_DELAY_MAX);
+    }
+    return false;
+}
+
+/**
+ * 重新打开直播流，替换解封装上下文。解码器和播放线程（以及surface）保持不变：
+ * 通道开始新的播放代数（清空队列、冲刷解码器，时钟从新的数据开始），视频从下一个关键帧开始。
+ * 新连接的流与之前不同（编码格式或时间基改变）时失败。
+ */
+bool VideoPlayer::reopen() {
+    AVFormatContext *context = nullptr;
+    MediaIO *io = nullptr;
+    AVDictionary *dictionary = nullptr;
+    setOpenOptions(&dictionary);
+    int result = openInput(&context, formatContext->iformat, &dictionary, &io);
+    av_dict_free(&dictionary);
+    if (!result) {
+        result = avformat_find_stream_info(context, nullptr);
+    }
+    if (result < 0) {
+        LOGD("直播重新打开失败 %d\n", result)
+        if (context) {
+            avformat_close_input(&context);
+        }
+        DELETE(io)
+        return false;
+    }
+
+    // 新连接中流的顺序可能不同，按prepare的规则重新找到音频流和视频流
+    int audio_index = -1;
+    int video_index = -1;
+    for (int i = 0; i < (int) context->nb_streams; i++) {
+        AVStream *stream = context->streams[i];
+        if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && audio_index < 0) {
+            audio_index = i;
+        } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && video_index < 0
+                   && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            video_index = i;
+        }
+    }
+    BaseChannel *channels[] = {audio_channel, video_channel};
+    int indexes[] = {audio_index, video_index};
+    for (int i = 0; i < 2; i++) {
+        if (!channels[i]) {
+            continue;
+        }
+        AVStream *stream = indexes[i] >= 0 ? context->streams[indexes[i]] : nullptr;
+        if (!stream || stream->codecpar->codec_id != channels[i]->codecContext->codec_id
+            || av_cmp_q(stream->time_base, channels[i]->time_base) != 0) {
+            LOGD("直播重新打开后流已经改变，不能继续播放\n")
+            avformat_close_input(&context);
+            DELETE(io)
+            return false;
+        }
+    }
+
+    pthread_mutex_lock(&record_mutex); // 开始录制时读取上下文和流的下标
+    avformat_close_input(&formatContext);
+    formatContext = context;
+    if (audio_channel) {
+        audio_channel->stream_index = audio_index;
+    }
+    if (video_channel) {
+        video_channel->stream_index = video_index;
+    }
+    pthread_mutex_unlock(&record_mutex);
+    // 读取统计的线程可能正在使用旧的file_io和abr，在锁中替换
+    pthread_mutex_lock(&stats_mutex);
+    DELETE(file_io)
+    file_io = io;
+    // 重新打开后只播放prepare规则选出的流，不再切换码率
+    DELETE(abr)
+    pthread_mutex_unlock(&stats_mutex);
+    abr_extradata_stream = -1;
+
+    stream_channels.assign(formatContext->nb_streams, nullptr);
+    if (audio_channel) {
+        stream_channels[audio_index] = audio_channel;
+        audio_channel->startSeek(AV_NOPTS_VALUE);
+    }
+    if (video_channel) {
+        stream_channels[video_index] = video_channel;
+        video_channel->skipToKeyframe();
+    }
+    for (int i = 0; i < (int) formatContext->nb_streams; i++) {
+        if (!stream_channels[i]) {
+            formatContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+    LOGD("直播重连成功\n")
+    return true;
+}
+
+/**
+ * HLS自适应码率：按下载吞吐和缓存决定是否切换码率，需要切换时取消新码率的流的丢弃，
+ * hls解封装器从当前时间开始下载新码率的分片。原来的流继续送给通道，直到新的流接替（switchVariant）。
+ */
+void VideoPlayer::checkVariant() {
+    double buffered = -1;
+    BaseChannel *channels[] = {audio_channel, video_channel};
+    for (BaseChannel *channel : channels) {
+        if (!channel || (channel == video_channel && video_channel->background)) {
+            continue;
+        }
+        double ahead = channel->aheadDuration();
+        if (buffered < 0 || ahead < buffered) {
+            buffered = ahead;
+        }
+    }
+    if (buffered < 0 || abr->decide(buffered) < 0) {
+        return;
+    }
+    const AbrController::Variant &next = abr->pendingVariant();
+    formatContext->streams[next.video_index]->discard = AVDISCARD_DEFAULT;
+    if (next.audio_index >= 0) {
+        formatContext->streams[next.audio_index]->discard = AVDISCARD_DEFAULT;
+    }
+}
+
+/**
+ * 读到正在切换到的码率的包时调用。视频从新的流的关键帧开始：把通道交给新的流，原来的流设置为丢弃，
+ * hls解封装器在原来的码率的当前分片结束时停止下载。解码器和转换上下文不变，
+ * 分辨率的变化由解码器（新的编码参数）和按帧创建的转换上下文、按帧设置的窗口尺寸处理。
+ * 只切换音频时（视频流相同），从新的音频流的第一个包开始。
+ * @return false 表示还没有到接替的位置，该包需要丢弃
+ */
+bool VideoPlayer::switchVariant(AVPacket *packet) {
+    const AbrController::Variant &next = abr->pendingVariant();
+    const AbrController::Variant &now = abr->currentVariant();
+    bool video_switch = next.video_index != now.video_index;
+    if (video_switch && (packet->stream_index != next.video_index || !(packet->flags & AV_PKT_FLAG_KEY))) {
+        return false;
+    }
+
+    pthread_mutex_lock(&record_mutex); // 开始录制时读取流的下标
+    if (video_switch) {
+        stream_channels[now.video_index] = nullptr;
+        formatContext->streams[now.video_index]->discard = AVDISCARD_ALL;
+        stream_channels[next.video_index] = video_channel;
+        video_channel->stream_index = next.video_index;
+        addNewExtradata(packet, formatContext->streams[next.video_index]);
+    }
+    if (audio_channel && next.audio_index >= 0 && next.audio_index != now.audio_index) {
+        stream_channels[now.audio_index] = nullptr;
+        formatContext->streams[now.audio_index]->discard = AVDISCARD_ALL;
+        stream_channels[next.audio_index] = audio_channel;
+        audio_channel->stream_index = next.audio_index;
+        abr_extradata_stream = next.audio_index;
+    }
+    pthread_mutex_unlock(&record_mutex);
+    abr->commit();
+    LOGD("HLS码率切换完成 %lld bit/s\n", (long long) abr->currentVariant().bitrate)
+    return true;
+}
+
+/**
+ * 直播时移：把时移缓存中还没有送出的压缩包送给通道，直到某个通道的队列超过阈值。
+ * 送到最新的包时，时移播放追上了直播。
+ */
+void VideoPlayer::feedTimeShift() {
+    if (time_shift->takeDiscontinuity()) {
+        // 暂停太久，还没有送出的包已经被淘汰，从剩下的第一个关键帧继续
+        if (audio_channel) {
+            audio_channel->startSeek(AV_NOPTS_VALUE);
+        }
+        if (video_channel) {
+            video_channel->startSeek(AV_NOPTS_VALUE);
+        }
+    }
+    while (is_playing) {
+        BaseChannel *full_channel = nullptr;
+        BaseChannel *starving_channel = nullptr;
+        checkBufferLevels(&full_channel, &starving_channel);
+        if (full_channel) {
+            break;
+        }
+        BaseChannel *channel = nullptr;
+        AVPacket *packet = time_shift->next(&channel);
+        if (!packet) {
+            if (time_shifted && !paused) {
+                time_shifted = false;
+                LOGD("时移播放追上直播\n")
+            }
+            break;
+        }
+        if (channel == video_channel && !video_channel->acceptPacket(packet)) {
+            BaseChannel::releaseAVPacket(&packet);
+            continue;
+        }
+        channel->queuePacket(packet);
+    }
+    time_shift_span = time_shift->span();
+    time_shift_delay = time_shift->delay();
+}
+
+/**
+ * 直播时移在解封装线程中执行：把送出的位置移到目标之前最近的关键帧（或者最新的关键帧，回到直播），
+ * 通道开始新的播放代数，队列中的旧数据在取出时丢弃。
+ */
+void VideoPlayer::timeShift_() {
+    pthread_mutex_lock(&seek_mutex);
+    int target = time_shift_target;
+    time_shift_pending = false;
+    pthread_mutex_unlock(&seek_mutex);
+
+    if (target > 0 && !time_shift->seekBehind((int64_t) target * AV_TIME_BASE)) {
+        LOGD("直播时移失败：缓存中没有关键帧\n")
+        return;
+    }
+    if (target <= 0) {
+        time_shift->seekLive();
+    }
+    if (audio_channel) {
+        audio_channel->speedup = false;
+        audio_channel->startSeek(AV_NOPTS_VALUE);
+    }
+    if (video_channel) {
+        video_channel->startSeek(AV_NOPTS_VALUE);
+    }
+    time_shifted = target > 0 || paused;
+    live_drop_time = av_gettime_relative(); // 音频时钟还是之前的位置，等新的数据开始播放再控制延时
+    LOGD("直播时移 %d s，缓存 %lld s\n", target, (long long) time_shift->span() / AV_TIME_BASE)
+}
+
+/**
+ * 检查各个通道压缩包队列的缓存时长。
+ * @param full_channel 输出超过阈值的通道
+ * @param starving_channel 输出饥饿的通道（后台模式的视频通道不计入）
+ */
+void VideoPlayer::checkBufferLevels(BaseChannel **full_channel, BaseChannel **starving_channel) {
+    BaseChannel *channels[] = {video_channel, audio_channel};
+    for (BaseChannel *channel : channels) {
+        if (!channel || (channel == audio_channel && audio_context)) { // 双读取器模式下音频不由主读取器读取
+            continue;
+        }
+        bool is_limit = false;
+        channel->beyondLimitsWithPackets(&is_limit);
+        if (is_limit) {
+            *full_channel = channel;
+        } else if (channel->isStarving() && !(channel == video_channel && video_channel->background)) {
+            *starving_channel = channel;
+        }
+    }
+    if (*full_channel && *starving_channel) {
+        // 交错不均衡：两个通道已经读到的位置相差的时长
+        int64_t full_end = av_rescale_q((*full_channel)->tail_ts, (*full_channel)->time_base, AV_TIME_BASE_Q);
+        int64_t starving_end = av_rescale_q((*starving_channel)->tail_ts, (*starving_channel)->time_base,
+                                            AV_TIME_BASE_Q);
+        if ((*full_channel)->tail_ts != AV_NOPTS_VALUE && (*starving_channel)->tail_ts != AV_NOPTS_VALUE
+            && full_end - starving_end > interleave_skew_max) {
+            interleave_skew_max = full_end - starving_end;
+        }
+    }
+}
+
+/**
+ * 打开辅助读取器：在同一个文件上打开第二个解封装上下文，只读取饥饿的通道，从该通道已经读到的位置继续。
+ * 只支持本地文件，并且打开时就能得到全部流的容器（flv、ts等边读边创建流的容器，流的下标可能对不上）。
+ */
+bool VideoPlayer::openAuxiliary(BaseChannel *channel) {
+    if (aux_failed || channel->tail_ts == AV_NOPTS_VALUE) {
+        return false;
+    }
+    if (!isReopenable()) {
+        aux_failed = true;
+        return false;
+    }
+    // 直接使用主读取器探测到的容器格式，不需要再探测。
+    int result = openSecondaryInput(&aux_context, &aux_io);
+    if (result || aux_context->nb_streams != formatContext->nb_streams) {
+        LOGD("打开辅助读取器失败 %d\n", result)
+        closeAuxiliary();
+        aux_failed = true;
+        return false;
+    }
+    for (int i = 0; i < (int) aux_context->nb_streams; i++) {
+        aux_context->streams[i]->discard = i == channel->stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    av_seek_frame(aux_context, channel->stream_index, channel->tail_ts, AVSEEK_FLAG_BACKWARD);
+
+    aux_channel = channel;
+    aux_last_ts = channel->tail_ts;
+    aux_opens++;
+    LOGD("交错不均衡，打开辅助读取器 stream = %d，相差 %lld ms\n", channel->stream_index,
+         (long long) interleave_skew_max / 1000)
+    return true;
+}
+
+void VideoPlayer::closeAuxiliary() {
+    if (aux_context) {
+        avformat_close_input(&aux_context);
+        aux_context = nullptr;
+    }
+    DELETE(aux_io)
+}
+
+/**
+ * 用辅助读取器给饥饿的通道读取一个压缩包。
+ * @return 没有读取（无法打开或者已经读完）时返回false
+ */
+bool VideoPlayer::readAuxiliary(BaseChannel *channel) {
+    if (aux_channel != channel) {
+        if (aux_channel || !openAuxiliary(channel)) {
+            return false;
+        }
+    }
+    if (!aux_context) {
+        return false; // 已经读完，等待主读取器追上
+    }
+    AVPacket *packet = av_packet_alloc();
+    int result = av_read_frame(aux_context, packet);
+    if (result) {
+        av_packet_unref(packet);
+        BaseChannel::releaseAVPacket(&packet);
+        closeAuxiliary();
+        return false;
+    }
+    int64_t ts = BaseChannel::packetTs(packet);
+    if (packet->stream_index != channel->stream_index
+        || (ts != AV_NOPTS_VALUE && ts <= aux_last_ts)) {
+        // 其他流的包，或者主读取器已经送过的包
+        av_packet_unref(packet);
+        BaseChannel::releaseAVPacket(&packet);
+        return true;
+    }
+    if (ts != AV_NOPTS_VALUE) {
+        aux_last_ts = ts;
+    }
+    // 主读取器会丢弃这些包，与主读取器相同在丢弃后台模式的视频包之前录制和记录关键帧
+    recordPacket(packet, channel);
+    if (channel == video_channel) {
+        if (keyframe_index) {
+            keyframe_index->add(packet);
+        }
+        if (!video_channel->acceptPacket(packet)) {
+            av_packet_unref(packet);
+            BaseChannel::releaseAVPacket(&packet);
+            return true;
+        }
+    }
+    aux_packets++;
+    channel->queuePacket(packet);
+    return true;
+}
+
+/**
+ * 是否可以在同一个数据源上再打开一个解封装上下文：只支持本地文件，
+ * 并且打开时就能得到全部流的容器（flv、ts等边读边创建流的容器，流的下标可能对不上）。
+ */
+bool VideoPlayer::isReopenable() {
+    if (strstr(data_source, "://") && strncmp(data_source, "file://", 7) != 0
+        && !MemoryIO::isMemory(data_source)) {
+        return false;
     }
+    return !(formatContext->ctx_flags & AVFMTCTX_NOHEADER);
+}
 
+void *task_audio_demux(void *args) {
+    auto *player = static_cast<VideoPlayer *>(args);
+    player->audio_demux_();
+    return nullptr;
+}
+
+/**
+ * 双读取器模式：在同一个文件上为音频打开第二个解封装上下文，只读取音频流；主读取器不再读取音频流。
+ * 音频和视频各自按自己的缓存时长读取，交错再差也不需要为了读到另一个流而缓存大量数据。
+ */
+bool VideoPlayer::openAudioReader() {
+    if (!isReopenable()) {
+        return false;
+    }
+    int result = openSecondaryInput(&audio_context, &audio_io);
+    if (result || audio_context->nb_streams != formatContext->nb_streams) {
+        LOGD("打开音频读取器失败 %d\n", result)
+        if (audio_context) {
+            avformat_close_input(&audio_context);
+            audio_context = nullptr;
+        }
+        DELETE(audio_io)
+        return false;
+    }
+    for (int i = 0; i < (int) audio_context->nb_streams; i++) {
+        audio_context->streams[i]->discard = i == audio_channel->stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    formatContext->streams[audio_channel->stream_index]->discard = AVDISCARD_ALL;
+    stream_channels[audio_channel->stream_index] = nullptr;
+    LOGD("双读取器：音频流 %d 单独解封装\n", audio_channel->stream_index)
+    return true;
+}
+
+/**
+ * 双读取器模式下的音频解封装线程，与start_相同，只是只读取音频流。
+ */
+void VideoPlayer::audio_demux_() {
+    while (is_playing && !abort_request) {
+
+        if (audio_seek_pending) {
+            audio_seek_();
+            continue;
+        }
+
+        if (audio_read_eof) {
+            pthread_mutex_lock(&seek_mutex);
+            while (is_playing && audio_read_eof && !audio_seek_pending) {
+                pthread_cond_wait(&demux_cond, &seek_mutex);
+            }
+            pthread_mutex_unlock(&seek_mutex);
+            continue;
+        }
+
+        bool is_limit = false;
+        audio_channel->beyondLimitsWithPackets(&is_limit);
+        if (is_limit) {
+            av_usleep(2 * 1000); // 单位微秒
+            continue;
+        }
+
+        AVPacket *packet = av_packet_alloc();
+        int result = av_read_frame(audio_context, packet);
+        if (!result) {
+            if (packet->stream_index != audio_channel->stream_index) {
+                av_packet_unref(packet);
+                BaseChannel::releaseAVPacket(&packet);
+                continue;
+            }
+            recordPacket(packet, audio_channel);
+            audio_channel->queuePacket(packet);
+        } else {
+            av_packet_unref(packet);
+            BaseChannel::releaseAVPacket(&packet);
+            if (abort_request || audio_seek_pending) {
+                // 与start_相同：停止或者有新的seek导致的读取失败不是读到了结尾。
+                continue;
+            }
+            if (result != AVERROR_EOF) {
+                LOGD("音频读取器 av_read_frame异常 %d\n", result)
+            }
+            pthread_mutex_lock(&seek_mutex);
+            audio_read_eof = true;
+            audio_channel->packets.insertToQueue(BaseChannel::createEofPacket(), audio_channel->serial);
+            pthread_mutex_unlock(&seek_mutex);
+        }
+    }
+}
+
+/**
+ * 运行在音频解封装线程，执行主读取器转交的seek。
+ * 音频的播放代数在音频读取器seek之后才改变，新代数的压缩包一定来自新的位置。
+ */
+void VideoPlayer::audio_seek_() {
+    pthread_mutex_lock(&seek_mutex);
+    int64_t target = audio_seek_target;
+    int mode = audio_seek_mode;
+    int64_t request_time = audio_seek_request_time;
+    audio_seek_pending = false;
+    pthread_mutex_unlock(&seek_mutex);
+
+    int64_t timestamp = av_rescale_q(target, AV_TIME_BASE_Q, audio_channel->time_base);
+    int result = av_seek_frame(audio_context, audio_channel->stream_index, timestamp, AVSEEK_FLAG_BACKWARD);
+    if (result >= 0) {
+        audio_channel->seek_request_time = request_time;
+        audio_channel->startSeek(mode == SEEK_MODE_ACCURATE ? target : AV_NOPTS_VALUE);
+
+        pthread_mutex_lock(&seek_mutex);
+        audio_channel->finished = false;
+        audio_read_eof = false;
+        pthread_mutex_unlock(&seek_mutex);
+    }
+    LOGD("音频读取器seek结束.target = %lld ms, result = %d\n", (long long) target / 1000, result)
 }
 
 void VideoPlayer::start() {
@@ -284,27 +1287,304 @@ void VideoPlayer::start() {
     // 第二步，开启播放。
     if (video_channel) {
         video_channel->setAudioChannel(audio_channel);
+        video_channel->setCompletedCallback(task_channel_completed, this);
         video_channel->start();
     }
 
     if (audio_channel) {
+        audio_channel->setAudioSink(audio_sink_type, audio_sink_path);
+        audio_channel->setGain(audio_gain, audio_mute);
+        audio_channel->setCompletedCallback(task_channel_completed, this);
         audio_channel->start();
     }
 
+    // 双读取器：音频单独解封装，必须在主解封装线程开始之前设置好主读取器丢弃音频流。
+    if (dual_reader && audio_channel && video_channel && openAudioReader()) {
+        pthread_create(&pid_audio_demux, 0, task_audio_demux, this);
+    }
+
     // 开启线程把压缩包放入压缩队列
     pthread_create(&pid_start, 0, task_start, this);
 
 }
 
-void VideoPlayer::setRenderCallback(RenderCallback renderCallback) {
+void VideoPlayer::setRenderCallback(RenderCallback renderCallback, void *args) {
     this->renderCallback = renderCallback;
+    this->render_args = args;
+}
+
+/**
+ * 设置音频输出，在start时生效。
+ * @param type AUDIO_SINK_XXX
+ * @param path AUDIO_SINK_WAV 时的文件路径，其他类型传nullptr
+ */
+void VideoPlayer::setAudioSink(int type, const char *path) {
+    this->audio_sink_type = type;
+    if (this->audio_sink_path) {
+        delete[] this->audio_sink_path;
+        this->audio_sink_path = nullptr;
+    }
+    if (path) {
+        this->audio_sink_path = new char[strlen(path) + 1];
+        strcpy(this->audio_sink_path, path);
+    }
+}
+
+/**
+ * 设置增益和静音。目前只有混音器输出（AUDIO_SINK_MIXER）支持，多画面时用于控制每一路的声音。
+ * @param gain 0.0 ~ 1.0
+ */
+void VideoPlayer::setAudioGain(float gain, bool mute) {
+    this->audio_gain = gain;
+    this->audio_mute = mute;
+    if (audio_channel) {
+        audio_channel->setGain(gain, mute);
+    }
+}
+
+/**
+ * 设置快速启动，在prepare之前调用。直播流（rtmp）默认开启。
+ */
+void VideoPlayer::setFastStart(bool fast_start) {
+    this->fast_start = fast_start;
+}
+
+/**
+ * 设置双读取器，在start之前调用。只对本地文件、同时有音频和视频时生效。
+ */
+void VideoPlayer::setDualReader(bool dual_reader) {
+    this->dual_reader = dual_reader;
+}
+
+/**
+ * 设置直播的目标延时，在start之前调用。
+ * @param latency 单位毫秒，<= 0 表示不控制延时
+ */
+void VideoPlayer::setLiveLatency(int latency) {
+    this->live_latency_target = latency;
+}
+
+/**
+ * 设置直播时移，在start之前调用
+ * @param seconds 最长保存的时长，单位秒，<= 0 表示不使用
+ * @param memory 内存上限，单位字节
+ * @param disk 溢出文件（缓存目录）的上限，单位字节，<= 0 表示只使用内存
+ */
+void VideoPlayer::setTimeShift(int seconds, int64_t memory, int64_t disk) {
+    this->time_shift_seconds = seconds;
+    this->time_shift_memory = memory > 0 ? memory : TIME_SHIFT_MEMORY_DEFAULT;
+    this->time_shift_disk = disk;
+}
+
+/**
+ * 直播时移：回到直播之前的某个位置，或者回到直播。只有直播并且设置了时移才有效。
+ * 与seek一样只记录请求，由解封装线程执行。
+ * @param seconds 落后直播的时长，单位秒，0 表示回到直播
+ */
+void VideoPlayer::timeShift(int seconds) {
+    if (!live || time_shift_seconds <= 0 || seconds < 0) {
+        return;
+    }
+    pthread_mutex_lock(&seek_mutex);
+    time_shift_target = seconds;
+    time_shift_pending = true;
+    pthread_cond_broadcast(&demux_cond);
+    pthread_mutex_unlock(&seek_mutex);
+}
+
+/**
+ * 开始录制正在播放的流（转封装，不重新编码），从下一个视频关键帧开始。之前的录制没有停止时先结束。
+ * @param path 输出文件，按后缀选择容器（mp4、mkv等）
+ * @return 输出容器不支持时返回false
+ */
+bool VideoPlayer::startRecording(const char *path) {
+    if (!formatContext || (!audio_channel && !video_channel)) {
+        return false;
+    }
+    // 解封装线程重新打开直播（reopen）、切换码率（switchVariant）时在录制的锁中替换上下文和流的下标
+    pthread_mutex_lock(&record_mutex);
+    Recorder *next = Recorder::create(path, formatContext, audio_channel, video_channel);
+    if (!next) {
+        pthread_mutex_unlock(&record_mutex);
+        return false;
+    }
+    next->start();
+    Recorder *previous = recorder;
+    recorder = next;
+    pthread_mutex_unlock(&record_mutex);
+    Recorder::releaseAsync(previous); // 之前的录制写完文件尾可能很慢，不阻塞调用线程
+    return true;
+}
+
+/**
+ * 停止录制，在下一个视频关键帧处结束，文件由录制的写入线程关闭
+ */
+void VideoPlayer::stopRecording() {
+    pthread_mutex_lock(&record_mutex);
+    if (recorder) {
+        recorder->requestStop();
+    }
+    pthread_mutex_unlock(&record_mutex);
+}
+
+/**
+ * 解封装线程中调用：正在录制时把压缩包的引用交给录制
+ */
+void VideoPlayer::recordPacket(AVPacket *packet, BaseChannel *channel) {
+    pthread_mutex_lock(&record_mutex);
+    if (recorder) {
+        recorder->write(packet, channel);
+    }
+    pthread_mutex_unlock(&record_mutex);
+}
+
+/**
+ * 暂停或者继续播放：播放线程停止输出，时钟不前进。
+ * 直播有时移缓存时，暂停期间的数据保存在缓存中，继续播放时从暂停的位置开始（落后直播）。
+ */
+void VideoPlayer::pause(bool paused) {
+    this->paused = paused;
+    if (paused && time_shift_seconds > 0) {
+        time_shifted = true; // 只有解封装线程清除
+    }
+    if (audio_channel) {
+        audio_channel->paused = paused;
+    }
+    if (video_channel) {
+        video_channel->paused = paused;
+    }
+}
+
+/**
+ * 设置后台模式：没有surface时只播放音频，停止视频解码。
+ * 与seek一样交给解封装线程执行：切换会开始视频通道新的播放代数，代数只在解封装线程中修改。
+ */
+void VideoPlayer::setBackground(bool background) {
+    if (!video_channel) {
+        return;
+    }
+    pthread_mutex_lock(&seek_mutex);
+    if (!demux_running) {
+        video_channel->setBackground(background); // 还没有开始播放，队列中没有数据
+    } else {
+        background_request = background;
+        background_pending = true;
+        pthread_cond_broadcast(&demux_cond); // 唤醒可能在结尾处等待的解封装线程
+    }
+    pthread_mutex_unlock(&seek_mutex);
+}
+
+/**
+ * 运行在解封装线程，执行最近一次的后台模式切换。
+ * 进入后台时队列中的结束标记属于之前的代数，已经读到结尾时重新放入，视频通道仍然会播放完成。
+ */
+void VideoPlayer::background_() {
+    pthread_mutex_lock(&seek_mutex);
+    bool background = background_request;
+    background_pending = false;
+    video_channel->setBackground(background);
+    if (background && read_eof) {
+        video_channel->packets.insertToQueue(BaseChannel::createEofPacket(), video_channel->serial);
+    }
+    pthread_mutex_unlock(&seek_mutex);
+}
+
+/**
+ * 获取播放统计
+ * @param stats 长度为 STAT_COUNT 的数组，下标见 PlayerStats.h
+ */
+void VideoPlayer::fetch_stats(int64_t *stats) {
+    memset(stats, 0, sizeof(int64_t) * STAT_COUNT);
+    stats[STAT_PREPARE_US] = prepare_time;
+    stats[STAT_MEDIA_INFO_CACHED] = media_info_cached;
+    stats[STAT_PREPARE_OPEN_US] = open_time;
+    stats[STAT_PREPARE_PROBE_US] = probe_time;
+    stats[STAT_DISCARDED_PACKETS] = discarded_packets;
+    stats[STAT_DISCARDED_BYTES] = discarded_bytes;
+    stats[STAT_INTERLEAVE_SKEW_US] = interleave_skew_max;
+    stats[STAT_AUX_READER_OPENS] = aux_opens;
+    stats[STAT_AUX_READER_PACKETS] = aux_packets;
+    stats[STAT_DUAL_READER] = audio_context != nullptr;
+    stats[STAT_INTERRUPTED_READS] = interrupted_reads;
+    stats[STAT_LAST_TEARDOWN_US] = last_teardown_time;
+    stats[STAT_LIVE_LATENCY_US] = live_latency;
+    stats[STAT_LIVE_DROPS] = live_drops;
+    stats[STAT_LIVE_SPEEDUPS] = live_speedups;
+    stats[STAT_BUFFERING_COUNT] = buffering_count;
+    stats[STAT_BUFFERING_US] = buffering_time;
+    stats[STAT_RECONNECTS] = reconnects;
+    stats[STAT_RECONNECT_ATTEMPTS] = reconnect_attempts;
+    stats[STAT_LAST_OUTAGE_US] = last_outage_time;
+    stats[STAT_OUTAGE_US] = outage_time;
+    pthread_mutex_lock(&record_mutex);
+    if (recorder) {
+        stats[STAT_RECORD_PACKETS] = recorder->queued_packets;
+        stats[STAT_RECORD_BYTES] = recorder->written_bytes;
+        stats[STAT_RECORD_COPIED_BYTES] = recorder->copied_bytes;
+        stats[STAT_RECORD_QUEUE_PEAK] = recorder->peak_queue;
+        stats[STAT_RECORD_DROPPED] = recorder->dropped_packets;
+    }
+    pthread_mutex_unlock(&record_mutex);
+    pthread_mutex_lock(&stats_mutex);
+    if (time_shift) {
+        stats[STAT_TIME_SHIFT_MEMORY_BYTES] = time_shift->memory_bytes;
+        stats[STAT_TIME_SHIFT_PEAK_MEMORY_BYTES] = time_shift->peak_memory_bytes;
+        stats[STAT_TIME_SHIFT_DISK_BYTES] = time_shift->disk_bytes;
+        stats[STAT_TIME_SHIFT_SPAN_US] = time_shift_span;
+        stats[STAT_TIME_SHIFT_DELAY_US] = time_shift_delay;
+    }
+    if (abr) { // 计数只在解封装线程中修改，这里读到的可能是旧值，不影响统计
+        stats[STAT_ABR_VARIANTS] = abr->count();
+        stats[STAT_ABR_BITRATE] = abr->currentVariant().bitrate;
+        stats[STAT_ABR_THROUGHPUT] = abr->currentThroughput();
+        stats[STAT_ABR_SWITCHES] = abr->switches;
+    }
+    if (file_io) {
+        file_io->fetchStats(stats);
+    }
+    pthread_mutex_unlock(&stats_mutex);
+    stats[STAT_SEEK_COUNT] = seek_count;
+    stats[STAT_SEEK_COALESCED] = seek_coalesced;
+    // seek到第一帧画面的耗时，没有视频时取第一段声音
+    BaseChannel *first_channel = video_channel ? (BaseChannel *) video_channel : audio_channel;
+    if (first_channel) {
+        stats[STAT_SEEK_FIRST_FRAME_US] = first_channel->seek_latency;
+        stats[STAT_SEEK_CATCHUP_US] = first_channel->catchup_time;
+        stats[STAT_SEEK_CATCHUP_FRAMES] = first_channel->catchup_discarded;
+    }
+    if (video_channel) {
+        int64_t frame_cpu_time = video_channel->frameCpuTime();
+        stats[STAT_BACKGROUND_DROPPED_PACKETS] = video_channel->background_dropped_packets;
+        stats[STAT_BACKGROUND_DROPPED_BYTES] = video_channel->background_dropped_bytes;
+        stats[STAT_BACKGROUND_SAVED_CPU_US] = video_channel->background_dropped_packets * frame_cpu_time;
+        stats[STAT_VIDEO_FRAME_CPU_US] = frame_cpu_time;
+        stats[STAT_STALE_DROPPED] += video_channel->stale_dropped;
+        stats[STAT_FIRST_VIDEO_FRAME_US] = video_channel->first_frame_time;
+        stats[STAT_VIDEO_PEAK_PACKETS] = video_channel->peak_packets;
+    }
+    if (audio_channel) {
+        stats[STAT_STALE_DROPPED] += audio_channel->stale_dropped;
+        stats[STAT_FIRST_AUDIO_US] = audio_channel->first_audio_time;
+        stats[STAT_AUDIO_PEAK_PACKETS] = audio_channel->peak_packets;
+    }
+    if (keyframe_index) {
+        stats[STAT_KEYFRAME_INDEX_ENTRIES] = keyframe_index->count();
+        stats[STAT_KEYFRAME_INDEX_SEEKS] = keyframe_index->seek_hits;
+    }
 }
 
 int VideoPlayer::fetch_duration() {
     return this->duration;
 }
 
-void VideoPlayer::seek(int process) {
+/**
+ * 运行在主线程，只记录seek的目标和模式（SEEK_MODE_XXX），由解封装线程执行。
+ *
+ * av_seek_frame 和 av_read_frame 都会操作formatContext，不能在两个线程中同时调用；
+ * 网络流的seek可能阻塞数秒，也不能在主线程中执行。
+ * 连续拖动拖动条时，还没有执行的seek会被最新的目标覆盖（合并），只执行最后一次。
+ */
+void VideoPlayer::seek(int process, int mode) {
 
     if (process < 0 || process > duration) {
         return;
@@ -317,49 +1597,112 @@ void VideoPlayer::seek(int process) {
     }
 
     pthread_mutex_lock(&seek_mutex);
+    if (seek_pending) {
+        seek_coalesced++; // 上一次seek还没有执行，直接被覆盖
+    }
+    seek_target = process;
+    seek_mode = mode;
+    seek_pending = true;
+    seek_request_time = av_gettime_relative();
+    pthread_cond_broadcast(&demux_cond); // 唤醒可能在结尾处等待的解封装线程
+    pthread_mutex_unlock(&seek_mutex);
+}
+
+/**
+ * 运行在解封装线程，执行最近一次的seek请求。
+ */
+void VideoPlayer::seek_() {
+    pthread_mutex_lock(&seek_mutex);
+    int process = seek_target;
+    int mode = seek_mode;
+    int64_t request_time = seek_request_time;
+    seek_pending = false;
+    pthread_mutex_unlock(&seek_mutex);
 
-    LOGD("获取锁，进入线程")
+    int64_t target = (int64_t) process * AV_TIME_BASE; // 单位微秒
 
     /**
      * 参数：
-     * formatContext    涉及到多线程，需要考虑线程安全。av_seek_frame会对context的成员进行操作。
-     * stream_index     默认为-1，ffmpeg自动选择对音频还是视频进行seek。
+     * formatContext    只在解封装线程中使用，与av_read_frame不会并发。
+     * stream_index     默认为-1，ffmpeg自动选择对音频还是视频进行seek，时间戳的单位为AV_TIME_BASE。
      * timestamp        seek的进度，单位:时间基。
      * flag             有几个类型：
      *                      AVSEEK_FLAG_ANY      一定会播放seek后的进度，但是该包并不一定是I帧，所以可能会出现花屏。一般与 AVSEEK_FLAG_FRAME 配合使用.
      *                      AVSEEK_FLAG_FRAME    找关键帧，但可能间隔过大。（当前seek的位置的包为B帧，但距离I帧有30帧，那么一旦跳到该I帧，那么画面就会出现与拖动的位置不符）
-     *                      AVSEEK_FLAG_BACKWARD 向后参考，如果seek后的包不是I帧，那么会向后寻找最近的I帧播放（若找不到会花屏）。
+     *                      AVSEEK_FLAG_BACKWARD 向后参考，跳到目标之前（含）最近的关键帧。
+     *
+     * 两种模式都跳到目标之前最近的关键帧，保证解码器从关键帧开始，不会花屏。
+     * 精确seek再由解码线程把关键帧到目标之间的帧解码后丢弃（不转换、不渲染），从目标开始播放。
      */
-    int result = av_seek_frame(formatContext, -1, process * AV_TIME_BASE,
-                               AVSEEK_FLAG_FRAME);
+    int result = -1;
+    KeyframeIndex::Entry entry;
+    if (keyframe_index && keyframe_index->lookup(target, &entry)) {
+        // 索引中有目标之前最近的关键帧，直接按字节偏移跳过去，不需要容器查找或扫描。
+        result = av_seek_frame(formatContext, -1, entry.pos, AVSEEK_FLAG_BYTE);
+        if (result >= 0) {
+            keyframe_index->seek_hits++;
+        }
+    }
+    if (result < 0) {
+        result = av_seek_frame(formatContext, -1, target, AVSEEK_FLAG_BACKWARD);
+    }
+    if (result >= 0 && keyframe_index) {
+        keyframe_index->onSeek();
+    }
+    if (result >= 0) {
+        // 辅助读取器的位置已经没有意义，之后需要时重新打开。
+        closeAuxiliary();
+        aux_channel = nullptr;
+
+        // 录制的时间戳不能后退，seek之后的第一个关键帧处结束录制
+        pthread_mutex_lock(&record_mutex);
+        if (recorder) {
+            recorder->requestStop();
+        }
+        pthread_mutex_unlock(&record_mutex);
+    }
 
-    LOGD("before packets size = %d, frames size = %d \n", video_channel->packets.size(), video_channel->frames.size())
     if (result >= 0) {
-        // 音视频正在播放，用户seek。应该停掉播放的数据，把队列停掉。
-        if (audio_channel) {
-            audio_channel->packets.working(false);
-            audio_channel->frames.working(false);
-            audio_channel->packets.clear();
-            audio_channel->frames.clear();
-            audio_channel->packets.working(true); // 清除后继续工作
-            audio_channel->frames.working(true);
+        // 音视频正在播放，用户seek。不清空队列，也不停止解码和播放线程：
+        // 每个通道开始新的播放代数，之后读取的压缩包带上新的代数，队列中之前代数的数据在取出时被丢弃。
+        if (audio_channel && audio_context) {
+            // 双读取器：音频由自己的解封装线程seek并开始新的代数。
+            pthread_mutex_lock(&seek_mutex);
+            audio_seek_target = target;
+            audio_seek_mode = mode;
+            audio_seek_request_time = request_time;
+            audio_seek_pending = true;
+            pthread_cond_broadcast(&demux_cond);
+            pthread_mutex_unlock(&seek_mutex);
+        } else if (audio_channel) {
+            audio_channel->seek_request_time = request_time;
+            audio_channel->startSeek(mode == SEEK_MODE_ACCURATE ? target : AV_NOPTS_VALUE);
         }
 
         if (video_channel) {
-            video_channel->packets.working(false);
-            video_channel->frames.working(false);
-            video_channel->packets.clear();
-            video_channel->frames.clear();
-            video_channel->packets.working(true); // 清除后继续工作
-            video_channel->frames.working(true);
+            video_channel->seek_request_time = request_time;
+            video_channel->startSeek(mode == SEEK_MODE_ACCURATE ? target : AV_NOPTS_VALUE);
         }
 
-        LOGD("after packets size = %d, frames size = %d \n", video_channel->packets.size(), video_channel->frames.size())
+        pthread_mutex_lock(&seek_mutex);
+        // 如果已经读到结尾，从新的位置继续读取，并重新等待播放完成。
+        if (audio_channel && !audio_context) {
+            audio_channel->finished = false;
+        }
+        if (video_channel) {
+            video_channel->finished = false;
+        }
+        completed_notified = false;
+        read_eof = false;
+        seek_count++;
+        pthread_mutex_unlock(&seek_mutex);
     }
-    LOGD("锁，seek结束.result = %d\n", result)
-    pthread_mutex_unlock(&seek_mutex);
+    LOGD("seek结束.process = %d, mode = %d, result = %d, 耗时 %lld ms\n", process, mode,
+         result, (long long) (av_gettime_relative() - request_time) / 1000)
 
-    LOGD("释放锁，结束线程")
+    if (this->helper) {
+        this->helper->onSeekCompleted(THREAD_CHILD, result >= 0 ? process : -1);
+    }
 }
 
 void *task_stop(void *args) {
@@ -370,6 +1713,10 @@ void *task_stop(void *args) {
 
 void VideoPlayer::stop() {
 
+    // 先让阻塞在打开、读取中的IO立即返回，stop_中等待解封装线程时不需要等到网络超时。
+    stop_request_time = av_gettime_relative();
+    abort_request = true;
+
     helper = nullptr;
 
     if (audio_channel) {
@@ -383,12 +1730,52 @@ void VideoPlayer::stop() {
 }
 
 void VideoPlayer::stop_(VideoPlayer *player) {
+    // 唤醒可能在等待seek的解封装线程。
+    pthread_mutex_lock(&seek_mutex);
     is_playing = false;
+    pthread_cond_broadcast(&demux_cond);
+    pthread_mutex_unlock(&seek_mutex);
 
     // 让该子线程与pid_prepare和pid_start形成非分离线程。
     pthread_join(pid_prepare, nullptr);
     pthread_join(pid_start, nullptr);
 
+    if (audio_context) {
+        pthread_join(pid_audio_demux, nullptr);
+    }
+    last_teardown_time = av_gettime_relative() - stop_request_time;
+    LOGD("停止：解封装线程全部退出，耗时 %lld ms\n", (long long) last_teardown_time / 1000)
+
+    closeAuxiliary();
+    pthread_mutex_lock(&stats_mutex);
+    DELETE(abr)
+    DELETE(time_shift)
+    pthread_mutex_unlock(&stats_mutex);
+
+    // 解封装线程已经结束，不会再有新的包，写完队列中的包后关闭录制的文件
+    pthread_mutex_lock(&record_mutex);
+    DELETE(recorder)
+    pthread_mutex_unlock(&record_mutex);
+    if (audio_context) {
+        avformat_close_input(&audio_context);
+        audio_context = nullptr;
+        DELETE(audio_io)
+    }
+
+    // 解封装线程结束后，保存本次播放建立的关键帧索引。
+    if (keyframe_index) {
+        keyframe_index->save();
+        DELETE(keyframe_index)
+    }
+
+    // 解封装线程结束后，再停止各个通道的解码和播放线程。
+    if (video_channel) {
+        video_channel->stop();
+    }
+    if (audio_channel) {
+        audio_channel->stop();
+    }
+
     if (formatContext) {
         avformat_close_input(&formatContext);
         avformat_free_context(formatContext);
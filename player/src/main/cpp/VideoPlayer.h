@@ -2,10 +2,20 @@
 #define VIDEOPLAYER_VIDEOPLAYER_H
 
 #include <cstring>
+#include <vector>
 #include <pthread.h>
 #include "AudioChannel.h"
 #include "VideoChannel.h"
 #include "JNICallbackHelper.h"
+#include "PlayerStats.h"
+#include "KeyframeIndex.h"
+#include "MediaInfoCache.h"
+#include "LocalFileIO.h"
+#include "HttpCacheIO.h"
+#include "MemoryIO.h"
+#include "AbrController.h"
+#include "TimeShiftBuffer.h"
+#include "Recorder.h"
 #include "util.h"
 #include "Log.h"
 
@@ -14,6 +24,21 @@ extern "C" {
 #include <libavutil/time.h>
 }
 
+#define SEEK_MODE_FAST 0 // 快速seek：跳到目标之前最近的关键帧直接播放，用于拖动中的预览
+#define SEEK_MODE_ACCURATE 1 // 精确seek：跳到目标之前最近的关键帧，解码并丢弃目标之前的帧，从目标开始播放
+
+#define BUFFER_LOW_WATERMARK 0.5 // 网络流超前播放位置的数据少于该时长时进入缓冲，暂停播放，单位秒
+#define BUFFER_HIGH_WATERMARK 3.0 // 缓冲中超前的数据达到该时长（或者队列已满、读到结尾）时恢复播放，单位秒
+
+#define RECONNECT_DELAY_MIN 500000 // 直播断开后第一次重连的等待时长，之后每次加倍，单位微秒
+#define RECONNECT_DELAY_MAX 8000000 // 重连等待时长的上限，单位微秒
+
+#define LIVE_LATENCY_DEFAULT 1500 // 直播默认的目标延时，单位毫秒
+#define LIVE_SPEEDUP_MARGIN 200000 // 直播延时超过目标该值时加快播放，回到目标以内恢复，单位微秒
+#define LIVE_DROP_MARGIN 1000000 // 直播延时超过目标该值时丢弃缓存，跳到下一个关键帧，单位微秒
+#define LIVE_DROP_COOLDOWN 2000000 // 丢弃缓存后等待该时长再重新判断（等待新的数据开始播放），单位微秒
+
+#define TIME_SHIFT_MEMORY_DEFAULT (32 * 1024 * 1024) // 直播时移缓存默认的内存上限，单位字节
 
 class VideoPlayer {
 
@@ -22,15 +47,107 @@ private:
     pthread_t pid_prepare;
     pthread_t pid_start;
     pthread_t pid_stop;
+    pthread_t pid_audio_demux;
     AudioChannel *audio_channel = 0;
     VideoChannel *video_channel = 0;
     JNICallbackHelper *helper = 0;
     bool is_playing = false; // 是否播放
+    volatile bool abort_request = false; // 是否已经请求停止，阻塞中的IO通过中断回调立即返回
+    int64_t stop_request_time = 0; // 调用stop的时间，单位微秒
+    int64_t interrupted_reads = 0; // 因为停止或者新的seek而中断的读取次数
+    static int64_t last_teardown_time; // 最近一次停止（从调用stop到解封装线程全部退出）的耗时，单位微秒
     RenderCallback renderCallback;
+    void *render_args = 0; // 给renderCallback的参数
     int duration; // 视频总时长
 
     pthread_mutex_t seek_mutex; // 改变进度的锁
+    pthread_cond_t demux_cond; // 读到结尾后，解封装线程在此等待seek或停止
+    bool read_eof = false; // 是否已经读到结尾（结束标记已放入队列）
+    bool completed_notified = false; // 是否已经通知过播放完成
+
+    volatile bool seek_pending = false; // 是否有等待解封装线程执行的seek
+    int seek_target = 0; // 最近一次seek的目标，单位秒
+    int seek_mode = SEEK_MODE_FAST; // 最近一次seek的模式
+    int64_t seek_request_time = 0; // 最近一次seek请求的时间，单位微秒
+    int64_t seek_count = 0; // 执行的seek次数
+    int64_t seek_coalesced = 0; // 被后来的seek覆盖、没有执行的seek次数
     AVCodecContext *codecContext = nullptr;
+    KeyframeIndex *keyframe_index = 0; // 视频流的关键帧索引，只有支持按字节seek的本地文件才有
+    bool media_info_cached = false; // prepare时是否使用了媒体信息缓存（跳过了流信息探测）
+    int64_t prepare_time = 0; // prepare的耗时，单位微秒
+    int64_t open_time = 0; // prepare中打开媒体（avformat_open_input）的耗时，单位微秒
+    int64_t probe_time = 0; // prepare中探测流信息的耗时，单位微秒
+    bool fast_start = false; // 快速启动：限制流信息的探测，尽快开始播放
+    MediaIO *file_io = 0; // 自定义读取：本地文件的映射读取，或者http的磁盘缓存；为空时使用ffmpeg默认的协议
+    std::vector<BaseChannel *> stream_channels; // 压缩包分发表，下标为流的下标，不播放的流为空
+    int64_t discarded_packets = 0; // 不属于任何通道而丢弃的压缩包数量
+    int64_t discarded_bytes = 0; // 不属于任何通道而丢弃的压缩包字节数
+
+    AVFormatContext *aux_context = 0; // 辅助读取器，交错不均匀时单独读取饥饿的通道
+    MediaIO *aux_io = 0; // 辅助读取器的自定义读取
+    BaseChannel *aux_channel = 0; // 辅助读取器服务的通道，主读取器追上之前需要去掉重复的包
+    int64_t aux_last_ts = AV_NOPTS_VALUE; // 辅助读取器送出的最后一个包的时间戳（时间基）
+    bool aux_failed = false; // 辅助读取器无法使用（网络流等），不再尝试
+    int64_t aux_opens = 0; // 辅助读取器打开的次数
+    int64_t aux_packets = 0; // 辅助读取器送出的压缩包数量
+    int64_t interleave_skew_max = 0; // 观察到的最大交错不均衡（两个通道已读到的位置之差），单位微秒
+
+    bool dual_reader = false; // 双读取器：音频在同一个文件上单独解封装，与视频各自的线程、各自的读取位置
+    AVFormatContext *audio_context = 0; // 双读取器模式下音频的解封装上下文，只在音频解封装线程中使用
+    MediaIO *audio_io = 0; // 音频读取器的自定义读取
+    bool audio_read_eof = false; // 音频解封装线程是否已经读到结尾
+    volatile bool audio_seek_pending = false; // 是否有等待音频解封装线程执行的seek
+    int64_t audio_seek_target = 0; // 音频解封装线程seek的目标，单位微秒
+    int audio_seek_mode = SEEK_MODE_FAST; // 音频解封装线程seek的模式
+    int64_t audio_seek_request_time = 0; // seek请求的时间，单位微秒
+
+    bool network = false; // 是否为网络流
+    bool live = false; // 是否为直播（网络流并且没有时长）
+    int live_latency_target = LIVE_LATENCY_DEFAULT; // 直播的目标延时，单位毫秒，<= 0 表示不控制
+    int64_t live_latency = 0; // 最近测得的直播延时（已经收到的数据比正在播放的位置超前的时长），单位微秒
+    int64_t live_drop_time = 0; // 最近一次丢弃缓存追赶延时的时间，单位微秒
+    int64_t live_drops = 0; // 丢弃缓存追赶延时的次数
+    int64_t live_speedups = 0; // 加快播放追赶延时的次数
+
+    pthread_t demux_thread; // 主解封装线程，中断回调只在该线程中检查缓冲状态
+    volatile bool demux_running = false; // 主解封装线程是否已经开始
+    volatile bool buffering = false; // 是否正在缓冲（播放暂停，等待数据）
+    bool buffering_notify_pending = false; // 中断回调中改变了缓冲状态，还没有通知Java（只在主解封装线程中使用）
+    int buffered_position = -1; // 最近通知Java的缓冲位置，单位秒
+    int64_t buffering_start_time = 0; // 本次缓冲开始的时间，单位微秒
+    int64_t buffering_count = 0; // 缓冲的次数
+    int64_t buffering_time = 0; // 缓冲的累计时长，单位微秒
+
+    int64_t outage_start_time = 0; // 直播断开的时间，重连后收到第一个压缩包时清零，单位微秒
+    int64_t reconnects = 0; // 直播重连成功的次数
+    int64_t reconnect_attempts = 0; // 直播尝试重连的次数
+    int64_t last_outage_time = 0; // 最近一次断开到重连后收到第一个压缩包的时长，单位微秒
+    int64_t outage_time = 0; // 断开的累计时长，单位微秒
+
+    AbrController *abr = 0; // HLS自适应码率，只有多码率的hls才有，只在解封装线程中使用
+    int abr_extradata_stream = -1; // 切换码率后新的音频流，第一个包需要带上新的编码参数
+
+    volatile bool paused = false; // 是否暂停
+    int time_shift_seconds = 0; // 直播时移缓存最长保存的时长，单位秒，<= 0 表示不使用
+    int64_t time_shift_memory = TIME_SHIFT_MEMORY_DEFAULT; // 直播时移缓存的内存上限，单位字节
+    int64_t time_shift_disk = 0; // 直播时移溢出文件的上限，单位字节，<= 0 表示只使用内存
+    TimeShiftBuffer *time_shift = 0; // 直播时移缓存，只在主解封装线程中使用
+    bool time_shifted = false; // 是否正在时移播放（暂停过或者回退了，播放的位置落后直播），此时不控制直播延时
+    volatile bool time_shift_pending = false; // 是否有等待解封装线程执行的时移
+    int time_shift_target = 0; // 时移的目标，落后直播的时长，单位秒，0 表示回到直播
+    volatile bool background_pending = false; // 是否有等待解封装线程执行的后台模式切换
+    bool background_request = false; // 最近一次请求的后台模式
+    int64_t time_shift_span = 0; // 时移缓存覆盖的时长，单位微秒
+    int64_t time_shift_delay = 0; // 送给通道的位置落后直播的时长，单位微秒
+
+    pthread_mutex_t record_mutex; // 录制的锁，解封装线程写入与开始、停止录制互斥
+    pthread_mutex_t stats_mutex; // 统计的锁，创建、替换和释放统计中读取的对象（file_io、abr、time_shift）与读取统计互斥
+    Recorder *recorder = 0; // 录制，为空表示没有录制过
+
+    int audio_sink_type = AUDIO_SINK_OPENSL; // 音频输出类型
+    char *audio_sink_path = 0; // 音频输出为wav时的文件路径
+    float audio_gain = 1.0f; // 音频增益
+    bool audio_mute = false; // 是否静音
 
 public:
     AVFormatContext *formatContext = 0;
@@ -45,15 +162,96 @@ public:
 
     void releaseWithFailed(int);
 
+    int openInput(AVFormatContext **context, AVInputFormat *format, AVDictionary **options, MediaIO **io);
+
+    static int openInput(const char *data_source, AVFormatContext **context, AVInputFormat *format,
+                         AVDictionary **options, MediaIO **io, int (*callback)(void *), void *opaque);
+
+    static int interrupt_callback(void *opaque);
+
+    static int abort_interrupt_callback(void *opaque);
+
+    int openSecondaryInput(AVFormatContext **context, MediaIO **io);
+
+    void setOpenOptions(AVDictionary **dictionary);
+
+    bool reconnect();
+
+    bool reopen();
+
     void start();
 
     void start_();
 
-    void setRenderCallback(RenderCallback renderCallback);
+    void sendEof();
+
+    void checkBufferLevels(BaseChannel **full_channel, BaseChannel **starving_channel);
+
+    bool openAuxiliary(BaseChannel *channel);
+
+    void closeAuxiliary();
+
+    bool isReopenable();
+
+    bool openAudioReader();
+
+    void audio_demux_();
+
+    void audio_seek_();
+
+    bool readAuxiliary(BaseChannel *channel);
+
+    void checkLiveLatency();
+
+    void checkVariant();
+
+    bool switchVariant(AVPacket *packet);
+
+    void feedTimeShift();
+
+    void timeShift_();
+
+    void updateBuffering(bool notify = true);
+
+    void setBuffering(bool buffering, bool notify);
+
+    void onChannelCompleted();
+
+    void setRenderCallback(RenderCallback renderCallback, void *args);
 
     int fetch_duration();
 
-    void seek(int);
+    void seek(int, int);
+
+    void seek_();
+
+    void setAudioSink(int type, const char *path);
+
+    void setAudioGain(float gain, bool mute);
+
+    void setFastStart(bool fast_start);
+
+    void setBackground(bool background);
+
+    void background_();
+
+    void setDualReader(bool dual_reader);
+
+    void setLiveLatency(int latency);
+
+    void setTimeShift(int seconds, int64_t memory, int64_t disk);
+
+    void timeShift(int seconds);
+
+    void pause(bool paused);
+
+    bool startRecording(const char *path);
+
+    void stopRecording();
+
+    void recordPacket(AVPacket *packet, BaseChannel *channel);
+
+    void fetch_stats(int64_t *stats);
 
     void stop();
 
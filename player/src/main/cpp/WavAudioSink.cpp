@@ -0,0 +1,68 @@
+#include <cstring>
+#include "WavAudioSink.h"
+
+WavAudioSink::WavAudioSink(const char *path) : NullAudioSink(false) {
+    this->path = new char[strlen(path) + 1];
+    strcpy(this->path, path);
+}
+
+WavAudioSink::~WavAudioSink() {
+    stop();
+    delete[] path;
+    path = nullptr;
+}
+
+/**
+ * 写入44字节的wav头（RIFF + fmt + data），小端。
+ * @param data_size PCM数据的字节数，打开时未知先写0，停止时回填。
+ */
+void WavAudioSink::writeHeader(uint32_t data_size) {
+    uint32_t byte_rate = sample_rate * channels * sample_size;
+    uint16_t block_align = channels * sample_size;
+    uint16_t bits_per_sample = sample_size * 8;
+    uint16_t audio_format = 1; // 1 表示PCM
+    uint16_t num_channels = channels;
+    uint32_t rate = sample_rate;
+    uint32_t fmt_size = 16;
+    uint32_t riff_size = 36 + data_size;
+
+    fseek(file, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&riff_size, 4, 1, file);
+    fwrite("WAVEfmt ", 1, 8, file);
+    fwrite(&fmt_size, 4, 1, file);
+    fwrite(&audio_format, 2, 1, file);
+    fwrite(&num_channels, 2, 1, file);
+    fwrite(&rate, 4, 1, file);
+    fwrite(&byte_rate, 4, 1, file);
+    fwrite(&block_align, 2, 1, file);
+    fwrite(&bits_per_sample, 2, 1, file);
+    fwrite("data", 1, 4, file);
+    fwrite(&data_size, 4, 1, file);
+}
+
+bool WavAudioSink::open(int sample_rate, int channels, int sample_size) {
+    file = fopen(path, "wb");
+    if (!file) {
+        LOGD("WavAudioSink 打开文件失败 %s\n", path)
+        return false;
+    }
+    this->sample_rate = sample_rate;
+    this->channels = channels;
+    this->sample_size = sample_size;
+    writeHeader(0);
+    return NullAudioSink::open(sample_rate, channels, sample_size);
+}
+
+void WavAudioSink::onPcm(uint8_t *data, int size) {
+    fwrite(data, 1, size, file);
+}
+
+void WavAudioSink::stop() {
+    NullAudioSink::stop(); // 先停止拉取线程，再回填文件头。
+    if (file) {
+        writeHeader(total_bytes);
+        fclose(file);
+        file = nullptr;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef VIDEOPLAYER_WAVAUDIOSINK_H
+#define VIDEOPLAYER_WAVAUDIOSINK_H
+
+#include <cstdio>
+#include "NullAudioSink.h"
+
+/**
+ * 把PCM写入wav文件，不限速。用于离线检查重采样结果，或在主机上跑音频链路。
+ */
+class WavAudioSink : public NullAudioSink {
+
+private:
+    char *path = 0;
+    FILE *file = 0;
+
+    void writeHeader(uint32_t data_size);
+
+protected:
+    void onPcm(uint8_t *data, int size) override;
+
+public:
+    explicit WavAudioSink(const char *path);
+
+    virtual ~WavAudioSink();
+
+    bool open(int sample_rate, int channels, int sample_size) override;
+
+    void stop() override;
+};
+
+#endif //VIDEOPLAYER_WAVAUDIOSINK_H
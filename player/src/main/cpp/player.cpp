@@ -2,6 +2,9 @@
 #include <string>
 #include "VideoPlayer.h"
 #include "JNICallbackHelper.h"
+#include "CacheFile.h"
+#include "ClipExporter.h"
+#include "AudioEngine.h"
 #include <android/native_window_jni.h>
 
 extern "C" JNIEXPORT jstring JNICALL
@@ -12,9 +15,18 @@ Java_com_lxc_player_NativeLib_stringFromJNI(
     return env->NewStringUTF(hello.c_str());
 }
 
-VideoPlayer *player = 0;
+/**
+ * 每个Java的VideoPlayer对应一个，地址保存在Java对象的nativeHandle中，所有实例方法都传入。
+ * 多画面时每个播放器有自己的native播放器和窗口，互不影响。
+ */
+struct PlayerContext {
+    VideoPlayer *player = 0;
+    ANativeWindow *window = 0;
+    pthread_mutex_t window_mutex = PTHREAD_MUTEX_INITIALIZER; // 渲染线程和UI线程（设置surface）同时使用窗口
+};
+
+ClipExporter *exporter = 0; // 片段导出，同时只有一个
 JavaVM *vm = 0;
-ANativeWindow *window = 0;
 
 pthread_mutex_t static_mutex = PTHREAD_MUTEX_INITIALIZER;// 静态初始化互斥锁
 
@@ -28,15 +40,42 @@ jint JNI_OnLoad(JavaVM *vm, void *args) {
     return JNI_VERSION_1_6;
 }
 
+/**
+ * 库卸载时销毁共享的OpenSL引擎（播放器释放后一直保留，供下一个播放器使用）
+ */
+void JNI_OnUnload(JavaVM *vm, void *args) {
+    AudioEngine::shutdown();
+}
+
+static VideoPlayer *playerOf(jlong handle) {
+    auto *context = reinterpret_cast<PlayerContext *>(handle);
+    return context ? context->player : nullptr;
+}
+
+/**
+ * 释放窗口（surface已经销毁或者被替换）
+ */
+static void releaseWindow(PlayerContext *context) {
+    pthread_mutex_lock(&context->window_mutex);
+    if (context->window) {
+        ANativeWindow_release(context->window);
+        context->window = nullptr;
+    }
+    pthread_mutex_unlock(&context->window_mutex);
+}
+
 /**
  * 渲染画面
+ * @param args 播放器所属的PlayerContext
  * @param src_data 渲染数据
  * @param width 数据宽
  * @param height 数据宽
  * @param src_line_size 数据大小
  */
-void renderFrame(uint8_t * src_data, int width, int height, int src_lineSize) {
-    pthread_mutex_lock(&static_mutex);
+void renderFrame(void *args, uint8_t * src_data, int width, int height, int src_lineSize) {
+    auto *context = static_cast<PlayerContext *>(args);
+    pthread_mutex_lock(&context->window_mutex);
+    ANativeWindow *window = context->window;
     if (window) {
         // 设置窗口的大小，各个属性
         ANativeWindow_setBuffersGeometry(window, width, height, WINDOW_FORMAT_RGBA_8888);
@@ -47,9 +86,9 @@ void renderFrame(uint8_t * src_data, int width, int height, int src_lineSize) {
         // 如果我在渲染的时候，是被锁住的，那我就无法渲染，我需要释放 ，防止出现死锁
         if (ANativeWindow_lock(window, &window_buffer, 0)) {
             ANativeWindow_release(window);
-            window = 0;
+            context->window = 0;
 
-            pthread_mutex_unlock(&static_mutex); // 解锁，怕出现死锁
+            pthread_mutex_unlock(&context->window_mutex); // 解锁，怕出现死锁
             return;
         }
 
@@ -64,24 +103,41 @@ void renderFrame(uint8_t * src_data, int width, int height, int src_lineSize) {
         ANativeWindow_unlockAndPost(window); // 解锁后 并且刷新 window_buffer的数据显示画面
     }
 
-    pthread_mutex_unlock(&static_mutex);
+    pthread_mutex_unlock(&context->window_mutex);
+}
+
+/**
+ * 创建播放器的native状态，返回的地址保存在Java对象的nativeHandle中，releaseNative时释放
+ */
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_lxc_player_VideoPlayer_createNative(JNIEnv *env, jobject thiz) {
+    return reinterpret_cast<jlong>(new PlayerContext());
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_lxc_player_VideoPlayer_prepareNative(JNIEnv *env, jobject thiz, jstring data_source) {
+Java_com_lxc_player_VideoPlayer_prepareNative(JNIEnv *env, jobject thiz, jlong handle, jstring data_source,
+                                              jboolean fast_start) {
+    auto *context = reinterpret_cast<PlayerContext *>(handle);
+    if (!context) {
+        return;
+    }
+    DELETE(context->player) // 重新prepare时释放之前的播放器
     //使用new关键字创建的对象，是在堆中申请的空间。
     auto *helper = new JNICallbackHelper(vm, env, thiz);
     const char *data_source_ = env->GetStringUTFChars(data_source, 0);
-    player = new VideoPlayer(data_source_, helper);
-    player->setRenderCallback(renderFrame);
-    player->prepare();
+    context->player = new VideoPlayer(data_source_, helper);
+    context->player->setRenderCallback(renderFrame, context);
+    context->player->setFastStart(fast_start);
+    context->player->prepare();
     env->ReleaseStringUTFChars(data_source, data_source_);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_lxc_player_VideoPlayer_startNative(JNIEnv *env, jobject thiz) {
+Java_com_lxc_player_VideoPlayer_startNative(JNIEnv *env, jobject thiz, jlong handle) {
+    VideoPlayer *player = playerOf(handle);
 
     if (player) {
         player->start();
@@ -91,7 +147,8 @@ Java_com_lxc_player_VideoPlayer_startNative(JNIEnv *env, jobject thiz) {
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_lxc_player_VideoPlayer_stopNative(JNIEnv *env, jobject thiz) {
+Java_com_lxc_player_VideoPlayer_stopNative(JNIEnv *env, jobject thiz, jlong handle) {
+    VideoPlayer *player = playerOf(handle);
     if(player) {
         player->stop();
     }
@@ -99,17 +156,17 @@ Java_com_lxc_player_VideoPlayer_stopNative(JNIEnv *env, jobject thiz) {
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_lxc_player_VideoPlayer_releaseNative(JNIEnv *env, jobject thiz) {
-    pthread_mutex_lock(&static_mutex);
-    if (window) {
-        ANativeWindow_release(window);
-        window = nullptr;
+Java_com_lxc_player_VideoPlayer_releaseNative(JNIEnv *env, jobject thiz, jlong handle) {
+    auto *context = reinterpret_cast<PlayerContext *>(handle);
+    if (!context) {
+        return;
     }
-    pthread_mutex_unlock(&static_mutex);
-
-    // 释放资源
-    DELETE(player)
-    DELETE(vm)
+    // 释放资源。先释放播放器（等待渲染线程退出），再释放窗口。
+    // vm属于虚拟机，整个进程共用，不能释放：解封装线程、内存来源的释放回调在之后还会用到
+    DELETE(context->player)
+    releaseWindow(context);
+    pthread_mutex_destroy(&context->window_mutex);
+    delete context;
 }
 
 /**
@@ -117,16 +174,20 @@ Java_com_lxc_player_VideoPlayer_releaseNative(JNIEnv *env, jobject thiz) {
  */
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_lxc_player_VideoPlayer_setSurfaceNative(JNIEnv *env, jobject thiz, jobject surface) {
-    pthread_mutex_lock(&static_mutex);
+Java_com_lxc_player_VideoPlayer_setSurfaceNative(JNIEnv *env, jobject thiz, jlong handle, jobject surface) {
+    auto *context = reinterpret_cast<PlayerContext *>(handle);
+    if (!context) {
+        return;
+    }
+    pthread_mutex_lock(&context->window_mutex);
     // 需要检测上次的surface是否存在，存在需要清除之前的surface窗口。
-    if (window) {
-        ANativeWindow_release(window);
-        window = nullptr;
+    if (context->window) {
+        ANativeWindow_release(context->window);
+        context->window = nullptr;
     }
     // 创建新的窗口
-    window = ANativeWindow_fromSurface(env, surface);
-    pthread_mutex_unlock(&static_mutex);
+    context->window = ANativeWindow_fromSurface(env, surface);
+    pthread_mutex_unlock(&context->window_mutex);
 }
 
 /**
@@ -134,7 +195,8 @@ Java_com_lxc_player_VideoPlayer_setSurfaceNative(JNIEnv *env, jobject thiz, jobj
  */
 extern "C"
 JNIEXPORT jint JNICALL
-Java_com_lxc_player_VideoPlayer_fetchDurationNative(JNIEnv *env, jobject thiz) {
+Java_com_lxc_player_VideoPlayer_fetchDurationNative(JNIEnv *env, jobject thiz, jlong handle) {
+    VideoPlayer *player = playerOf(handle);
     if(player) {
         return player->fetch_duration();
     }
@@ -142,8 +204,368 @@ Java_com_lxc_player_VideoPlayer_fetchDurationNative(JNIEnv *env, jobject thiz) {
 }
 extern "C"
 JNIEXPORT void JNICALL
-Java_com_lxc_player_VideoPlayer_seekNative(JNIEnv *env, jobject thiz, jint audio_time) {
+Java_com_lxc_player_VideoPlayer_seekNative(JNIEnv *env, jobject thiz, jlong handle, jint audio_time, jint mode) {
+    VideoPlayer *player = playerOf(handle);
     if(player) {
-        player->seek(audio_time);
+        player->seek(audio_time, mode);
+    }
+}
+
+/**
+ * 设置音频输出，在startNative之前调用
+ * @param type AUDIO_SINK_XXX
+ * @param path AUDIO_SINK_WAV 时的文件路径
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_setAudioSinkNative(JNIEnv *env, jobject thiz, jlong handle, jint type,
+                                                   jstring path) {
+    VideoPlayer *player = playerOf(handle);
+    if (!player) {
+        return;
+    }
+    if (!path) {
+        player->setAudioSink(type, nullptr);
+        return;
+    }
+    const char *path_ = env->GetStringUTFChars(path, 0);
+    player->setAudioSink(type, path_);
+    env->ReleaseStringUTFChars(path, path_);
+}
+
+/**
+ * 设置增益和静音（混音器输出时生效）
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_setAudioGainNative(JNIEnv *env, jobject thiz, jlong handle, jfloat gain,
+                                                   jboolean mute) {
+    VideoPlayer *player = playerOf(handle);
+    if (player) {
+        player->setAudioGain(gain, mute);
+    }
+}
+
+/**
+ * 设置后台模式。surface销毁时进入后台，只播放音频；surface重新创建后恢复视频。
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_setBackgroundNative(JNIEnv *env, jobject thiz, jlong handle, jboolean background) {
+    auto *context = reinterpret_cast<PlayerContext *>(handle);
+    if (!context) {
+        return;
+    }
+    if (background) {
+        // surface已经销毁，窗口不能再使用。
+        releaseWindow(context);
+    }
+    if (context->player) {
+        context->player->setBackground(background);
+    }
+}
+
+/**
+ * 设置双读取器，在startNative之前调用
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_setDualReaderNative(JNIEnv *env, jobject thiz, jlong handle, jboolean dual_reader) {
+    VideoPlayer *player = playerOf(handle);
+    if (player) {
+        player->setDualReader(dual_reader);
+    }
+}
+
+/**
+ * 设置直播的目标延时（毫秒），在startNative之前调用
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_setLiveLatencyNative(JNIEnv *env, jobject thiz, jlong handle, jint latency) {
+    VideoPlayer *player = playerOf(handle);
+    if (player) {
+        player->setLiveLatency(latency);
+    }
+}
+
+/**
+ * 设置直播时移，在startNative之前调用
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_setTimeShiftNative(JNIEnv *env, jobject thiz, jlong handle, jint seconds,
+                                                   jlong max_memory, jlong max_disk) {
+    VideoPlayer *player = playerOf(handle);
+    if (player) {
+        player->setTimeShift(seconds, max_memory, max_disk);
+    }
+}
+
+/**
+ * 直播时移到落后直播的某个位置（秒），0 表示回到直播
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_timeShiftNative(JNIEnv *env, jobject thiz, jlong handle, jint seconds) {
+    VideoPlayer *player = playerOf(handle);
+    if (player) {
+        player->timeShift(seconds);
+    }
+}
+
+/**
+ * 暂停或者继续播放
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_pauseNative(JNIEnv *env, jobject thiz, jlong handle, jboolean paused) {
+    VideoPlayer *player = playerOf(handle);
+    if (player) {
+        player->pause(paused);
+    }
+}
+
+/**
+ * 开始录制正在播放的流
+ */
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_lxc_player_VideoPlayer_startRecordingNative(JNIEnv *env, jobject thiz, jlong handle, jstring path) {
+    VideoPlayer *player = playerOf(handle);
+    if (!player || !path) {
+        return false;
+    }
+    const char *path_ = env->GetStringUTFChars(path, 0);
+    bool result = player->startRecording(path_);
+    env->ReleaseStringUTFChars(path, path_);
+    return result;
+}
+
+/**
+ * 停止录制
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_stopRecordingNative(JNIEnv *env, jobject thiz, jlong handle) {
+    VideoPlayer *player = playerOf(handle);
+    if (player) {
+        player->stopRecording();
+    }
+}
+
+/**
+ * 替换当前的导出，释放之前的导出（没有结束时先取消）。
+ * 在锁外释放：等待的导出线程可能正在完成回调中调用导出或者取消，需要这把锁。
+ */
+void replaceExporter(ClipExporter *next) {
+    pthread_mutex_lock(&static_mutex);
+    ClipExporter *previous = exporter;
+    exporter = next;
+    pthread_mutex_unlock(&static_mutex);
+    ClipExporter::release(previous);
+}
+
+/**
+ * 导出片段，之前的导出没有结束时先取消
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_exportClipNative(JNIEnv *env, jobject thiz, jstring source, jstring output,
+                                                 jlong start_ms, jlong end_ms) {
+    replaceExporter(nullptr);
+    auto *helper = new JNICallbackHelper(vm, env, thiz);
+    const char *source_ = env->GetStringUTFChars(source, 0);
+    const char *output_ = env->GetStringUTFChars(output, 0);
+    auto *next = new ClipExporter(source_, output_, start_ms, end_ms, helper);
+    next->start();
+    replaceExporter(next);
+    env->ReleaseStringUTFChars(source, source_);
+    env->ReleaseStringUTFChars(output, output_);
+}
+
+/**
+ * 取消导出
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_cancelExportNative(JNIEnv *env, jobject thiz) {
+    replaceExporter(nullptr);
+}
+
+/**
+ * 获取播放统计，下标见 PlayerStats.h
+ */
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_lxc_player_VideoPlayer_fetchStatsNative(JNIEnv *env, jobject thiz, jlong handle) {
+    VideoPlayer *player = playerOf(handle);
+    int64_t stats[STAT_COUNT];
+    memset(stats, 0, sizeof(stats));
+    if (player) {
+        player->fetch_stats(stats);
     }
-}
\ No newline at end of file
+    jlongArray result = env->NewLongArray(STAT_COUNT);
+    env->SetLongArrayRegion(result, 0, STAT_COUNT, reinterpret_cast<const jlong *>(stats));
+    return result;
+}
+
+/**
+ * 设置缓存目录，关键帧索引、媒体信息等缓存文件保存在这里。
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_setCacheDirNative(JNIEnv *env, jclass clazz, jstring dir) {
+    const char *dir_ = env->GetStringUTFChars(dir, 0);
+    CacheFile::setDir(dir_);
+    env->ReleaseStringUTFChars(dir, dir_);
+}
+
+/**
+ * 设置网络媒体磁盘缓存的总大小上限，<= 0 表示不缓存
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_setHttpCacheSizeNative(JNIEnv *env, jclass clazz, jlong max_size) {
+    HttpCacheIO::setMaxSize(max_size);
+}
+
+static pthread_key_t attach_key;
+static pthread_once_t attach_once = PTHREAD_ONCE_INIT;
+
+/**
+ * 线程退出时分离（pthread_key的析构函数），期间被其他回调分离过时不再分离
+ */
+static void detachThread(void *env) {
+    JNIEnv *current;
+    if (vm && vm->GetEnv(reinterpret_cast<void **>(&current), JNI_VERSION_1_6) == JNI_OK) {
+        vm->DetachCurrentThread();
+    }
+}
+
+static void createAttachKey() {
+    pthread_key_create(&attach_key, detachThread);
+}
+
+/**
+ * 获取当前线程的JNIEnv。没有附加到虚拟机的线程（解封装线程等）附加后一直保持到线程退出，
+ * 每次读取不再附加和分离。
+ * @return 没有虚拟机（库还没有加载完成）或者附加失败时返回空
+ */
+static JNIEnv *threadEnv() {
+    JNIEnv *env;
+    if (!vm) {
+        return nullptr;
+    }
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        return env;
+    }
+    pthread_once(&attach_once, createAttachKey);
+    if (vm->AttachCurrentThread(&env, 0) != JNI_OK) {
+        return nullptr;
+    }
+    pthread_setspecific(attach_key, env); // 值不为空时线程退出才会调用析构函数
+    return env;
+}
+
+/**
+ * 直接缓冲区不再使用时释放它的全局引用（可能在解封装线程中调用）
+ */
+static void releaseGlobalRef(void *opaque) {
+    JNIEnv *env = threadEnv();
+    if (env) {
+        env->DeleteGlobalRef(static_cast<jobject>(opaque));
+    }
+}
+
+/**
+ * 回调来源：Java对象的全局引用和注册时查找好的 readAt 方法
+ */
+struct JavaMediaSource {
+    jobject source;
+    jmethodID read_at;
+};
+
+static void releaseMediaSource(void *opaque) {
+    auto *source = static_cast<JavaMediaSource *>(opaque);
+    JNIEnv *env = threadEnv();
+    if (env) {
+        env->DeleteGlobalRef(source->source);
+    }
+    delete source;
+}
+
+/**
+ * 回调来源：调用Java的 MediaSource.readAt，直接写入AVIOContext的缓冲区
+ */
+static int readMediaSource(void *opaque, uint8_t *buf, int size, int64_t position) {
+    auto *source = static_cast<JavaMediaSource *>(opaque);
+    JNIEnv *env = threadEnv();
+    if (!env) {
+        return -1;
+    }
+    jobject buffer = env->NewDirectByteBuffer(buf, size);
+    jint result = env->CallIntMethod(source->source, source->read_at, (jlong) position, buffer, size);
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        result = -1;
+    }
+    env->DeleteLocalRef(buffer);
+    return result;
+}
+
+/**
+ * 注册直接缓冲区作为内存来源，返回播放使用的地址
+ * @return 不是直接缓冲区、或者 [offset, offset + size) 超出缓冲区时返回空
+ */
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_lxc_player_VideoPlayer_registerBufferNative(JNIEnv *env, jclass clazz, jobject buffer, jint offset,
+                                                     jint size) {
+    auto *data = static_cast<uint8_t *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!data || offset < 0 || size <= 0 || (jlong) offset + size > capacity) {
+        return nullptr;
+    }
+    char url[64];
+    // 持有缓冲区的全局引用，播放过程中不会被回收
+    MemoryIO::registerSource(data + offset, size, nullptr, releaseGlobalRef, env->NewGlobalRef(buffer),
+                             url, sizeof(url));
+    return env->NewStringUTF(url);
+}
+
+/**
+ * 注册按位置拉取数据的回调来源，返回播放使用的地址
+ * @return 找不到方法、或者getSize抛出异常时返回空（清除异常）
+ */
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_lxc_player_VideoPlayer_registerMediaSourceNative(JNIEnv *env, jclass clazz, jobject source) {
+    jclass source_class = env->GetObjectClass(source);
+    jmethodID get_size = env->GetMethodID(source_class, "getSize", "()J");
+    jmethodID read_at = env->GetMethodID(source_class, "readAt", "(JLjava/nio/ByteBuffer;I)I");
+    env->DeleteLocalRef(source_class);
+    jlong size = get_size && read_at ? env->CallLongMethod(source, get_size) : -1;
+    if (!get_size || !read_at || env->ExceptionCheck()) {
+        env->ExceptionClear();
+        return nullptr;
+    }
+    auto *java_source = new JavaMediaSource;
+    java_source->source = env->NewGlobalRef(source);
+    java_source->read_at = read_at;
+    char url[64];
+    MemoryIO::registerSource(nullptr, size >= 0 ? size : -1, readMediaSource, releaseMediaSource,
+                             java_source, url, sizeof(url));
+    return env->NewStringUTF(url);
+}
+
+/**
+ * 取消注册内存来源
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_lxc_player_VideoPlayer_unregisterMemorySourceNative(JNIEnv *env, jclass clazz, jstring url) {
+    const char *url_ = env->GetStringUTFChars(url, 0);
+    MemoryIO::unregisterSource(url_);
+    env->ReleaseStringUTFChars(url, url_);
+}
@@ -4,6 +4,27 @@
 #define THREAD_MAIN 1 // 主线程
 #define THREAD_CHILD 2 // 子线程
 
+#include <time.h>
+#include <stdint.h>
+
+/**
+ * 当前线程消耗的CPU时间，单位微秒。用于统计解码/格式转换真正占用的CPU，不包含线程睡眠和等待的时间。
+ */
+static inline int64_t thread_cpu_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * 单调时钟，单位微秒，与av_gettime_relative相同。音频输出不依赖ffmpeg，可以单独在主机上编译测试。
+ */
+static inline int64_t monotonic_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 #endif //NE_PLAYER_MACRO_H
 
 // 宏函数(用来释放资源) (原理：在预编译阶段会把代码copy到项目使用的地方。)
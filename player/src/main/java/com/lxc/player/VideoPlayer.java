@@ -20,6 +20,7 @@ import android.widget.TextView;
 import androidx.annotation.NonNull;
 import androidx.annotation.Nullable;
 
+import java.nio.ByteBuffer;
 import java.nio.file.NoSuchFileException;
 
 /**
@@ -32,15 +33,92 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
 
     private final int HANDLE_STATUS_PREPARED = 1; // 视频已准备
     private final int HANDLE_STATUS_PROGRESS = 10; // 当前进度更新
+    private final int HANDLE_STATUS_BUFFERED = 11; // 缓冲位置更新
+
+    public static final int AUDIO_SINK_OPENSL = 0; // OpenSL ES 输出到声卡（默认）
+    public static final int AUDIO_SINK_NULL = 1; // 空输出，按实时速度消费，不发声
+    public static final int AUDIO_SINK_NULL_FREE_RUN = 2; // 空输出，不限速，用于测量解码+重采样吞吐
+    public static final int AUDIO_SINK_WAV = 3; // 把PCM写入wav文件
+    public static final int AUDIO_SINK_MIXER = 4; // 送入共享的软件混音器，多画面时多个播放器合并为一路输出
+
+    // 播放统计的下标，与native层 PlayerStats.h 一致
+    public static final int STAT_BACKGROUND_DROPPED_PACKETS = 0; // 后台模式下丢弃的视频压缩包数量
+    public static final int STAT_BACKGROUND_DROPPED_BYTES = 1; // 后台模式下丢弃的视频压缩包字节数
+    public static final int STAT_BACKGROUND_SAVED_CPU_US = 2; // 后台模式节省的CPU时间估算，单位微秒
+    public static final int STAT_VIDEO_FRAME_CPU_US = 3; // 平均每帧视频解码+格式转换的CPU耗时，单位微秒
+    public static final int STAT_SEEK_COUNT = 4; // 执行的seek次数
+    public static final int STAT_SEEK_COALESCED = 5; // 被后来的seek覆盖（合并）的seek次数
+    public static final int STAT_SEEK_FIRST_FRAME_US = 6; // 最近一次seek到第一帧画面的耗时，单位微秒
+    public static final int STAT_SEEK_CATCHUP_US = 7; // 最近一次精确seek从关键帧解码追赶到目标的耗时，单位微秒
+    public static final int STAT_SEEK_CATCHUP_FRAMES = 8; // 最近一次精确seek追赶过程中丢弃的帧数
+    public static final int STAT_STALE_DROPPED = 9; // seek之后在队列中丢弃的旧压缩包和解压包数量
+    public static final int STAT_KEYFRAME_INDEX_ENTRIES = 10; // 关键帧索引的条数
+    public static final int STAT_KEYFRAME_INDEX_SEEKS = 11; // 通过关键帧索引按字节偏移完成的seek次数
+    public static final int STAT_PREPARE_US = 12; // prepare的耗时，单位微秒
+    public static final int STAT_MEDIA_INFO_CACHED = 13; // prepare是否使用了媒体信息缓存（1 是，0 否）
+    public static final int STAT_PREPARE_OPEN_US = 14; // prepare中打开媒体的耗时，单位微秒
+    public static final int STAT_PREPARE_PROBE_US = 15; // prepare中探测流信息的耗时，单位微秒
+    public static final int STAT_FIRST_VIDEO_FRAME_US = 16; // 从start到第一帧画面的耗时，单位微秒
+    public static final int STAT_FIRST_AUDIO_US = 17; // 从start到第一段声音的耗时，单位微秒
+    public static final int STAT_DISCARDED_PACKETS = 18; // 不属于任何通道而丢弃的压缩包数量
+    public static final int STAT_DISCARDED_BYTES = 19; // 不属于任何通道而丢弃的压缩包字节数
+    public static final int STAT_INTERLEAVE_SKEW_US = 20; // 观察到的最大交错不均衡，单位微秒
+    public static final int STAT_AUX_READER_OPENS = 21; // 为饥饿的通道打开辅助读取器的次数
+    public static final int STAT_AUX_READER_PACKETS = 22; // 辅助读取器送出的压缩包数量
+    public static final int STAT_DUAL_READER = 23; // 是否使用了双读取器，音频和视频各自解封装（1 是，0 否）
+    public static final int STAT_VIDEO_PEAK_PACKETS = 24; // 视频压缩包队列中出现过的最多包数
+    public static final int STAT_AUDIO_PEAK_PACKETS = 25; // 音频压缩包队列中出现过的最多包数
+    public static final int STAT_IO_BYTES = 26; // 本地文件映射读取（或者内存来源）的字节数（主读取器）
+    public static final int STAT_IO_SYSCALLS = 27; // 本地文件映射读取的系统调用次数（预读）
+    public static final int STAT_IO_STALL_US = 28; // 本地文件读取等待存储（单次读取超过2ms）的累计耗时，单位微秒
+    public static final int STAT_HTTP_CACHE_HIT_BYTES = 29; // 网络媒体从磁盘缓存读取的字节数，命中率 = 命中 / (命中 + 下载)
+    public static final int STAT_HTTP_CACHE_MISS_BYTES = 30; // 网络媒体从网络下载的字节数
+    public static final int STAT_HTTP_CACHE_REQUESTS = 31; // 网络媒体向服务器发起的请求次数（打开连接和Range跳转）
+    public static final int STAT_INTERRUPTED_READS = 32; // 因为停止或者新的seek而中断的读取次数
+    public static final int STAT_LAST_TEARDOWN_US = 33; // 最近一次停止（任意播放器，从调用stop到解封装线程全部退出）的耗时，单位微秒
+    public static final int STAT_LIVE_LATENCY_US = 34; // 最近测得的直播延时（已经收到的数据比正在播放的位置超前的时长），单位微秒
+    public static final int STAT_LIVE_DROPS = 35; // 直播延时过大，丢弃缓存跳到下一个关键帧的次数
+    public static final int STAT_LIVE_SPEEDUPS = 36; // 直播延时超过目标，加快播放的次数
+    public static final int STAT_BUFFERING_COUNT = 37; // 网络流数据不足进入缓冲的次数（包括开始播放和seek之后的缓冲）
+    public static final int STAT_BUFFERING_US = 38; // 缓冲的累计时长，单位微秒
+    public static final int STAT_RECONNECTS = 39; // 直播断开后重连成功的次数
+    public static final int STAT_RECONNECT_ATTEMPTS = 40; // 直播尝试重连的次数
+    public static final int STAT_LAST_OUTAGE_US = 41; // 最近一次直播断开到重连后收到第一个压缩包的时长，单位微秒
+    public static final int STAT_OUTAGE_US = 42; // 直播断开的累计时长，单位微秒
+    public static final int STAT_ABR_VARIANTS = 43; // HLS可以切换的码率数量，0 表示不是多码率的hls
+    public static final int STAT_ABR_BITRATE = 44; // HLS当前播放的码率，单位 bit/s
+    public static final int STAT_ABR_THROUGHPUT = 45; // HLS测得的下载吞吐，单位 bit/s
+    public static final int STAT_ABR_SWITCHES = 46; // HLS切换码率的次数
+    public static final int STAT_TIME_SHIFT_MEMORY_BYTES = 47; // 直播时移缓存占用的内存，单位字节
+    public static final int STAT_TIME_SHIFT_PEAK_MEMORY_BYTES = 48; // 直播时移缓存占用内存的峰值，单位字节
+    public static final int STAT_TIME_SHIFT_DISK_BYTES = 49; // 直播时移溢出文件中的数据，单位字节
+    public static final int STAT_TIME_SHIFT_SPAN_US = 50; // 直播时移缓存覆盖的时长，单位微秒
+    public static final int STAT_TIME_SHIFT_DELAY_US = 51; // 直播时移播放的位置落后直播的时长，单位微秒
+    public static final int STAT_RECORD_PACKETS = 52; // 交给录制写入线程的压缩包数量
+    public static final int STAT_RECORD_BYTES = 53; // 录制写入文件的压缩包字节数
+    public static final int STAT_RECORD_COPIED_BYTES = 54; // 录制时拷贝的字节数（压缩包有引用计数时只增加引用，为0）
+    public static final int STAT_RECORD_QUEUE_PEAK = 55; // 录制写入队列中出现过的最多包数
+    public static final int STAT_RECORD_DROPPED = 56; // 录制写入跟不上而丢弃的压缩包数量
+    public static final int STAT_MEMORY_SOURCE_BYTES = 57; // 内存来源（memory://）的大小，数据直接从这块内存读取，不复制
+    public static final int STAT_PULL_CALLS = 58; // 回调来源调用拉取回调的次数
+    public static final int STAT_PULL_US = 59; // 回调来源拉取回调的累计耗时，单位微秒
+
+    public static final int SEEK_MODE_FAST = 0; // 快速seek：跳到目标之前最近的关键帧，用于拖动中的预览
+    public static final int SEEK_MODE_ACCURATE = 1; // 精确seek：解码并丢弃关键帧到目标之间的帧，从目标开始播放
 
     static {
         System.loadLibrary("native-lib");
     }
 
+    private long nativeHandle; // native层的播放器状态（PlayerContext），每个实例一个，release时释放
     private SurfaceHolder surfaceHolder;
 
     private OnPreparedListener onPreparedListener;
     private OnErrorListener onErrorListener;
+    private OnCompletedListener onCompletedListener;
+    private OnSeekCompletedListener onSeekCompletedListener;
+    private OnBufferingListener onBufferingListener;
+    private OnExportListener onExportListener;
 
     private Handler handler;
     private HandleMessage message;
@@ -49,6 +127,7 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
      * 媒体来源
      */
     private String dataSource;
+    private String memorySource; // 注册的内存来源地址（memory://），release时取消注册
 
     private View seekBox; // 拖动条的容器
     private SeekBar seekBar; // 拖动条
@@ -57,6 +136,15 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
 
     private int duration; // 播放总时长
 
+    private int audioSinkType = AUDIO_SINK_OPENSL; // 音频输出类型
+    private String audioSinkPath; // 音频输出为wav时的文件路径
+    private boolean fastStart; // 是否快速启动
+    private boolean dualReader; // 是否音频和视频各自解封装
+    private int liveLatency = 1500; // 直播的目标延时，单位毫秒
+    private int timeShiftSeconds; // 直播时移最长保存的时长，单位秒，0 表示不使用
+    private long timeShiftMemory; // 直播时移的内存上限，单位字节
+    private long timeShiftDisk; // 直播时移溢出文件的上限，单位字节
+
     public VideoPlayer(Context context) {
         this(context, null);
     }
@@ -89,6 +177,11 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
         surfaceHolder = surfaceView.getHolder();
         message = new HandleMessage();
         handler = new Handler(Looper.getMainLooper(), message);
+
+        nativeHandle = createNative();
+
+        // 关键帧索引、媒体信息等缓存文件保存在应用的缓存目录
+        setCacheDirNative(context.getCacheDir().getAbsolutePath());
     }
 
     /**
@@ -104,25 +197,172 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
         bindSurfaceHolder();
     }
 
+    /**
+     * 设置内存中的媒体（加密后解密到内存、打包在应用中的媒体等），不需要先写入临时文件。
+     * 播放时直接读取这块内存（position到limit之间），不复制；release之前不能修改或释放。
+     *
+     * @param buffer 直接缓冲区（ByteBuffer.allocateDirect、内存映射等）
+     */
+    public void setDataSource(ByteBuffer buffer) throws NoSuchFileException {
+        if (buffer == null || !buffer.isDirect()) {
+            throw new NoSuchFileException("buffer must be a direct ByteBuffer.");
+        }
+        unregisterMemorySource();
+        memorySource = registerBufferNative(buffer, buffer.position(), buffer.remaining());
+        if (memorySource == null) {
+            throw new NoSuchFileException("buffer range is invalid.");
+        }
+        setDataSource(memorySource);
+    }
+
+    /**
+     * 设置按位置拉取数据的媒体（分块解密、分块下载等）。readAt在native的解封装线程中调用。
+     */
+    public void setDataSource(MediaSource source) throws NoSuchFileException {
+        if (source == null) {
+            throw new NoSuchFileException("source is must not null.");
+        }
+        unregisterMemorySource();
+        memorySource = registerMediaSourceNative(source);
+        if (memorySource == null) {
+            throw new NoSuchFileException("source must implement readAt and getSize.");
+        }
+        setDataSource(memorySource);
+    }
+
+    private void unregisterMemorySource() {
+        if (memorySource != null) {
+            unregisterMemorySourceNative(memorySource);
+            memorySource = null;
+        }
+    }
+
     /**
      * 播放准备资源
      */
     public void prepare() {
-        prepareNative(dataSource);
+        if (nativeHandle == 0) {
+            nativeHandle = createNative(); // release之后重新使用
+        }
+        // 直播流默认快速启动
+        prepareNative(nativeHandle, dataSource, fastStart || dataSource.startsWith("rtmp://"));
+    }
+
+    /**
+     * 设置快速启动，在prepare之前调用。
+     * 快速启动只探测很少的数据（流的参数集）就通知准备完成，缩短直播的首帧时间，其余信息在解码时补全。
+     */
+    public void setFastStart(boolean fastStart) {
+        this.fastStart = fastStart;
+    }
+
+    /**
+     * 设置网络媒体（http/https）磁盘缓存的总大小上限，所有播放器共用，默认256MB。
+     * 缓存放在应用的缓存目录，超过上限时删除最久没有播放的地址；<= 0 表示不缓存。
+     */
+    public static void setHttpCacheSize(long maxSize) {
+        setHttpCacheSizeNative(maxSize);
+    }
+
+    /**
+     * 设置双读取器，在start之前调用，只对本地文件生效。
+     * 音频和视频在同一个文件上各自解封装，交错很差（音视频数据相隔很远）的文件不需要为了读到另一个流而缓存大量数据。
+     */
+    public void setDualReader(boolean dualReader) {
+        this.dualReader = dualReader;
+    }
+
+    /**
+     * 设置直播（没有时长的网络流）的目标延时，在start之前调用，默认1500毫秒。
+     * 网络抖动后延时超过目标时加快播放追赶，超过很多时丢弃缓存从下一个关键帧开始播放。
+     *
+     * @param latency 单位毫秒，<= 0 表示不控制延时
+     */
+    public void setLiveLatency(int latency) {
+        this.liveLatency = latency;
+    }
+
+    /**
+     * 设置直播时移，在start之前调用，只对直播生效。
+     * 保存最近一段时间的直播数据，可以暂停、回退（timeShift），再回到直播，不需要重新连接。
+     *
+     * @param maxSeconds 最长保存的时长，单位秒，0 表示不使用
+     * @param maxMemory  内存上限，单位字节，<= 0 使用默认的32MB
+     * @param maxDisk    超过内存上限的数据写入缓存目录的上限，单位字节，<= 0 表示只使用内存
+     */
+    public void setTimeShift(int maxSeconds, long maxMemory, long maxDisk) {
+        this.timeShiftSeconds = maxSeconds;
+        this.timeShiftMemory = maxMemory;
+        this.timeShiftDisk = maxDisk;
+    }
+
+    /**
+     * 直播时移：从落后直播seconds秒之前最近的关键帧开始播放
+     *
+     * @param seconds 落后直播的时长，单位秒，0 表示回到直播
+     */
+    public void timeShift(int seconds) {
+        timeShiftNative(nativeHandle, seconds);
+    }
+
+    /**
+     * 开始录制正在播放的流，不重新编码，不需要另外连接。从下一个视频关键帧开始。
+     *
+     * @param path 输出文件，按后缀选择容器（.mp4、.mkv等）
+     * @return 输出容器不支持时返回false
+     */
+    public boolean startRecording(String path) {
+        return startRecordingNative(nativeHandle, path);
+    }
+
+    /**
+     * 停止录制，在下一个视频关键帧处结束
+     */
+    public void stopRecording() {
+        stopRecordingNative(nativeHandle);
+    }
+
+    /**
+     * 暂停播放。直播设置了时移时，暂停期间的数据继续保存，继续播放时从暂停的位置开始。
+     */
+    public void pause() {
+        pauseNative(nativeHandle, true);
+    }
+
+    /**
+     * 继续播放
+     */
+    public void resume() {
+        pauseNative(nativeHandle, false);
     }
 
     /**
      * 开始播放
      */
     public void start() {
-        startNative();
+        setAudioSinkNative(nativeHandle, audioSinkType, audioSinkPath);
+        setDualReaderNative(nativeHandle, dualReader);
+        setLiveLatencyNative(nativeHandle, liveLatency);
+        setTimeShiftNative(nativeHandle, timeShiftSeconds, timeShiftMemory, timeShiftDisk);
+        startNative(nativeHandle);
+    }
+
+    /**
+     * 设置音频输出，在start之前调用
+     *
+     * @param type AUDIO_SINK_XXX
+     * @param path AUDIO_SINK_WAV 时的文件路径，其他类型传null
+     */
+    public void setAudioOutput(int type, String path) {
+        this.audioSinkType = type;
+        this.audioSinkPath = path;
     }
 
     /**
      * 停止播放
      */
     public void stop() {
-        stopNative();
+        stopNative(nativeHandle);
     }
 
     /**
@@ -130,7 +370,28 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
      */
     public void release() {
         message = null;
-        releaseNative();
+        unregisterMemorySource(); // 先取消注册，播放器关闭读取时释放来源
+        releaseNative(nativeHandle);
+        nativeHandle = 0;
+    }
+
+    /**
+     * 设置增益和静音，目前只有AUDIO_SINK_MIXER支持，用于多画面时控制每一路的声音
+     *
+     * @param gain 0.0 ~ 1.0
+     * @param mute 是否静音
+     */
+    public void setVolume(float gain, boolean mute) {
+        setAudioGainNative(nativeHandle, gain, mute);
+    }
+
+    /**
+     * 获取播放统计
+     *
+     * @return 下标见 STAT_XXX
+     */
+    public long[] getStats() {
+        return fetchStatsNative(nativeHandle);
     }
 
     /**
@@ -147,6 +408,49 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
         this.onErrorListener = onErrorListener;
     }
 
+    /**
+     * 设置播放完成监听
+     */
+    public void setOnCompletedListener(OnCompletedListener onCompletedListener) {
+        this.onCompletedListener = onCompletedListener;
+    }
+
+    /**
+     * 设置seek完成监听
+     */
+    public void setOnSeekCompletedListener(OnSeekCompletedListener onSeekCompletedListener) {
+        this.onSeekCompletedListener = onSeekCompletedListener;
+    }
+
+    /**
+     * 设置缓冲监听（网络流数据不足时暂停播放等待数据）
+     */
+    public void setOnBufferingListener(OnBufferingListener onBufferingListener) {
+        this.onBufferingListener = onBufferingListener;
+    }
+
+    /**
+     * 导出片段：把媒体中 [startMs, endMs] 之间的数据原样复制到新的文件，不重新编码，与播放互不影响。
+     * 从startMs之前（含）最近的关键帧开始，耗时与复制的数据量成正比。同时只有一个导出，新的导出会取消之前的。
+     *
+     * @param source   媒体地址
+     * @param output   输出文件，按后缀选择容器（.mp4、.mkv等）
+     * @param startMs  片段的开始，单位毫秒
+     * @param endMs    片段的结束，单位毫秒
+     * @param listener 导出的进度和结果，在导出线程中回调
+     */
+    public void exportClip(String source, String output, long startMs, long endMs, OnExportListener listener) {
+        this.onExportListener = listener;
+        exportClipNative(source, output, startMs, endMs);
+    }
+
+    /**
+     * 取消导出
+     */
+    public void cancelExport() {
+        cancelExportNative();
+    }
+
     /**
      * 与surfaceView绑定
      */
@@ -165,7 +469,7 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
         if (onPreparedListener != null) {
             onPreparedListener.onPrepared();
         }
-        duration = fetchDurationNative();
+        duration = fetchDurationNative(nativeHandle);
         Log.d(TAG, "时长= " + duration);
         sendMessage(HANDLE_STATUS_PREPARED);
     }
@@ -205,6 +509,70 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
         }
     }
 
+    /**
+     * 由Jni通过反射调用，音频和视频都播放到结尾时调用
+     */
+    private void jni_completed() {
+        Log.d(TAG, "_jni_completed");
+        if (onCompletedListener != null) {
+            onCompletedListener.onCompleted();
+        }
+    }
+
+    /**
+     * 由Jni通过反射调用，seek在native的解封装线程中执行完成时调用
+     *
+     * @param position seek后的位置（秒），失败为-1
+     */
+    private void jni_seek_completed(int position) {
+        Log.d(TAG, "_jni_seek_completed position = " + position);
+        if (onSeekCompletedListener != null) {
+            onSeekCompletedListener.onSeekCompleted(position);
+        }
+    }
+
+    /**
+     * 由Jni通过反射调用，网络流数据不足开始缓冲、缓冲足够恢复播放时调用
+     */
+    private void jni_buffering(boolean buffering) {
+        Log.d(TAG, "_jni_buffering " + buffering);
+        if (onBufferingListener != null) {
+            if (buffering) {
+                onBufferingListener.onBufferingStart();
+            } else {
+                onBufferingListener.onBufferingEnd();
+            }
+        }
+    }
+
+    /**
+     * 由Jni通过反射调用，网络流已经读到的位置（秒）改变时调用
+     */
+    private void jni_buffered_position(int position) {
+        sendMessage(HANDLE_STATUS_BUFFERED, position);
+    }
+
+    /**
+     * 由Jni通过反射调用，片段导出的进度（百分比）改变时调用
+     */
+    private void jni_export_progress(int percent) {
+        if (onExportListener != null) {
+            onExportListener.onExportProgress(percent);
+        }
+    }
+
+    /**
+     * 由Jni通过反射调用，片段导出结束时调用
+     *
+     * @param result 0 表示成功，否则为ffmpeg的错误码
+     */
+    private void jni_export_completed(int result) {
+        Log.d(TAG, "_jni_export_completed result = " + result);
+        if (onExportListener != null) {
+            onExportListener.onExportCompleted(result);
+        }
+    }
+
     public interface OnPreparedListener {
         void onPrepared();
     }
@@ -213,6 +581,44 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
         void onError(String msg);
     }
 
+    public interface OnCompletedListener {
+        void onCompleted();
+    }
+
+    public interface OnSeekCompletedListener {
+        void onSeekCompleted(int position);
+    }
+
+    public interface OnBufferingListener {
+        void onBufferingStart();
+
+        void onBufferingEnd();
+    }
+
+    /**
+     * 按位置拉取数据的媒体来源
+     */
+    public interface MediaSource {
+        /**
+         * 从position开始读取最多size字节，写入buffer（直接缓冲区，从0开始写）。
+         * 辅助读取器等可能在不同的线程中按不同的位置同时读取。
+         *
+         * @return 读到的字节数，结尾返回-1
+         */
+        int readAt(long position, ByteBuffer buffer, int size);
+
+        /**
+         * @return 数据的大小，不知道时返回-1
+         */
+        long getSize();
+    }
+
+    public interface OnExportListener {
+        void onExportProgress(int percent);
+
+        void onExportCompleted(int result);
+    }
+
     @Override
     public void surfaceCreated(@NonNull SurfaceHolder holder) {
 
@@ -220,12 +626,14 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
 
     @Override
     public void surfaceChanged(@NonNull SurfaceHolder holder, int format, int width, int height) {
-        setSurfaceNative(holder.getSurface());
+        setSurfaceNative(nativeHandle, holder.getSurface());
+        setBackgroundNative(nativeHandle, false);
     }
 
     @Override
     public void surfaceDestroyed(@NonNull SurfaceHolder holder) {
-
+        // 没有surface时进入后台模式，只播放音频，停止视频解码。
+        setBackgroundNative(nativeHandle, true);
     }
 
     /**
@@ -239,6 +647,10 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
     public void onProgressChanged(SeekBar seekBar, int progress, boolean fromUser) {
         if (fromUser) {
             sendMessage(HANDLE_STATUS_PROGRESS, progress);
+            if (dragged) {
+                // 拖动中使用快速seek预览画面，native层会合并连续的seek，只执行最新的一次。
+                seekNative(nativeHandle, progress, SEEK_MODE_FAST);
+            }
         }
     }
 
@@ -258,7 +670,7 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
         dragged = false;
         int audioTime = seekBar.getProgress(); // 获取抬起时的起始播放位置（时间戳）
         Log.d(TAG, "onStopTrackingTouch audioTime = " + audioTime);
-        seekNative(audioTime);
+        seekNative(nativeHandle, audioTime, SEEK_MODE_ACCURATE);
     }
 
     private void sendMessage(int what) {
@@ -297,22 +709,64 @@ public class VideoPlayer extends LinearLayout implements SurfaceHolder.Callback,
                     timeView.setText(prepareTime);
                     seekBar.setProgress(audioTime, true);
                 }
+            } else if (what == HANDLE_STATUS_BUFFERED) {
+                if (msg.obj instanceof Integer) {
+                    seekBar.setSecondaryProgress((int) msg.obj);
+                }
             }
             return false;
         }
     }
 
-    private native void prepareNative(String dataSource);
+    private native long createNative();
+
+    private native void prepareNative(long handle, String dataSource, boolean fastStart);
+
+    private native void startNative(long handle);
+
+    private native void stopNative(long handle);
+
+    private native void releaseNative(long handle);
+
+    private native void setSurfaceNative(long handle, Surface surface);
+
+    private native int fetchDurationNative(long handle);
+
+    private native void seekNative(long handle, int audioTime, int mode);
+
+    private native void setAudioSinkNative(long handle, int type, String path);
+
+    private native void setAudioGainNative(long handle, float gain, boolean mute);
+
+    private native void setBackgroundNative(long handle, boolean background);
+
+    private native void setDualReaderNative(long handle, boolean dualReader);
+
+    private native void setLiveLatencyNative(long handle, int latency);
+
+    private native void setTimeShiftNative(long handle, int seconds, long maxMemory, long maxDisk);
+
+    private native void timeShiftNative(long handle, int seconds);
+
+    private native void pauseNative(long handle, boolean paused);
+
+    private native boolean startRecordingNative(long handle, String path);
+
+    private native void stopRecordingNative(long handle);
+
+    private native void exportClipNative(String source, String output, long startMs, long endMs);
+
+    private native void cancelExportNative();
 
-    private native void startNative();
+    private native long[] fetchStatsNative(long handle);
 
-    private native void stopNative();
+    private static native void setCacheDirNative(String dir);
 
-    private native void releaseNative();
+    private static native void setHttpCacheSizeNative(long maxSize);
 
-    private native void setSurfaceNative(Surface surface);
+    private static native String registerBufferNative(ByteBuffer buffer, int offset, int size);
 
-    private native int fetchDurationNative();
+    private static native String registerMediaSourceNative(MediaSource source);
 
-    private native void seekNative(int audioTime);
+    private static native void unregisterMemorySourceNative(String url);
 }
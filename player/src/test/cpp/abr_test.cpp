@@ -0,0 +1,131 @@
+/**
+ * HLS自适应码率的主机测试：手工构造hls解封装器输出的上下文（每个码率一个节目，节目的元数据中带 variant_bitrate），
+ * 用 onRead 模拟不同的下载吞吐，检查码率的选择、缓存不足时不向上切换、缓存告急时立即向下切换和切换间隔。
+ */
+#include <cstdio>
+#include "AbrController.h"
+#include "test_util.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+static AVStream *newStream(AVFormatContext *context, AVMediaType type, AVCodecID codec_id, AVRational time_base) {
+    AVStream *stream = avformat_new_stream(context, nullptr);
+    stream->codecpar->codec_type = type;
+    stream->codecpar->codec_id = codec_id;
+    stream->time_base = time_base;
+    return stream;
+}
+
+/**
+ * 添加一个码率：一路视频和一路音频组成一个节目
+ * @return 视频流的下标
+ */
+static int addVariant(AVFormatContext *context, const char *bitrate, AVCodecID video_codec) {
+    int id = (int) context->nb_programs;
+    AVProgram *program = av_new_program(context, id);
+    av_dict_set(&program->metadata, "variant_bitrate", bitrate, 0);
+    AVStream *video = newStream(context, AVMEDIA_TYPE_VIDEO, video_codec, {1, 90000});
+    AVStream *audio = newStream(context, AVMEDIA_TYPE_AUDIO, AV_CODEC_ID_AAC, {1, 90000});
+    av_program_add_stream_index(context, id, video->index);
+    av_program_add_stream_index(context, id, audio->index);
+    return video->index;
+}
+
+/**
+ * 模拟一段吞吐稳定的下载，足够多的采样使平滑值收敛
+ */
+static void feed(AbrController *abr, int64_t bitrate) {
+    for (int i = 0; i < 40; i++) {
+        abr->onRead((int) (bitrate / 8 / 10), 100000); // 每次读取100ms
+    }
+}
+
+/**
+ * 可以切换的码率：编码格式与当前视频不同的码率、没有码率元数据的节目不参与切换；少于两个码率时不创建。
+ */
+static void testCreate() {
+    AVFormatContext *context = avformat_alloc_context();
+    int low = addVariant(context, "500000", AV_CODEC_ID_H264);
+    AbrController *abr = AbrController::create(context, low, low + 1);
+    CHECK(abr == nullptr); // 只有一个节目
+
+    addVariant(context, "8000000", AV_CODEC_ID_HEVC);
+    abr = AbrController::create(context, low, low + 1);
+    CHECK(abr == nullptr); // 第二个码率的编码格式不同
+
+    addVariant(context, "4000000", AV_CODEC_ID_H264);
+    int mid = addVariant(context, "1500000", AV_CODEC_ID_H264);
+    addVariant(context, "0", AV_CODEC_ID_H264);
+    abr = AbrController::create(context, mid, mid + 1);
+    CHECK(abr != nullptr);
+    if (abr) {
+        CHECK(abr->count() == 3);
+        CHECK(abr->currentVariant().bitrate == 1500000);
+        CHECK(abr->currentVariant().audio_index == mid + 1);
+        delete abr;
+    }
+    avformat_free_context(context);
+}
+
+static void testSwitch() {
+    AVFormatContext *context = avformat_alloc_context();
+    int low = addVariant(context, "500000", AV_CODEC_ID_H264);
+    int mid = addVariant(context, "1500000", AV_CODEC_ID_H264);
+    addVariant(context, "4000000", AV_CODEC_ID_H264);
+    AbrController *abr = AbrController::create(context, mid, mid + 1);
+    CHECK(abr != nullptr);
+    if (!abr) {
+        avformat_free_context(context);
+        return;
+    }
+
+    CHECK(abr->decide(0.5) == -1); // 还没有吞吐的采样
+
+    // 吞吐 1 Mbit/s，0.75倍只够最低的码率；缓存告急时不等切换间隔
+    feed(abr, 1000000);
+    CHECK(abr->currentThroughput() > 990000 && abr->currentThroughput() < 1010000);
+    CHECK(abr->decide(0.5) == 0);
+    CHECK(abr->decide(0.5) == -1); // 正在切换时不再决定
+    CHECK(abr->isPending(low));
+    CHECK(abr->isPending(low + 1));
+    CHECK(!abr->isPending(mid));
+    abr->commit();
+    CHECK(!abr->isPending(low));
+    CHECK(abr->currentVariant().video_index == low);
+    CHECK(abr->switches == 1);
+
+    // 吞吐恢复到 10 Mbit/s：缓存充足，但距离上次切换不到切换间隔
+    feed(abr, 10000000);
+    CHECK(abr->decide(5.0) == -1);
+    // 缓存告急时可以不等间隔，但只向下切换，不向上切换
+    CHECK(abr->decide(0.5) == -1);
+    CHECK(abr->switches == 1);
+    avformat_free_context(context);
+    delete abr;
+
+    // 新的控制器没有切换过，不受切换间隔的限制：缓存不足时不向上切换，缓存充足时切换到吞吐允许的最高码率
+    context = avformat_alloc_context();
+    low = addVariant(context, "500000", AV_CODEC_ID_H264);
+    mid = addVariant(context, "1500000", AV_CODEC_ID_H264);
+    int high = addVariant(context, "4000000", AV_CODEC_ID_H264);
+    abr = AbrController::create(context, low, low + 1);
+    feed(abr, 4000000); // 0.75倍为 3 Mbit/s，够中间的码率
+    if (av_gettime_relative() >= ABR_SWITCH_INTERVAL) {
+        CHECK(abr->decide(2.0) == -1);
+        CHECK(abr->decide(ABR_UP_BUFFER) == 1);
+        CHECK(abr->isPending(mid));
+        CHECK(!abr->isPending(high));
+        abr->commit();
+        CHECK(abr->currentVariant().bitrate == 1500000);
+    }
+    delete abr;
+    avformat_free_context(context);
+}
+
+int main() {
+    testCreate();
+    testSwitch();
+    return testResult("abr_test");
+}
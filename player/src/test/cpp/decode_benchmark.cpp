@@ -0,0 +1,153 @@
+/**
+ * 音频解码吞吐的主机测试：解码 + 重采样（与AudioChannel相同的输出格式：44100Hz 双声道 16位），
+ * 送入不限速的空输出（AUDIO_SINK_NULL_FREE_RUN），结束时输出多少倍实时。
+ *
+ * 用法：decode_benchmark <媒体文件>
+ */
+#include <cstdio>
+#include <pthread.h>
+#include "AudioSink.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+#include <libavutil/time.h>
+}
+
+#define OUT_SAMPLE_RATE 44100
+#define OUT_CHANNELS 2
+#define OUT_SAMPLE_SIZE 2
+
+struct Decoder {
+    AVFormatContext *context = nullptr;
+    AVCodecContext *codec_context = nullptr;
+    SwrContext *swr_ctx = nullptr;
+    int stream_index = -1;
+    AVPacket *packet = nullptr;
+    AVFrame *frame = nullptr;
+    uint8_t *out_buffers = nullptr;
+    int out_buffers_size = 0;
+    int64_t decoded_frames = 0;
+
+    bool finished = false;
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+};
+
+/**
+ * 取出下一个解码的帧，读到结尾并冲刷完解码器时返回false
+ */
+static bool nextFrame(Decoder *decoder) {
+    while (true) {
+        int result = avcodec_receive_frame(decoder->codec_context, decoder->frame);
+        if (!result) {
+            decoder->decoded_frames++;
+            return true;
+        }
+        if (result != AVERROR(EAGAIN)) {
+            return false; // AVERROR_EOF：冲刷完成
+        }
+        result = av_read_frame(decoder->context, decoder->packet);
+        if (result < 0) {
+            avcodec_send_packet(decoder->codec_context, nullptr); // 冲刷解码器
+            continue;
+        }
+        if (decoder->packet->stream_index == decoder->stream_index) {
+            avcodec_send_packet(decoder->codec_context, decoder->packet);
+        }
+        av_packet_unref(decoder->packet);
+    }
+}
+
+/**
+ * 空输出的拉取线程中调用：解码一帧并重采样
+ */
+static int pcmCallback(void *args, uint8_t **pcm_data) {
+    auto *decoder = static_cast<Decoder *>(args);
+    if (decoder->finished) {
+        return 0;
+    }
+    if (!nextFrame(decoder)) {
+        pthread_mutex_lock(&decoder->mutex);
+        decoder->finished = true;
+        pthread_cond_signal(&decoder->cond);
+        pthread_mutex_unlock(&decoder->mutex);
+        return 0;
+    }
+    AVFrame *frame = decoder->frame;
+    if (!decoder->swr_ctx) {
+        uint64_t channel_layout = frame->channel_layout ? frame->channel_layout
+                                                        : av_get_default_channel_layout(frame->channels);
+        decoder->swr_ctx = swr_alloc_set_opts(nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, OUT_SAMPLE_RATE,
+                                              channel_layout, (AVSampleFormat) frame->format,
+                                              frame->sample_rate, 0, nullptr);
+        swr_init(decoder->swr_ctx);
+    }
+    int dst_nb_samples = av_rescale_rnd(swr_get_delay(decoder->swr_ctx, frame->sample_rate) + frame->nb_samples,
+                                        OUT_SAMPLE_RATE, frame->sample_rate, AV_ROUND_UP);
+    int size = dst_nb_samples * OUT_CHANNELS * OUT_SAMPLE_SIZE;
+    if (size > decoder->out_buffers_size) {
+        av_freep(&decoder->out_buffers);
+        decoder->out_buffers = static_cast<uint8_t *>(av_malloc(size));
+        decoder->out_buffers_size = size;
+    }
+    int samples = swr_convert(decoder->swr_ctx, &decoder->out_buffers, dst_nb_samples,
+                              (const uint8_t **) frame->data, frame->nb_samples);
+    av_frame_unref(frame);
+    *pcm_data = decoder->out_buffers;
+    return samples > 0 ? samples * OUT_CHANNELS * OUT_SAMPLE_SIZE : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "用法：%s <媒体文件>\n", argv[0]);
+        return 2;
+    }
+    Decoder decoder;
+    if (avformat_open_input(&decoder.context, argv[1], nullptr, nullptr) < 0
+        || avformat_find_stream_info(decoder.context, nullptr) < 0) {
+        fprintf(stderr, "打开失败 %s\n", argv[1]);
+        return 1;
+    }
+    AVCodec *codec = nullptr;
+    decoder.stream_index = av_find_best_stream(decoder.context, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+    if (decoder.stream_index < 0) {
+        fprintf(stderr, "没有音频流 %s\n", argv[1]);
+        avformat_close_input(&decoder.context);
+        return 1;
+    }
+    decoder.codec_context = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(decoder.codec_context, decoder.context->streams[decoder.stream_index]->codecpar);
+    if (avcodec_open2(decoder.codec_context, codec, nullptr) < 0) {
+        fprintf(stderr, "打开解码器失败\n");
+        return 1;
+    }
+    decoder.packet = av_packet_alloc();
+    decoder.frame = av_frame_alloc();
+
+    int64_t begin = av_gettime_relative();
+    AudioSink *sink = AudioSink::create(AUDIO_SINK_NULL_FREE_RUN, nullptr);
+    sink->setPcmCallback(pcmCallback, &decoder);
+    sink->open(OUT_SAMPLE_RATE, OUT_CHANNELS, OUT_SAMPLE_SIZE);
+
+    pthread_mutex_lock(&decoder.mutex);
+    while (!decoder.finished) {
+        pthread_cond_wait(&decoder.cond, &decoder.mutex);
+    }
+    pthread_mutex_unlock(&decoder.mutex);
+    sink->stop(); // 空输出在停止时输出消费的音频时长和倍速
+    int64_t elapsed = av_gettime_relative() - begin;
+    delete sink;
+
+    printf("%s: %s，解码 %lld 帧，耗时 %.2lfs\n", argv[1], codec->name, (long long) decoder.decoded_frames,
+           elapsed / 1000000.0);
+
+    swr_free(&decoder.swr_ctx);
+    av_freep(&decoder.out_buffers);
+    av_frame_free(&decoder.frame);
+    av_packet_free(&decoder.packet);
+    avcodec_free_context(&decoder.codec_context);
+    avformat_close_input(&decoder.context);
+    return 0;
+}
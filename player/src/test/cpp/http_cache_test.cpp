@@ -0,0 +1,347 @@
+/**
+ * 网络缓存的主机测试：进程内的http服务器（支持Range）代替真实的服务器，
+ * 检查按块的Range请求、再次播放全部命中缓存、只缓存读过的块，以及超过上限时按最近使用时间淘汰（LRU）。
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "HttpCacheIO.h"
+#include "CacheFile.h"
+#include "test_util.h"
+
+#define SMALL_SIZE (4 * HTTP_CACHE_BLOCK_SIZE + 1000) // 最后一块不完整
+#define LARGE_SIZE (32 * HTTP_CACHE_BLOCK_SIZE + 1000) // Range测试跳转的距离超过tcp窗口，http协议一定重新请求
+#define FAR_BLOCK 30
+
+/**
+ * 进程内的http服务器：文件内容由路径和位置生成，每个连接一个线程，响应之后关闭连接。
+ */
+class TestServer {
+
+private:
+    int listen_fd = -1;
+    pthread_t pid_accept;
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    std::map<std::string, int64_t> sizes;
+    std::map<std::string, std::vector<int64_t>> ranges; // 每个路径收到的请求的开始位置
+
+    static void *task_accept(void *args) {
+        static_cast<TestServer *>(args)->acceptLoop();
+        return nullptr;
+    }
+
+    struct Connection {
+        TestServer *server;
+        int fd;
+    };
+
+    static void *task_connection(void *args) {
+        auto *connection = static_cast<Connection *>(args);
+        connection->server->serve(connection->fd);
+        close(connection->fd);
+        delete connection;
+        return nullptr;
+    }
+
+    void acceptLoop() {
+        while (true) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            pthread_t pid;
+            pthread_create(&pid, nullptr, task_connection, new Connection{this, fd});
+            pthread_detach(pid);
+        }
+    }
+
+    void serve(int fd) {
+        std::string request;
+        char buffer[4096];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                return;
+            }
+            request.append(buffer, n);
+        }
+        char path[256] = {0};
+        if (sscanf(request.c_str(), "GET %255s HTTP/1.", path) != 1) {
+            return;
+        }
+        pthread_mutex_lock(&mutex);
+        auto it = sizes.find(path);
+        int64_t size = it == sizes.end() ? -1 : it->second;
+        pthread_mutex_unlock(&mutex);
+        if (size < 0) {
+            const char *response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            send(fd, response, strlen(response), MSG_NOSIGNAL);
+            return;
+        }
+
+        int64_t start = 0;
+        int64_t end = size - 1;
+        bool partial = false;
+        const char *range = strcasestr(request.c_str(), "\nRange: bytes=");
+        if (range) {
+            long long range_start = 0;
+            long long range_end = -1;
+            int fields = sscanf(range + strlen("\nRange: bytes="), "%lld-%lld", &range_start, &range_end);
+            if (fields >= 1) {
+                start = range_start;
+                if (fields == 2 && range_end < end) {
+                    end = range_end;
+                }
+                partial = true;
+            }
+        }
+        pthread_mutex_lock(&mutex);
+        ranges[path].push_back(start);
+        pthread_mutex_unlock(&mutex);
+
+        char header[512];
+        if (partial) {
+            snprintf(header, sizeof(header),
+                     "HTTP/1.1 206 Partial Content\r\nContent-Length: %lld\r\nContent-Range: bytes %lld-%lld/%lld\r\n"
+                     "Accept-Ranges: bytes\r\nConnection: close\r\n\r\n",
+                     (long long) (end - start + 1), (long long) start, (long long) end, (long long) size);
+        } else {
+            snprintf(header, sizeof(header),
+                     "HTTP/1.1 200 OK\r\nContent-Length: %lld\r\nAccept-Ranges: bytes\r\nConnection: close\r\n\r\n",
+                     (long long) size);
+        }
+        if (send(fd, header, strlen(header), MSG_NOSIGNAL) < 0) {
+            return;
+        }
+        uint8_t data[16 * 1024];
+        for (int64_t position = start; position <= end;) {
+            int length = (int) std::min((int64_t) sizeof(data), end - position + 1);
+            for (int i = 0; i < length; i++) {
+                data[i] = byteAt(path, position + i);
+            }
+            if (send(fd, data, length, MSG_NOSIGNAL) < 0) {
+                return; // 客户端跳转到别处，关闭了连接
+            }
+            position += length;
+        }
+    }
+
+public:
+    int port = 0;
+
+    static uint8_t byteAt(const std::string &path, int64_t position) {
+        return (uint8_t) (position * 31 + position / 4099 + path.size() * 7 + path.back());
+    }
+
+    bool start() {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0; // 系统分配端口
+        socklen_t length = sizeof(address);
+        if (bind(listen_fd, (sockaddr *) &address, sizeof(address)) || listen(listen_fd, 16)
+            || getsockname(listen_fd, (sockaddr *) &address, &length)) {
+            return false;
+        }
+        port = ntohs(address.sin_port);
+        pthread_create(&pid_accept, nullptr, task_accept, this);
+        return true;
+    }
+
+    void stop() {
+        shutdown(listen_fd, SHUT_RDWR);
+        close(listen_fd);
+        pthread_join(pid_accept, nullptr);
+    }
+
+    void addFile(const std::string &path, int64_t size) {
+        pthread_mutex_lock(&mutex);
+        sizes[path] = size;
+        pthread_mutex_unlock(&mutex);
+    }
+
+    std::vector<int64_t> requests(const std::string &path) {
+        pthread_mutex_lock(&mutex);
+        std::vector<int64_t> result = ranges[path];
+        pthread_mutex_unlock(&mutex);
+        return result;
+    }
+
+    std::string url(const std::string &path) {
+        return "http://127.0.0.1:" + std::to_string(port) + path;
+    }
+};
+
+static TestServer server;
+
+struct ReadResult {
+    int64_t bytes = 0; // 读到的字节数
+    bool correct = true; // 内容是否与服务器生成的一致
+    int64_t hit_bytes = 0;
+    int64_t miss_bytes = 0;
+};
+
+/**
+ * 通过网络缓存读取 [start, start + length)，length < 0 时读到结尾
+ */
+static ReadResult readRange(const std::string &path, int64_t start, int64_t length) {
+    ReadResult result;
+    HttpCacheIO *io = HttpCacheIO::open(server.url(path).c_str(), nullptr);
+    if (!io) {
+        result.correct = false;
+        return result;
+    }
+    if (start && avio_seek(io->pb, start, SEEK_SET) != start) {
+        result.correct = false;
+    }
+    std::vector<uint8_t> buffer(64 * 1024);
+    while (length < 0 || result.bytes < length) {
+        int size = (int) buffer.size();
+        if (length >= 0 && length - result.bytes < size) {
+            size = (int) (length - result.bytes);
+        }
+        int n = avio_read(io->pb, buffer.data(), size);
+        if (n <= 0) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (buffer[i] != TestServer::byteAt(path, start + result.bytes + i)) {
+                result.correct = false;
+            }
+        }
+        result.bytes += n;
+    }
+    result.hit_bytes = io->hit_bytes;
+    result.miss_bytes = io->miss_bytes;
+    delete io; // 保存块表，超过上限时淘汰其他地址
+    return result;
+}
+
+static std::string dataPath(const std::string &path) {
+    char data_path[512];
+    CacheFile::urlPath(server.url(path).c_str(), "httpcache", data_path, sizeof(data_path)); // 与HttpCacheIO的后缀一致
+    return data_path;
+}
+
+/**
+ * 修改缓存的最近使用时间，LRU按块数据文件的修改时间排序
+ */
+static void setUsedTime(const std::string &path, int seconds_ago) {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    struct timeval times[2] = {{now.tv_sec - seconds_ago, 0}, {now.tv_sec - seconds_ago, 0}};
+    utimes(dataPath(path).c_str(), times);
+}
+
+static bool exists(const std::string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+/**
+ * 第一次读取全部下载，再次读取全部命中缓存，不再请求服务器。
+ */
+static void testReplay() {
+    ReadResult first = readRange("/a.mp4", 0, -1);
+    CHECK(first.correct);
+    CHECK(first.bytes == SMALL_SIZE);
+    CHECK(first.miss_bytes == SMALL_SIZE);
+    CHECK(first.hit_bytes == 0);
+
+    size_t requests = server.requests("/a.mp4").size();
+    ReadResult second = readRange("/a.mp4", 0, -1);
+    CHECK(second.correct);
+    CHECK(second.bytes == SMALL_SIZE);
+    CHECK(second.hit_bytes == SMALL_SIZE); // 命中率 100%
+    CHECK(second.miss_bytes == 0);
+    CHECK(server.requests("/a.mp4").size() == requests);
+}
+
+/**
+ * 跳到远处的位置：从该块的起始位置发起Range请求，只缓存读过的块。
+ */
+static void testRangeFetch() {
+    int64_t position = (int64_t) FAR_BLOCK * HTTP_CACHE_BLOCK_SIZE + 1234;
+    ReadResult first = readRange("/b.mp4", position, 1000);
+    CHECK(first.correct);
+    CHECK(first.bytes == 1000);
+    CHECK(first.hit_bytes == 0);
+    std::vector<int64_t> requests = server.requests("/b.mp4");
+    CHECK(!requests.empty() && requests.back() == (int64_t) FAR_BLOCK * HTTP_CACHE_BLOCK_SIZE);
+
+    // 同一块再次读取命中缓存，没有读过的块仍然需要下载
+    ReadResult second = readRange("/b.mp4", position, 1000);
+    CHECK(second.correct);
+    CHECK(second.miss_bytes == 0);
+    CHECK(second.hit_bytes >= 1000);
+    CHECK(server.requests("/b.mp4").size() == requests.size());
+
+    ReadResult head = readRange("/b.mp4", 0, 1000);
+    CHECK(head.correct);
+    CHECK(head.hit_bytes == 0);
+    CHECK(head.miss_bytes >= 1000);
+    CHECK(server.requests("/b.mp4").size() > requests.size());
+}
+
+/**
+ * 超过上限时淘汰最久没有使用的地址，当前地址和较新的地址保留。
+ */
+static void testEviction() {
+    // a：完整缓存，最旧；b：缓存了两块，较新。c读完之后总大小超过上限，只需要淘汰a。
+    HttpCacheIO::setMaxSize(2LL * SMALL_SIZE);
+    setUsedTime("/a.mp4", 100);
+    setUsedTime("/b.mp4", 50);
+
+    ReadResult c = readRange("/c.mp4", 0, -1);
+    CHECK(c.correct);
+    CHECK(c.bytes == SMALL_SIZE);
+    CHECK(!exists(dataPath("/a.mp4")));
+    CHECK(exists(dataPath("/b.mp4")));
+    CHECK(exists(dataPath("/c.mp4")));
+
+    // a需要重新下载
+    ReadResult a = readRange("/a.mp4", 0, -1);
+    CHECK(a.correct);
+    CHECK(a.hit_bytes == 0);
+    CHECK(a.miss_bytes == SMALL_SIZE);
+}
+
+int main() {
+    char dir[] = "/tmp/http_cache_test_XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "创建缓存目录失败\n");
+        return 1;
+    }
+    CacheFile::setDir(dir);
+    avformat_network_init();
+
+    server.addFile("/a.mp4", SMALL_SIZE);
+    server.addFile("/b.mp4", LARGE_SIZE);
+    server.addFile("/c.mp4", SMALL_SIZE);
+    if (!server.start()) {
+        fprintf(stderr, "启动http服务器失败\n");
+        return 1;
+    }
+
+    testReplay();
+    testRangeFetch();
+    testEviction();
+
+    server.stop();
+    std::string command = std::string("rm -rf ") + dir;
+    system(command.c_str());
+
+    return testResult("http_cache_test");
+}
@@ -0,0 +1,219 @@
+/**
+ * 本地文件读取的主机性能测试：同一个文件分别用映射读取（LocalFileIO）和按块read（与ffmpeg默认的file协议相同）解封装，
+ * 读出全部压缩包，比较耗时、吞吐和卡顿（与 STAT_IO_STALL_US 相同：单次读取超过 LOCAL_IO_STALL_THRESHOLD 的累计耗时）。
+ *
+ * 冷启动：每次运行之前用 posix_fadvise(DONTNEED) 把文件移出页缓存，读取需要等待存储；
+ * 热启动：文件已经在页缓存中。两种情况都按多次的平均值比较。
+ * 文件被其他进程映射或者在tmpfs上时无法移出页缓存，此时给出提示，冷启动的结果没有意义。
+ *
+ * 用法：io_benchmark <媒体文件> [次数]
+ */
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LocalFileIO.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define FILE_IO_BUFFER_SIZE 32768 // ffmpeg file协议的缓冲区大小（IO_BUFFER_SIZE）
+
+struct Result {
+    int64_t packets = 0;
+    int64_t bytes = 0; // 压缩包的字节数
+    int64_t time = 0; // 单位微秒
+    int64_t syscalls = 0;
+    int64_t stall_time = 0; // 单次读取超过 LOCAL_IO_STALL_THRESHOLD 的累计耗时，单位微秒
+};
+
+/**
+ * 与file协议相同的按块read，统计每次read的耗时
+ */
+struct FileReader {
+    int fd = -1;
+    int64_t syscalls = 0;
+    int64_t stall_time = 0;
+
+    static int read_packet(void *opaque, uint8_t *buf, int buf_size) {
+        auto *reader = static_cast<FileReader *>(opaque);
+        int64_t start = av_gettime_relative();
+        ssize_t length = read(reader->fd, buf, buf_size);
+        int64_t cost = av_gettime_relative() - start;
+        reader->syscalls++;
+        if (cost > LOCAL_IO_STALL_THRESHOLD) {
+            reader->stall_time += cost;
+        }
+        if (length < 0) {
+            return AVERROR(errno);
+        }
+        return length ? (int) length : AVERROR_EOF;
+    }
+
+    static int64_t seek(void *opaque, int64_t offset, int whence) {
+        auto *reader = static_cast<FileReader *>(opaque);
+        reader->syscalls++;
+        if (whence == AVSEEK_SIZE) {
+            struct stat st;
+            return fstat(reader->fd, &st) ? AVERROR(errno) : st.st_size;
+        }
+        int64_t result = lseek(reader->fd, offset, whence & ~AVSEEK_FORCE);
+        return result < 0 ? AVERROR(errno) : result;
+    }
+};
+
+/**
+ * 把文件移出页缓存
+ * @return 移出后仍在页缓存中的比例，无法检查时返回-1
+ */
+static double evict(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    double resident = -1;
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size > 0) {
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            long page = sysconf(_SC_PAGESIZE);
+            size_t pages = (st.st_size + page - 1) / page;
+            auto *vec = static_cast<unsigned char *>(malloc(pages));
+            if (vec && !mincore(data, st.st_size, vec)) {
+                size_t count = 0;
+                for (size_t i = 0; i < pages; i++) {
+                    count += vec[i] & 1;
+                }
+                resident = (double) count / pages;
+            }
+            free(vec);
+            munmap(data, st.st_size);
+        }
+    }
+    close(fd);
+    return resident;
+}
+
+/**
+ * 解封装整个文件
+ * @param mmap 是否使用映射读取，否则按块read
+ */
+static bool demux(const char *path, bool mmap, Result *result) {
+    int64_t begin = av_gettime_relative();
+    AVFormatContext *context = avformat_alloc_context();
+    LocalFileIO *io = nullptr;
+    FileReader reader;
+    if (mmap) {
+        io = LocalFileIO::open(path);
+        if (!io) {
+            fprintf(stderr, "映射失败 %s\n", path);
+            avformat_free_context(context);
+            return false;
+        }
+        context->pb = io->pb;
+    } else {
+        reader.fd = open(path, O_RDONLY);
+        auto *buffer = static_cast<uint8_t *>(av_malloc(FILE_IO_BUFFER_SIZE));
+        if (reader.fd >= 0 && buffer) {
+            context->pb = avio_alloc_context(buffer, FILE_IO_BUFFER_SIZE, 0, &reader,
+                                             FileReader::read_packet, nullptr, FileReader::seek);
+        }
+        if (!context->pb) {
+            fprintf(stderr, "打开失败 %s\n", path);
+            av_free(buffer);
+            if (reader.fd >= 0) {
+                close(reader.fd);
+            }
+            avformat_free_context(context);
+            return false;
+        }
+    }
+    context->flags |= AVFMT_FLAG_CUSTOM_IO;
+    AVIOContext *pb = context->pb;
+    bool ok = avformat_open_input(&context, path, nullptr, nullptr) >= 0;
+    if (ok) {
+        AVPacket *packet = av_packet_alloc();
+        while (av_read_frame(context, packet) >= 0) {
+            result->packets++;
+            result->bytes += packet->size;
+            av_packet_unref(packet);
+        }
+        av_packet_free(&packet);
+        avformat_close_input(&context);
+    } else {
+        fprintf(stderr, "打开失败 %s\n", path);
+    }
+    result->time += av_gettime_relative() - begin;
+    if (io) {
+        result->syscalls += io->syscalls;
+        result->stall_time += io->stall_time;
+        delete io;
+    } else {
+        result->syscalls += reader.syscalls;
+        result->stall_time += reader.stall_time;
+        av_freep(&pb->buffer);
+        avio_context_free(&pb);
+        close(reader.fd);
+    }
+    return ok;
+}
+
+static void print(const char *name, const Result &result, int times) {
+    double seconds = result.time / 1000000.0 / times;
+    printf("%-10s %lld 个包，%.2lf MB，平均耗时 %.2lf ms，%.1lf MB/s，系统调用 %lld 次，卡顿 %.2lf ms\n", name,
+           (long long) result.packets / times, result.bytes / times / 1048576.0, seconds * 1000,
+           result.bytes / times / 1048576.0 / seconds, (long long) result.syscalls / times,
+           result.stall_time / 1000.0 / times);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "用法：%s <媒体文件> [次数]\n", argv[0]);
+        return 2;
+    }
+    int times = argc > 2 ? atoi(argv[2]) : 5;
+    if (times <= 0) {
+        times = 1;
+    }
+    const char *path = argv[1];
+    Result cold_file;
+    Result cold_mmap;
+    double resident = 0;
+    for (int i = 0; i < times; i++) {
+        // 交替运行，两种方式受到的干扰相同
+        double left = evict(path);
+        if (!demux(path, false, &cold_file)) {
+            return 1;
+        }
+        double left_mmap = evict(path);
+        if (!demux(path, true, &cold_mmap)) {
+            return 1;
+        }
+        resident = FFMAX(resident, FFMAX(left, left_mmap));
+    }
+    if (resident > 0.01) {
+        printf("提示：移出页缓存后仍有 %.0lf%% 在页缓存中，冷启动的结果不准确\n", resident * 100);
+    }
+
+    Result warm; // 读入页缓存，不计入比较
+    if (!demux(path, false, &warm)) {
+        return 1;
+    }
+    Result warm_file;
+    Result warm_mmap;
+    for (int i = 0; i < times; i++) {
+        if (!demux(path, false, &warm_file) || !demux(path, true, &warm_mmap)) {
+            return 1;
+        }
+    }
+    print("冷 file:", cold_file, times);
+    print("冷 mmap:", cold_mmap, times);
+    print("热 file:", warm_file, times);
+    print("热 mmap:", warm_mmap, times);
+    return 0;
+}
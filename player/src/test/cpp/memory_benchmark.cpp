@@ -0,0 +1,146 @@
+/**
+ * 内存来源的主机性能测试：同一份已经在内存中的媒体（解密后的数据等），分别通过内存来源（MemoryIO）
+ * 和先写入临时文件再按路径打开两种方式准备（打开 + 探测流信息），比较启动耗时和内存峰值。
+ *
+ * 每种方式在单独的子进程中运行，内存峰值（ru_maxrss）互不影响；峰值减去读入媒体之后的值，
+ * 只计算准备过程增加的内存。临时文件的启动耗时包括写入文件。
+ *
+ * 用法：memory_benchmark <媒体文件> [临时目录]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "MemoryIO.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+struct Result {
+    int64_t write_time = 0; // 写入临时文件的耗时，单位微秒
+    int64_t open_time = 0; // avformat_open_input的耗时，单位微秒
+    int64_t probe_time = 0; // avformat_find_stream_info的耗时，单位微秒
+};
+
+/**
+ * 读入整个文件，模拟应用中已经在内存里的媒体
+ */
+static uint8_t *load(const char *path, int64_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return nullptr;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    auto *data = static_cast<uint8_t *>(malloc(*size));
+    if (data && fread(data, 1, *size, file) != (size_t) *size) {
+        free(data);
+        data = nullptr;
+    }
+    fclose(file);
+    return data;
+}
+
+/**
+ * 内存峰值，单位KB
+ */
+static int64_t peakRss() {
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * 与 VideoPlayer::prepare 相同：打开并探测流信息
+ * @param io 自定义读取，为空时使用ffmpeg默认的协议
+ */
+static bool prepare(const char *url, MediaIO *io, Result *result) {
+    AVFormatContext *context = avformat_alloc_context();
+    if (io) {
+        context->pb = io->pb;
+        context->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    int64_t begin = av_gettime_relative();
+    if (avformat_open_input(&context, url, nullptr, nullptr) < 0) {
+        fprintf(stderr, "打开失败 %s\n", url);
+        return false;
+    }
+    int64_t opened = av_gettime_relative();
+    if (avformat_find_stream_info(context, nullptr) < 0) {
+        fprintf(stderr, "探测流信息失败 %s\n", url);
+        avformat_close_input(&context);
+        return false;
+    }
+    result->open_time = opened - begin;
+    result->probe_time = av_gettime_relative() - opened;
+    avformat_close_input(&context);
+    return true;
+}
+
+/**
+ * 在子进程中运行一种方式并输出结果
+ * @param memory 是否使用内存来源，否则写入临时文件
+ */
+static int run(const char *media, const char *temp_dir, bool memory) {
+    int64_t size = 0;
+    uint8_t *data = load(media, &size);
+    if (!data) {
+        fprintf(stderr, "读取失败 %s\n", media);
+        return 1;
+    }
+    int64_t base_rss = peakRss();
+    Result result;
+    bool ok;
+    if (memory) {
+        char url[64];
+        MemoryIO::registerSource(data, size, nullptr, nullptr, nullptr, url, sizeof(url));
+        MemoryIO *io = MemoryIO::open(url);
+        ok = io && prepare(url, io, &result);
+        delete io;
+        MemoryIO::unregisterSource(url);
+    } else {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/memory_benchmark_%d", temp_dir, getpid());
+        int64_t begin = av_gettime_relative();
+        FILE *file = fopen(path, "wb");
+        ok = file && fwrite(data, 1, size, file) == (size_t) size;
+        if (file) {
+            fclose(file);
+        }
+        result.write_time = av_gettime_relative() - begin;
+        ok = ok && prepare(path, nullptr, &result);
+        unlink(path);
+    }
+    free(data);
+    if (!ok) {
+        return 1;
+    }
+    int64_t total = result.write_time + result.open_time + result.probe_time;
+    printf("%-8s 写入 %.2lf ms，打开 %.2lf ms，探测 %.2lf ms，合计 %.2lf ms，内存峰值增加 %lld KB\n",
+           memory ? "memory:" : "tmpfile", result.write_time / 1000.0, result.open_time / 1000.0,
+           result.probe_time / 1000.0, total / 1000.0, (long long) (peakRss() - base_rss));
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "用法：%s <媒体文件> [临时目录]\n", argv[0]);
+        return 2;
+    }
+    const char *temp_dir = argc > 2 ? argv[2] : "/tmp";
+    for (bool memory : {false, true}) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            exit(run(argv[1], temp_dir, memory));
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            return 1;
+        }
+    }
+    return 0;
+}
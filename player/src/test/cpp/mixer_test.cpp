@@ -0,0 +1,212 @@
+/**
+ * 混音器的主机测试：几路生成的方波、正弦波送入AudioMixer，由按实时速度拉取的空输出驱动混音，
+ * 检查饱和、增益、静音和数据不足时的静音填充计数。
+ *
+ * 混音器每次从每路输入读取 AudioMixer::MIX_SAMPLES 个采样，各路写入的数据都是 MIX_SAMPLES 的整数倍时，
+ * 各路数据在混音块中的位置对齐，周期整除 MIX_SAMPLES 的波形在各路之间同相。
+ */
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <unistd.h>
+#include "AudioMixer.h"
+#include "NullAudioSink.h"
+#include "test_util.h"
+
+#define MIX_SAMPLES AudioMixer::MIX_SAMPLES
+#define PERIOD 64 // 波形的周期，单位采样（双声道交错，即32帧），整除 MIX_SAMPLES
+
+/**
+ * 按实时速度拉取的空输出，同时保存混音结果
+ */
+class CaptureSink : public NullAudioSink {
+
+private:
+    pthread_mutex_t mutex;
+    std::vector<int16_t> samples;
+
+protected:
+    void onPcm(uint8_t *data, int size) override {
+        auto *pcm = reinterpret_cast<int16_t *>(data);
+        pthread_mutex_lock(&mutex);
+        samples.insert(samples.end(), pcm, pcm + size / AudioMixer::SAMPLE_SIZE);
+        pthread_mutex_unlock(&mutex);
+    }
+
+public:
+    CaptureSink() : NullAudioSink(true) {
+        pthread_mutex_init(&mutex, nullptr);
+    }
+
+    ~CaptureSink() override {
+        stop(); // 先停止拉取线程，再销毁锁
+        pthread_mutex_destroy(&mutex);
+    }
+
+    std::vector<int16_t> snapshot() {
+        pthread_mutex_lock(&mutex);
+        std::vector<int16_t> result = samples;
+        pthread_mutex_unlock(&mutex);
+        return result;
+    }
+};
+
+/**
+ * 双声道交错的方波，前半个周期为 amplitude，后半个周期为 -amplitude
+ */
+static std::vector<int16_t> square(int amplitude, int count) {
+    std::vector<int16_t> data(count);
+    for (int i = 0; i < count; i++) {
+        data[i] = (int16_t) (i % PERIOD < PERIOD / 2 ? amplitude : -amplitude);
+    }
+    return data;
+}
+
+/**
+ * 双声道交错的正弦波，与方波同相（前半个周期为正）
+ */
+static std::vector<int16_t> sine(int amplitude, int count) {
+    std::vector<int16_t> data(count);
+    for (int i = 0; i < count; i++) {
+        int frame = i / AudioMixer::CHANNELS;
+        data[i] = (int16_t) lround(amplitude * sin(2 * M_PI * frame / (PERIOD / AudioMixer::CHANNELS)));
+    }
+    return data;
+}
+
+static int countOf(const std::vector<int16_t> &samples, int value) {
+    int count = 0;
+    for (int16_t sample : samples) {
+        if (sample == value) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * 两路满幅方波同相叠加：超出int16范围的和饱和到 32767 / -32768，不会回绕。
+ */
+static void testSaturation() {
+    auto *sink = new CaptureSink();
+    AudioMixer::setOutputSink(sink);
+    MixerSource *a = AudioMixer::addSource();
+    MixerSource *b = AudioMixer::addSource();
+
+    std::vector<int16_t> data = square(30000, MIX_SAMPLES * 8);
+    a->write(data.data(), (int) data.size());
+    b->write(data.data(), (int) data.size());
+    usleep(400 * 1000); // 8个混音块约186ms
+
+    std::vector<int16_t> samples = sink->snapshot();
+    int other = 0;
+    for (int16_t sample : samples) {
+        // 静音、只有一路、两路叠加饱和
+        if (sample != 0 && sample != 30000 && sample != -30000 && sample != 32767 && sample != -32768) {
+            other++;
+        }
+    }
+    CHECK(other == 0);
+    CHECK(countOf(samples, 32767) > 0);
+    CHECK(countOf(samples, -32768) > 0);
+
+    AudioMixer::removeSource(a);
+    AudioMixer::removeSource(b);
+}
+
+/**
+ * 增益和静音：正弦波增益0.5，方波不变，另一路满幅方波静音。
+ * 波峰处正弦波与方波叠加为 10000 + 8000，静音的一路漏进来时会超过该值。
+ */
+static void testGainAndMute() {
+    auto *sink = new CaptureSink();
+    AudioMixer::setOutputSink(sink);
+    MixerSource *a = AudioMixer::addSource();
+    MixerSource *b = AudioMixer::addSource();
+    MixerSource *c = AudioMixer::addSource();
+    a->gain = 16384; // 0.5
+    b->mute = true;
+
+    std::vector<int16_t> sine_data = sine(20000, MIX_SAMPLES * 4);
+    std::vector<int16_t> loud_data = square(20000, MIX_SAMPLES * 4);
+    std::vector<int16_t> square_data = square(8000, MIX_SAMPLES * 4);
+    a->write(sine_data.data(), (int) sine_data.size());
+    b->write(loud_data.data(), (int) loud_data.size());
+    c->write(square_data.data(), (int) square_data.size());
+    usleep(300 * 1000);
+
+    std::vector<int16_t> samples = sink->snapshot();
+    int max = 0;
+    int min = 0;
+    for (int16_t sample : samples) {
+        max = sample > max ? sample : max;
+        min = sample < min ? sample : min;
+    }
+    CHECK(max >= 17999 && max <= 18001);
+    CHECK(min >= -18001 && min <= -17999);
+
+    AudioMixer::removeSource(a);
+    AudioMixer::removeSource(b);
+    AudioMixer::removeSource(c);
+}
+
+/**
+ * 数据不足：没有写入的一路每次混音都整块填充静音；写入的数据不是整块时，最后一块不足的部分计入静音填充。
+ */
+static void testUnderrun() {
+    auto *sink = new CaptureSink();
+    AudioMixer::setOutputSink(sink);
+    MixerSource *empty = AudioMixer::addSource();
+    MixerSource *partial = AudioMixer::addSource();
+
+    int written = AudioMixer::SAMPLE_RATE * AudioMixer::CHANNELS / 10; // 100ms，不是整块
+    std::vector<int16_t> data = sine(10000, written);
+    partial->write(data.data(), written);
+    usleep(300 * 1000);
+
+    int64_t empty_underrun = empty->underrun_samples;
+    int64_t partial_underrun = partial->underrun_samples;
+    CHECK(empty_underrun > 0);
+    CHECK(empty_underrun % MIX_SAMPLES == 0);
+    CHECK((partial_underrun + written) % MIX_SAMPLES == 0);
+    CHECK(empty_underrun >= partial_underrun + written); // empty先加入，读取的次数不少于partial
+
+    AudioMixer::removeSource(empty);
+    AudioMixer::removeSource(partial);
+}
+
+/**
+ * 打不开的输出
+ */
+class FailingSink : public NullAudioSink {
+
+public:
+    FailingSink() : NullAudioSink(true) {}
+
+    bool open(int sample_rate, int channels, int sample_size) override {
+        return false;
+    }
+};
+
+/**
+ * 输出打开失败：第一路输入加入失败，混音器不保留没有输出的实例，之后的输入重新打开输出。
+ */
+static void testOpenFailure() {
+    AudioMixer::setOutputSink(new FailingSink());
+    CHECK(AudioMixer::addSource() == nullptr);
+
+    AudioMixer::setOutputSink(new CaptureSink());
+    MixerSource *source = AudioMixer::addSource();
+    CHECK(source != nullptr);
+    if (source) {
+        AudioMixer::removeSource(source);
+    }
+}
+
+int main() {
+    testSaturation();
+    testGainAndMute();
+    testUnderrun();
+    testOpenFailure();
+    return testResult("mixer_test");
+}
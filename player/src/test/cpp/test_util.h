@@ -0,0 +1,32 @@
+#ifndef VIDEOPLAYER_TEST_UTIL_H
+#define VIDEOPLAYER_TEST_UTIL_H
+
+#include <cstdio>
+
+/**
+ * 主机测试共用的检查：失败时输出位置和条件并计数，不中断测试，main的结尾用 testResult 输出结果。
+ */
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d 检查失败：%s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+/**
+ * @param name 测试的名称
+ * @return main的返回值，有检查失败时为1
+ */
+static inline int testResult(const char *name) {
+    if (failures) {
+        fprintf(stderr, "%s：%d 项检查失败\n", name, failures);
+        return 1;
+    }
+    printf("%s：全部通过\n", name);
+    return 0;
+}
+
+#endif //VIDEOPLAYER_TEST_UTIL_H
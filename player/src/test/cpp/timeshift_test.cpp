@@ -0,0 +1,194 @@
+/**
+ * 直播时移缓存的主机测试：按实时速度追加视频和音频压缩包模拟直播源（视频每10帧一个关键帧），
+ * 检查回退落在关键帧上、延时、送出的顺序、回到直播、超过最长时长的淘汰，
+ * 以及写入溢出文件的包读出的数据与写入时相同。
+ *
+ * 包的数据由所属的流和时间戳生成，读出时按同样的规则校验。
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "TimeShiftBuffer.h"
+#include "CacheFile.h"
+#include "test_util.h"
+
+#define FRAME_INTERVAL 20000 // 视频帧间隔，单位微秒
+#define GOP 10 // 关键帧间隔，单位帧
+#define PACKET_SIZE 1000
+
+static uint8_t byteAt(int stream_index, int64_t pts, int i) {
+    return (uint8_t) (pts * 3 + stream_index * 101 + i);
+}
+
+/**
+ * 模拟的直播源：每次送出一帧视频和一个音频包
+ */
+struct LiveSource {
+    BaseChannel video{0, nullptr, {1, 1000}};
+    BaseChannel audio{1, nullptr, {1, 1000}};
+    int64_t frames = 0;
+
+    void appendTo(TimeShiftBuffer *buffer, int count, bool realtime) {
+        for (int n = 0; n < count; n++, frames++) {
+            append(buffer, &video, frames % GOP == 0);
+            append(buffer, &audio, true);
+            if (realtime) {
+                usleep(FRAME_INTERVAL);
+            }
+        }
+    }
+
+    void append(TimeShiftBuffer *buffer, BaseChannel *channel, bool key) {
+        AVPacket *packet = av_packet_alloc();
+        av_new_packet(packet, PACKET_SIZE);
+        packet->pts = packet->dts = frames * FRAME_INTERVAL / 1000;
+        packet->duration = FRAME_INTERVAL / 1000;
+        packet->flags = key ? AV_PKT_FLAG_KEY : 0;
+        packet->stream_index = channel->stream_index;
+        for (int i = 0; i < PACKET_SIZE; i++) {
+            packet->data[i] = byteAt(channel->stream_index, packet->pts, i);
+        }
+        buffer->append(packet, channel);
+        av_packet_free(&packet);
+    }
+};
+
+/**
+ * 取出直到最新的包，检查顺序和数据
+ * @return 取出的包数
+ */
+static int drain(TimeShiftBuffer *buffer, LiveSource *source) {
+    int count = 0;
+    int64_t last_pts[2] = {-1, -1};
+    BaseChannel *channel = nullptr;
+    AVPacket *packet;
+    while ((packet = buffer->next(&channel))) {
+        int index = channel->stream_index;
+        CHECK(channel == &source->video || channel == &source->audio);
+        CHECK(packet->stream_index == index);
+        CHECK(packet->size == PACKET_SIZE);
+        CHECK(last_pts[index] < 0 || packet->pts == last_pts[index] + FRAME_INTERVAL / 1000);
+        last_pts[index] = packet->pts;
+        int mismatch = 0;
+        for (int i = 0; i < packet->size; i++) {
+            if (packet->data[i] != byteAt(index, packet->pts, i)) {
+                mismatch++;
+            }
+        }
+        CHECK(mismatch == 0);
+        av_packet_free(&packet);
+        count++;
+    }
+    return count;
+}
+
+static void checkKeyframe(TimeShiftBuffer *buffer, LiveSource *source) {
+    BaseChannel *channel = nullptr;
+    AVPacket *packet = buffer->next(&channel);
+    CHECK(packet != nullptr);
+    if (packet) {
+        CHECK(channel == &source->video);
+        CHECK(packet->flags & AV_PKT_FLAG_KEY);
+        av_packet_free(&packet);
+    }
+}
+
+/**
+ * 只使用内存：按实时速度追加1.5秒，最长保存1秒
+ */
+static void testLive() {
+    LiveSource source;
+    auto *buffer = new TimeShiftBuffer(&source.video, 1000000, 64 * 1024 * 1024, "rtmp://test/live", 0);
+    source.appendTo(buffer, 75, true);
+
+    // 超过最长时长的包被淘汰
+    CHECK(buffer->evicted_packets > 0);
+    CHECK(buffer->span() <= 1000000);
+    CHECK(buffer->span() > 800000);
+
+    // 回退0.5秒：落在目标之前最近的关键帧，延时不超过回退的时长加一个关键帧间隔
+    CHECK(buffer->seekBehind(500000));
+    CHECK(!buffer->isLive());
+    int64_t delay = buffer->delay();
+    CHECK(delay >= 500000);
+    CHECK(delay < 500000 + GOP * FRAME_INTERVAL + 100000);
+    checkKeyframe(buffer, &source);
+    CHECK(drain(buffer, &source) > 0);
+    CHECK(buffer->isLive());
+    CHECK(buffer->delay() == 0);
+
+    // 回退超过缓存的时长：从最早的关键帧开始
+    CHECK(buffer->seekBehind(10000000));
+    CHECK(buffer->delay() <= buffer->span());
+    CHECK(buffer->delay() > buffer->span() - GOP * FRAME_INTERVAL - 100000);
+    checkKeyframe(buffer, &source);
+
+    // 回到直播：从最新的关键帧开始
+    buffer->seekLive();
+    CHECK(!buffer->isLive());
+    CHECK(buffer->delay() < GOP * FRAME_INTERVAL + 100000);
+    checkKeyframe(buffer, &source);
+    drain(buffer, &source);
+    CHECK(buffer->isLive());
+
+    // 回退到最早的位置后暂停，之后追加超过最长时长：送出的位置被淘汰，跳到剩下的第一个关键帧
+    CHECK(buffer->seekBehind(10000000));
+    CHECK(!buffer->takeDiscontinuity());
+    source.appendTo(buffer, 60, true);
+    CHECK(buffer->takeDiscontinuity());
+    CHECK(!buffer->takeDiscontinuity());
+    checkKeyframe(buffer, &source);
+    CHECK(drain(buffer, &source) > 0);
+
+    delete buffer;
+}
+
+/**
+ * 使用溢出文件：内存上限只有10个包，其余的包写入溢出文件
+ * @param max_disk 溢出文件的上限，小于全部数据时环形覆盖最早的包
+ */
+static void testSpill(const char *dir, int64_t max_disk) {
+    CacheFile::setDir(dir);
+    LiveSource source;
+    auto *buffer = new TimeShiftBuffer(&source.video, 60000000, 10 * PACKET_SIZE, "rtmp://test/spill", max_disk);
+    source.appendTo(buffer, 100, false);
+
+    CHECK(buffer->memory_bytes <= 10 * PACKET_SIZE);
+    CHECK(buffer->disk_bytes > 0);
+    CHECK(buffer->disk_bytes <= max_disk);
+    bool wrapped = max_disk < 200 * PACKET_SIZE;
+    CHECK(wrapped == (buffer->evicted_packets > 0));
+
+    // 从最早的关键帧读到最新的包，溢出的包与内存中的包数据相同、顺序连续
+    CHECK(buffer->seekBehind(60000000));
+    BaseChannel *channel = nullptr;
+    AVPacket *first = buffer->next(&channel);
+    CHECK(first != nullptr);
+    if (first) {
+        CHECK(channel == &source.video);
+        CHECK(first->flags & AV_PKT_FLAG_KEY);
+        CHECK(wrapped || first->pts == 0);
+        av_packet_free(&first);
+    }
+    int count = drain(buffer, &source);
+    CHECK(wrapped || count == 199);
+    CHECK(count >= 10);
+
+    delete buffer;
+    CacheFile::setDir(nullptr);
+}
+
+int main() {
+    testLive();
+
+    char dir[] = "/tmp/timeshift_test_XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    testSpill(dir, 1024 * 1024);
+    testSpill(dir, 50 * PACKET_SIZE);
+    CHECK(rmdir(dir) == 0); // 溢出文件打开后已经删除，目录为空
+
+    return testResult("timeshift_test");
+}